@@ -0,0 +1,697 @@
+/*******************************************************************************
+ * sudokuBatch.c by Geoffrey Sessums
+ * Purpose:
+ *  Validates a stream of many puzzles in one process. Each record is a
+ *  command character followed by the puzzle values; each record produces
+ *  exactly one result line.
+ * Input:
+ *  Records back to back, e.g.  C 3 9 2 ... 7 2
+ *                              L 0 0 2 ... 0 0
+ *                              G 12345
+ *  A G record takes a seed, 0 thru GENERATE_MAXSEED, instead of values.
+ *  Reading stops at end of file or at an E command. Values are decoded by
+ *  the buffered reader, so the compact 002405800 layout works as well, and
+ *  so does packed input, whose "line" numbers are record numbers.
+ * Results:
+ *  Option L:
+ *      "[row][column]: values " for every empty cell, on one line.
+ *  Option C:
+ *      "Correct solution." or "Incorrect solution."
+ *  Option S:
+ *      The values of the solution, e.g. 392465817741... for 9x9 or
+ *      separated by spaces for larger puzzles, or "No solution."
+ *  Option R:
+ *      A JSON report of every rule violation. See sudokuReport.c.
+ *  Option U:
+ *      "Solutions: n, nodes: m." counting up to the limit set by
+ *      setCountOptions(), e.g. "Solutions: 2 or more, nodes: 41."
+ *  Option G:
+ *      A new puzzle with a unique solution, laid out as for option S, and
+ *      its grade, e.g. 000806010... medium. Equal seeds give equal
+ *      puzzles, however many threads share the work. See sudokuGrade.c.
+ *  Malformed values:
+ *      "Invalid value: token at line n." instead of the command's result,
+ *      or for option R a JSON object with the token and its line.
+ *  Variant rules:
+ *      Set by setRecordUnits(), options C and L follow them; the other
+ *      options give "Unsupported command for variant rules: X.".
+ ******************************************************************************/
+
+// Header
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sudokuChecker.h"
+#include "sudokuOutput.h"
+#include "sudokuReader.h"
+#include "sudokuCache.h"
+#include "sudokuVariant.h"
+#include "sudokuBatch.h"
+#include "sudokuSimd.h"
+#include "sudokuCandidates.h"
+#include "sudokuSolver.h"
+#include "sudokuReport.h"
+#include "sudokuGenerate.h"
+#include "sudokuGrade.h"
+#include "sudokuMetrics.h"
+
+// Option U: solutions to count; options S and U: threads per puzzle
+static long countLimit = 2;
+static int countThreads = 1;
+
+// Results kept for repeated grids, or NULL
+static SudokuCache *recordCache = NULL;
+
+// Units and cages of variant rules, or NULL for the classic rules
+static const UnitTable *recordUnits = NULL;
+
+/****************************** setCountOptions *********************************
+ * void setCountOptions(long limit, int threadCount);
+ * Purpose:
+ *     Sets how option U counts solutions, and how many threads options S
+ *     and U search each puzzle with, for every record that follows.
+ * Parameters:
+ *     I    limit           stop counting at this many solutions, at least 2
+ *     I    threadCount     threads searching each puzzle, at least 1
+ *******************************************************************************/
+void setCountOptions(long limit, int threadCount)
+{
+    countLimit = limit;
+    countThreads = threadCount;
+}
+
+/****************************** setRecordCache **********************************
+ * void setRecordCache(SudokuCache *cache);
+ * Purpose:
+ *     Answers options C, L and S from cache, for every record that
+ *     follows, when their grid has been seen before.
+ * Parameters:
+ *     I    cache       cache from createCache(), or NULL for none
+ *******************************************************************************/
+void setRecordCache(SudokuCache *cache)
+{
+    recordCache = cache;
+}
+
+/****************************** setRecordUnits **********************************
+ * void setRecordUnits(const UnitTable *table);
+ * Purpose:
+ *     Checks and lists possible values under variant rules, for every
+ *     record that follows.
+ * Parameters:
+ *     I    table       units and cages of the rules, of the input's order,
+ *                      or NULL for the classic rules
+ *******************************************************************************/
+void setRecordUnits(const UnitTable *table)
+{
+    recordUnits = table;
+}
+
+/****************************** formatCount *************************************
+ * void formatCount(const SudokuGrid *grid, OutputBuffer *output);
+ * Purpose:
+ *     Counts the solutions of a puzzle and appends the result of option U,
+ *     without the line break.
+ * Parameters:
+ *     I    grid        puzzle, zero for empty cells
+ *     I/O  output      buffer receiving the result
+ *******************************************************************************/
+void formatCount(const SudokuGrid *grid, OutputBuffer *output)
+{
+    long nodes;
+    long solutionCount = countSudoku(grid, countLimit, countThreads, &nodes);
+
+    outputAppendString(output, "Solutions: ");
+    outputAppendNumber(output, solutionCount);
+    if (solutionCount == countLimit)
+    {
+        outputAppendString(output, " or more");
+    }
+    outputAppendString(output, ", nodes: ");
+    outputAppendNumber(output, nodes);
+    outputAppendString(output, ".");
+    METRICS_ADD(METRIC_NODES, nodes);
+}
+
+/****************************** readBatchRecord *********************************
+ * int readBatchRecord(SudokuReader *reader, BatchRecord *record);
+ * Purpose:
+ *     Reads the next command character and, except for E, its puzzle values
+ *     or, for G, its seed.
+ * Parameters:
+ *     I/O  reader      reader to decode from
+ *     O    record      command and puzzle values read
+ * Returns
+ *     0    end of input
+ *     1    record read; record->truncated tells whether the input, or a
+ *          line starting the next record, came before its last value
+ * Notes:
+ *     A text record may span lines, but a line starting with anything
+ *     but a digit always starts a record: one with too few values ends
+ *     there, and the records after it are read as they were written.
+ *******************************************************************************/
+int readBatchRecord(SudokuReader *reader, BatchRecord *record)
+{
+    int readResult;
+
+    record->errorLine = 0;
+    record->truncated = 0;
+    if (reader->packedOrder != 0)
+    {
+        // Packed records are complete: the command and every value
+        if (readerAtEnd(reader))
+        {
+            return 0;
+        }
+        readResult = readerNextPacked(reader, &record->command,
+                &record->grid);
+    } else
+    {
+        reader->recordLines = 1;
+        if (readerNextCommand(reader, &record->command) != READER_OK)
+        {
+            return 0;
+        }
+        if (record->command == 'e' || record->command == 'E')
+        {
+            return 1;
+        }
+        record->errorLine = reader->lineNumber;
+        if (record->command == 'g' || record->command == 'G')
+        {
+            readResult = readerNextValue(reader, &record->seed,
+                    GENERATE_MAXSEED);
+        } else
+        {
+            readResult = readerNextGrid(reader, &record->grid);
+        }
+    }
+    // A record cut short gets a result line of its own
+    if (readResult == READER_EOF || readResult == READER_SHORT)
+    {
+        record->truncated = 1;
+        if (reader->packedOrder != 0)
+        {
+            record->errorLine = reader->lineNumber;
+        }
+        record->errorToken[0] = '\0';
+        return 1;
+    }
+    // Keep the first malformed token for the result line
+    record->errorLine = 0;
+    if (reader->errorCount > 0)
+    {
+        record->errorLine = reader->errorLine;
+        memcpy(record->errorToken, reader->errorToken, READER_TOKENSIZE);
+    }
+    return 1;
+}
+
+/****************************** formatCheckResult *******************************
+ * static void formatCheckResult(int correct, OutputBuffer *output);
+ * Purpose:
+ *     Appends the result of option C, without the line break.
+ * Parameters:
+ *     I    correct     1 when the solution is correct
+ *     I/O  output      buffer receiving the result
+ *******************************************************************************/
+static void formatCheckResult(int correct, OutputBuffer *output)
+{
+    if (correct != 1)
+    {
+        outputAppendString(output, "Incorrect solution.");
+    } else
+    {
+        outputAppendString(output, "Correct solution.");
+    }
+}
+
+/****************************** formatGenerated *********************************
+ * static void formatGenerated(SudokuGrid *grid, int seed,
+ *         OutputBuffer *output);
+ * Purpose:
+ *     Generates and grades a puzzle and appends the result of option G,
+ *     without the line break.
+ * Parameters:
+ *     O    grid        receives the puzzle; its order is kept
+ *     I    seed        seed of the puzzle
+ *     I/O  output      buffer receiving the result
+ *******************************************************************************/
+static void formatGenerated(SudokuGrid *grid, int seed, OutputBuffer *output)
+{
+    SudokuRandom random;
+
+    randomSeed(&random, (uint64_t)seed);
+    generateUnique(grid, &random);
+    formatGrid(grid, output, grid->size > 9 ? " " : "",
+            grid->size > 9 ? " " : "");
+    outputAppendString(output, " ");
+    outputAppendString(output, gradeName(gradePuzzle(grid)));
+}
+
+#ifdef SUDOKU_METRICS
+/****************************** countRecord *************************************
+ * static void countRecord(const BatchRecord *record, uint64_t elapsed);
+ * Purpose:
+ *     Counts a processed record in the metrics: its latency and, for
+ *     options C and R, the validation and how the solution failed.
+ * Parameters:
+ *     I    record      record just processed
+ *     I    elapsed     time it took, ns
+ *******************************************************************************/
+static void countRecord(const BatchRecord *record, uint64_t elapsed)
+{
+    if (record->command == 'c' || record->command == 'C'
+            || record->command == 'r' || record->command == 'R')
+    {
+        METRICS_ADD(METRIC_VALIDATED, 1);
+        // Rejections are counted by classic unit only
+        if (recordUnits == NULL && checkSudoku(&record->grid) != 1)
+        {
+            countRejection(&record->grid);
+        }
+    }
+    metricsTime(record->command, elapsed, 1);
+}
+#endif
+
+/****************************** runVariantCommand *******************************
+ * static void runVariantCommand(const BatchRecord *record,
+ *         OutputBuffer *output);
+ * Purpose:
+ *     Runs the command of a well formed record under variant rules and
+ *     appends its result, without the line break.
+ * Parameters:
+ *     I    record      command and puzzle values
+ *     I/O  output      buffer receiving the result
+ *******************************************************************************/
+static void runVariantCommand(const BatchRecord *record, OutputBuffer *output)
+{
+    switch (record->command)
+    {
+        case 'l':
+        case 'L':
+            formatUnitCandidates(recordUnits, &record->grid, output, "");
+            break;
+        case 'c':
+        case 'C':
+            formatCheckResult(checkUnits(recordUnits, &record->grid), output);
+            break;
+        case 'r':
+        case 'R':
+        case 's':
+        case 'S':
+        case 'u':
+        case 'U':
+        case 'g':
+        case 'G':
+            outputAppendString(output,
+                    "Unsupported command for variant rules: ");
+            outputAppend(output, &record->command, 1);
+            outputAppendString(output, ".");
+            break;
+        default:
+            outputAppendString(output, "Invalid command: ");
+            outputAppend(output, &record->command, 1);
+            outputAppendString(output, ".");
+            break;
+    }
+}
+
+/****************************** runCommand **************************************
+ * static int runCommand(BatchRecord *record, OutputBuffer *output);
+ * Purpose:
+ *     Runs the command of a well formed record and appends its result,
+ *     without the line break.
+ * Parameters:
+ *     I/O  record      command and puzzle values; option S leaves the
+ *                      solution in the grid
+ *     I/O  output      buffer receiving the result
+ * Returns
+ *     For option S, 1 when the puzzle was solved; else 0
+ *******************************************************************************/
+static int runCommand(BatchRecord *record, OutputBuffer *output)
+{
+    long nodes;
+    int solved = 0;
+
+    if (recordUnits != NULL)
+    {
+        runVariantCommand(record, output);
+        return 0;
+    }
+    switch (record->command)
+    {
+        case 'l':
+        case 'L':
+            formatCandidates(&record->grid, output, "");
+            break;
+        case 'c':
+        case 'C':
+            formatCheckResult(checkSudoku(&record->grid), output);
+            break;
+        case 'r':
+        case 'R':
+            formatReport(&record->grid, output);
+            break;
+        case 'u':
+        case 'U':
+            formatCount(&record->grid, output);
+            break;
+        case 'g':
+        case 'G':
+            formatGenerated(&record->grid, record->seed, output);
+            break;
+        case 's':
+        case 'S':
+            solved = solveSudokuParallel(&record->grid, countThreads, &nodes)
+                == SOLVE_SOLVED;
+            if (solved)
+            {
+                // One digit per value up to 9x9, else space separated
+                formatGrid(&record->grid, output,
+                        record->grid.size > 9 ? " " : "",
+                        record->grid.size > 9 ? " " : "");
+            } else
+            {
+                outputAppendString(output, "No solution.");
+            }
+            METRICS_ADD(METRIC_NODES, nodes);
+            break;
+        default:
+            outputAppendString(output, "Invalid command: ");
+            outputAppend(output, &record->command, 1);
+            outputAppendString(output, ".");
+            break;
+    }
+    return solved;
+}
+
+/****************************** runCached ***************************************
+ * static void runCached(BatchRecord *record, OutputBuffer *output);
+ * Purpose:
+ *     Appends the result of option C, L or S from the cache, or runs the
+ *     command and keeps its result there.
+ * Parameters:
+ *     I/O  record      command and puzzle values
+ *     I/O  output      buffer receiving the result, without the line break
+ * Notes:
+ *     C and L results are kept as their text. S results are kept as a
+ *     solved flag and the solution in the frame of the key, so a puzzle
+ *     equivalent under symmetry gets the solution mapped back to its own
+ *     frame. L text names cells, so L keys are never taken up to symmetry,
+ *     and neither is any key under variant rules, which few symmetries keep.
+ *     A solution is kept under a key taken up to symmetry only when it is
+ *     the puzzle's only one: otherwise the solution printed would depend on
+ *     which equivalent puzzle was solved first.
+ *******************************************************************************/
+static void runCached(BatchRecord *record, OutputBuffer *output)
+{
+    const int solving = record->command == 's' || record->command == 'S';
+    const int canonical = recordCache->canonical && recordUnits == NULL
+        && record->command != 'l' && record->command != 'L';
+    const size_t start = output->length;
+    unsigned char solution[MAXCELLS + 1];
+    SudokuCell puzzleCells[MAXCELLS];
+    SudokuGrid puzzle;
+    unsigned char *payload;
+    size_t length;
+    long nodes;
+    CacheKey key;
+
+    cacheKey(recordCache, &record->grid, record->command, canonical, &key);
+    outputReserve(output, recordCache->payloadSize);
+    payload = (unsigned char *)output->data + start;
+    if (cacheFind(recordCache, &key, payload, &length))
+    {
+        METRICS_ADD(METRIC_CACHEHITS, 1);
+        if (!solving)
+        {
+            output->length += length;
+        } else if (payload[0])
+        {
+            cacheFromKey(&key.transform, payload + 1, &record->grid);
+            formatGrid(&record->grid, output, record->grid.size > 9 ? " " : "",
+                    record->grid.size > 9 ? " " : "");
+        } else
+        {
+            outputAppendString(output, "No solution.");
+        }
+        return;
+    }
+    METRICS_ADD(METRIC_CACHEMISSES, 1);
+    if (!solving)
+    {
+        runCommand(record, output);
+        cacheStore(recordCache, &key, (unsigned char *)output->data + start,
+                output->length - start);
+        return;
+    }
+    if (canonical)
+    {
+        initGrid(&puzzle, record->grid.order, puzzleCells);
+        memcpy(puzzleCells, record->grid.cells,
+                sizeof(SudokuCell) * record->grid.size * record->grid.size);
+    }
+    solution[0] = (unsigned char)runCommand(record, output);
+    length = 1;
+    if (solution[0])
+    {
+        if (canonical && countSolutions(&puzzle, 2, &nodes) != 1)
+        {
+            return; // one of several solutions: not for equivalent puzzles
+        }
+        cacheToKey(&key.transform, &record->grid, solution + 1);
+        length += record->grid.size * record->grid.size;
+    }
+    cacheStore(recordCache, &key, solution, length);
+}
+
+/****************************** processRecord ***********************************
+ * void processRecord(BatchRecord *record, OutputBuffer *output);
+ * Purpose:
+ *     Runs the command of one record and appends its result line.
+ * Parameters:
+ *     I    record      command and puzzle values
+ *     I/O  output      buffer receiving the result line
+ *******************************************************************************/
+void processRecord(BatchRecord *record, OutputBuffer *output)
+{
+#ifdef SUDOKU_METRICS
+    uint64_t started = metricsNow();
+#endif
+
+    if (record->truncated
+            && (record->command == 'r' || record->command == 'R'))
+    {
+        formatReportTruncated(record->errorLine, output);
+        outputAppendString(output, "\n");
+        return;
+    }
+    if (record->truncated)
+    {
+        outputAppendString(output, "Record ended before every value at line ");
+        outputAppendNumber(output, record->errorLine);
+        outputAppendString(output, ".\n");
+        return;
+    }
+    if (record->errorLine != 0
+            && (record->command == 'r' || record->command == 'R'))
+    {
+        formatReportError(record->errorToken, record->errorLine, output);
+        outputAppendString(output, "\n");
+        return;
+    }
+    if (record->errorLine != 0)
+    {
+        outputAppendString(output, "Invalid value: ");
+        outputAppendString(output, record->errorToken);
+        outputAppendString(output, " at line ");
+        outputAppendNumber(output, record->errorLine);
+        outputAppendString(output, ".\n");
+        return;
+    }
+    if (recordCache != NULL && strchr("cClLsS", record->command) != NULL)
+    {
+        runCached(record, output);
+    } else
+    {
+        runCommand(record, output);
+    }
+    outputAppendString(output, "\n");
+#ifdef SUDOKU_METRICS
+    countRecord(record, metricsNow() - started);
+#endif
+}
+
+/****************************** initBatchChunk **********************************
+ * void initBatchChunk(BatchChunk *chunk, int order);
+ * Purpose:
+ *     Allocates the cells of a chunk for puzzles of the given box order.
+ * Parameters:
+ *     O    chunk       chunk to initialize
+ *     I    order       box order of every puzzle in the input
+ * Notes:
+ *     Exits with ERROR_PROCESSING when memory is exhausted.
+ *******************************************************************************/
+void initBatchChunk(BatchChunk *chunk, int order)
+{
+    int cellCount = order * order * order * order;
+    int recordIndex;
+
+    chunk->cells = malloc(sizeof(SudokuCell) * cellCount * BATCH_CHUNKRECORDS);
+    if (chunk->cells == NULL)
+    {
+        exitError("Out of memory.");
+    }
+    for (recordIndex = 0; recordIndex < BATCH_CHUNKRECORDS; recordIndex++)
+    {
+        initGrid(&chunk->records[recordIndex].grid, order,
+                chunk->cells + recordIndex * cellCount);
+    }
+    chunk->recordCount = 0;
+    outputInit(&chunk->output);
+}
+
+/****************************** freeBatchChunk **********************************
+ * void freeBatchChunk(BatchChunk *chunk);
+ * Purpose:
+ *     Releases the cells and output buffer of a chunk.
+ * Parameters:
+ *     I/O  chunk       chunk to release
+ *******************************************************************************/
+void freeBatchChunk(BatchChunk *chunk)
+{
+    free(chunk->cells);
+    chunk->cells = NULL;
+    outputFree(&chunk->output);
+}
+
+/****************************** readBatchChunk **********************************
+ * int readBatchChunk(SudokuReader *reader, BatchChunk *chunk);
+ * Purpose:
+ *     Reads up to BATCH_CHUNKRECORDS records into chunk.
+ * Parameters:
+ *     I/O  reader      reader over the stream of records
+ *     O    chunk       records read; recordCount is set
+ * Returns
+ *     0    end of input or E command reached; the chunk may still hold
+ *          records read before it
+ *     1    chunk is full and more input may follow
+ *******************************************************************************/
+int readBatchChunk(SudokuReader *reader, BatchChunk *chunk)
+{
+    BatchRecord *record;
+
+    chunk->recordCount = 0;
+    while (chunk->recordCount < BATCH_CHUNKRECORDS)
+    {
+        record = &chunk->records[chunk->recordCount];
+        if (!readBatchRecord(reader, record)
+                || record->command == 'e' || record->command == 'E')
+        {
+            return 0;
+        }
+        chunk->recordCount++;
+    }
+    return 1;
+}
+
+/****************************** processBatchChunk *******************************
+ * void processBatchChunk(BatchChunk *chunk);
+ * Purpose:
+ *     Replaces the chunk's output with the result lines of its records.
+ * Parameters:
+ *     I/O  chunk       records to process
+ * Notes:
+ *     The well formed C records of the chunk are checked together by
+ *     checkSudokuGrids() before the result lines are assembled, unless
+ *     they are answered from the record cache or follow variant rules.
+ *******************************************************************************/
+void processBatchChunk(BatchChunk *chunk)
+{
+    const SudokuGrid *grids[BATCH_CHUNKRECORDS];
+    unsigned char results[BATCH_CHUNKRECORDS];
+    const int batched = recordCache == NULL && recordUnits == NULL;
+    BatchRecord *record;
+    int recordIndex;
+    int gridCount = 0;
+#ifdef SUDOKU_METRICS
+    uint64_t started;
+#endif
+
+    // Check every C record at once
+    for (recordIndex = 0; recordIndex < chunk->recordCount; recordIndex++)
+    {
+        record = &chunk->records[recordIndex];
+        if (batched && (record->command == 'c' || record->command == 'C')
+                && record->errorLine == 0)
+        {
+            grids[gridCount++] = &record->grid;
+        }
+    }
+#ifdef SUDOKU_METRICS
+    started = metricsNow();
+#endif
+    checkSudokuGrids(grids, gridCount, results);
+#ifdef SUDOKU_METRICS
+    metricsTime('C', metricsNow() - started, gridCount);
+    METRICS_ADD(METRIC_VALIDATED, gridCount);
+    for (recordIndex = 0; recordIndex < gridCount; recordIndex++)
+    {
+        if (results[recordIndex] != 1)
+        {
+            countRejection(grids[recordIndex]);
+        }
+    }
+#endif
+
+    // Assemble the result lines in record order
+    chunk->output.length = 0;
+    gridCount = 0;
+    for (recordIndex = 0; recordIndex < chunk->recordCount; recordIndex++)
+    {
+        record = &chunk->records[recordIndex];
+        if (batched && (record->command == 'c' || record->command == 'C')
+                && record->errorLine == 0)
+        {
+            formatCheckResult(results[gridCount++], &chunk->output);
+            outputAppendString(&chunk->output, "\n");
+        } else
+        {
+            processRecord(record, &chunk->output);
+        }
+    }
+}
+
+/****************************** runBatch ****************************************
+ * void runBatch(SudokuReader *reader, int order);
+ * Purpose:
+ *     Processes every record of the input and writes one result line per
+ *     record to stdout.
+ * Parameters:
+ *     I/O  reader      reader over the stream of records
+ *     I    order       box order of every puzzle in the input
+ * Notes:
+ *     One chunk and its output buffer are reused for the whole stream.
+ *******************************************************************************/
+void runBatch(SudokuReader *reader, int order)
+{
+    BatchChunk *chunk = malloc(sizeof(BatchChunk));
+    int moreInput = 1;
+
+    if (chunk == NULL)
+    {
+        exitError("Out of memory.");
+    }
+    initBatchChunk(chunk, order);
+    while (moreInput)
+    {
+        moreInput = readBatchChunk(reader, chunk);
+        processBatchChunk(chunk);
+        outputFlush(&chunk->output, stdout);
+    }
+    fflush(stdout);
+    freeBatchChunk(chunk);
+    free(chunk);
+}
@@ -0,0 +1,57 @@
+/*******************************************************************************
+ * sudokuBatch.h by Geoffrey Sessums
+ * Purpose:
+ *   Defines the batch record, one command character and its puzzle values
+ *   (or seed), and the chunk of records handed to a worker at a time.
+ *   Prototypes
+ * Notes:
+ *   Requires sudokuChecker.h, sudokuOutput.h, sudokuReader.h,
+ *   sudokuCache.h and sudokuVariant.h
+ *******************************************************************************/
+#ifndef SUDOKUBATCH_H
+#define SUDOKUBATCH_H
+
+// One command and the grid it applies to
+typedef struct
+{
+    char command;
+    SudokuGrid grid;                    // cells live in the chunk
+    int seed;                           // G: seed instead of a grid
+    long errorLine;                     // line of the first malformed token,
+    char errorToken[READER_TOKENSIZE];  // or 0 when the grid is well formed
+    int truncated;                      // input or the next record came
+                                        // within the record, which starts
+                                        // at errorLine
+} BatchRecord;
+
+// Number of records read, processed and written together
+#define BATCH_CHUNKRECORDS 256
+
+// A run of consecutive records and their result lines
+typedef struct
+{
+    long sequence;              // position of the chunk within the input
+    int recordCount;
+    BatchRecord records[BATCH_CHUNKRECORDS];
+    SudokuCell *cells;          // cells of all records, order^4 each
+    OutputBuffer output;        // result lines of all records, in order
+} BatchChunk;
+
+// Prototypes
+int readBatchRecord(SudokuReader *reader, BatchRecord *record);
+void processRecord(BatchRecord *record, OutputBuffer *output);
+void setCountOptions(long limit, int threadCount);
+void setRecordCache(SudokuCache *cache);
+void setRecordUnits(const UnitTable *table);
+void formatCount(const SudokuGrid *grid, OutputBuffer *output);
+void initBatchChunk(BatchChunk *chunk, int order);
+void freeBatchChunk(BatchChunk *chunk);
+int readBatchChunk(SudokuReader *reader, BatchChunk *chunk);
+void processBatchChunk(BatchChunk *chunk);
+void runBatch(SudokuReader *reader, int order);
+void runParallelBatch(SudokuReader *reader, int threadCount, int order);
+void runFileBatch(char *paths[], int pathCount, int order);
+int openServerSocket(const char *path, int port);
+void runServer(int listenFd, int threadCount, int order);
+
+#endif
@@ -0,0 +1,444 @@
+/*******************************************************************************
+ * sudokuBench.c by Geoffrey Sessums
+ * Purpose:
+ *  Measures the speed of the batch pipeline on generated corpora, or writes
+ *  a generated corpus for use with sudokuChecker -b.
+ * Command Parameters:
+ *  ./sudokuBench [-n order] [-c count] [-k clues] [-i percent] [-s seed]
+ *      Times parsing, option C, option L and option S separately.
+ *  ./sudokuBench -g command [...]
+ *      Writes count records of the command (C, L or S) to stdout instead.
+ *  -n  box order, 2 thru 6; default 3
+ *  -c  number of records per corpus; default 100000 for 9x9, and as many
+ *      cells' worth of records for other box orders
+ *  -k  clues left in L and S puzzles; default 30 for 9x9, else half
+ *      the cells
+ *  -i  percentage of broken solutions in the C corpus; default 50
+ *  -s  random seed; the same seed always builds the same corpus
+ * Results:
+ *  One line per stage: records, records per second, the mean ns per record
+ *  and the 50th, 90th and 99th percentile ns per record.
+ * Notes:
+ *  The corpus is generated as text in memory and decoded with a memory
+ *  reader, so no file I/O is timed. Records are timed a chunk at a time
+ *  (BATCH_CHUNKRECORDS records, as in sudokuChecker -b); the percentiles
+ *  are over chunks, which keeps the clock's own cost out of the numbers.
+ *  Result lines are assembled but not written.
+ ******************************************************************************/
+
+// Header
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sudokuChecker.h"
+#include "sudokuOutput.h"
+#include "sudokuReader.h"
+#include "sudokuCache.h"
+#include "sudokuVariant.h"
+#include "sudokuBatch.h"
+#include "sudokuGenerate.h"
+
+#define USAGE "Usage: sudokuBench [-g command] [-n order] [-c count] " \
+    "[-k clues] [-i percent] [-s seed]"
+
+// Timings of one stage
+typedef struct
+{
+    const char *name;
+    long recordCount;
+    double seconds;         // total time of all chunks
+    double *samples;        // ns per record of each chunk
+    int sampleCount;
+} BenchStage;
+
+static SudokuReader reader; // memory reader over the corpus
+
+static double now(void);
+static void buildCorpus(char command, int order, long count, int clueCount,
+        int invalidPercent, SudokuRandom *random, OutputBuffer *corpus);
+static void packCorpus(const OutputBuffer *corpus, int order,
+        OutputBuffer *packed);
+static BatchChunk *loadCorpus(const OutputBuffer *corpus, const char *name,
+        int order, long count, int *chunkCount, BenchStage *stage);
+static void freeChunks(BatchChunk chunks[], int chunkCount);
+static void setCommand(BatchChunk chunks[], int chunkCount, char command);
+static void timeChunks(BatchChunk chunks[], int chunkCount, BenchStage *stage);
+static void initStage(BenchStage *stage, const char *name, int chunkCount);
+static void reportStage(BenchStage *stage);
+
+// Main Program
+int main(int argc, char *argv[])
+{
+    int order = DEFAULTORDER;
+    long count = 0;
+    int clueCount = -1;
+    int invalidPercent = 50;
+    unsigned long long seed = 1;
+    char generateCommand = 0;
+    int option;
+    SudokuRandom random;
+    OutputBuffer corpus;
+    OutputBuffer packed;
+    BatchChunk *chunks;
+    int chunkCount;
+    BenchStage stage;
+
+    // Process command options
+    while ((option = getopt(argc, argv, "g:n:c:k:i:s:")) != -1)
+    {
+        switch (option)
+        {
+            case 'g':
+                generateCommand = optarg[0];
+                break;
+            case 'n':
+                order = (int)parseNumber(optarg, MINORDER, MAXORDER,
+                        "Box order must be 2 thru 6.");
+                break;
+            case 'c':
+                count = parseNumber(optarg, 1, LONG_MAX,
+                        "Count must be 1 or more.");
+                break;
+            case 'k':
+                clueCount = (int)parseNumber(optarg, 0, MAXCELLS,
+                        "Too many clues for the box order.");
+                break;
+            case 'i':
+                invalidPercent = (int)parseNumber(optarg, 0, 100,
+                        "Percent must be 0 thru 100.");
+                break;
+            case 's':
+                seed = strtoull(optarg, NULL, 10);
+                break;
+            default:
+                exitError(USAGE);
+        }
+    }
+    if (optind != argc || (generateCommand != 0
+                && strchr("CLScls", generateCommand) == NULL))
+    {
+        exitError(USAGE);
+    }
+    if (count == 0)
+    {
+        count = 8100000 / (order * order * order * order);
+    }
+    if (clueCount < 0)
+    {
+        clueCount = order == 3 ? 30 : order * order * order * order / 2;
+    }
+    if (clueCount > order * order * order * order)
+    {
+        exitError("Too many clues for the box order.");
+    }
+    randomSeed(&random, seed);
+    outputInit(&corpus);
+
+    // Write a corpus instead of timing
+    if (generateCommand != 0)
+    {
+        buildCorpus(generateCommand, order, count, clueCount, invalidPercent,
+                &random, &corpus);
+        outputFlush(&corpus, stdout);
+        fflush(stdout);
+        outputFree(&corpus);
+        return 0;
+    }
+
+    printf("order %d, %ld records, %d clues, %d%% invalid, seed %llu\n",
+            order, count, clueCount, invalidPercent, seed);
+    printf("%-6s %10s %14s %10s %10s %10s %10s\n", "stage", "records",
+            "records/sec", "ns/record", "p50", "p90", "p99");
+
+    // Parsing and option C on solutions, some of them broken
+    buildCorpus('C', order, count, clueCount, invalidPercent, &random, &corpus);
+    chunks = loadCorpus(&corpus, "parse", order, count, &chunkCount, &stage);
+    reportStage(&stage);
+    freeChunks(chunks, chunkCount);
+
+    // The same records in the packed format
+    outputInit(&packed);
+    packCorpus(&corpus, order, &packed);
+    chunks = loadCorpus(&packed, "unpack", order, count, &chunkCount, &stage);
+    outputFree(&packed);
+    reportStage(&stage);
+    initStage(&stage, "C", chunkCount);
+    timeChunks(chunks, chunkCount, &stage);
+    reportStage(&stage);
+    freeChunks(chunks, chunkCount);
+
+    // Options L and S on puzzles
+    buildCorpus('L', order, count, clueCount, invalidPercent, &random, &corpus);
+    chunks = loadCorpus(&corpus, "parse", order, count, &chunkCount, &stage);
+    free(stage.samples);
+    initStage(&stage, "L", chunkCount);
+    timeChunks(chunks, chunkCount, &stage);
+    reportStage(&stage);
+    setCommand(chunks, chunkCount, 'S');
+    initStage(&stage, "S", chunkCount);
+    timeChunks(chunks, chunkCount, &stage);
+    reportStage(&stage);
+    freeChunks(chunks, chunkCount);
+    outputFree(&corpus);
+    return 0;
+} // end of main
+
+/****************************** now *********************************************
+ * static double now(void);
+ * Purpose:
+ *     Reads the monotonic clock.
+ * Returns
+ *     Seconds since an arbitrary starting point
+ *******************************************************************************/
+static double now(void)
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+}
+
+/****************************** buildCorpus *************************************
+ * static void buildCorpus(char command, int order, long count, int clueCount,
+ *         int invalidPercent, SudokuRandom *random, OutputBuffer *corpus);
+ * Purpose:
+ *     Replaces corpus with count generated batch records of one command.
+ * Parameters:
+ *     I    command         C for solutions, L or S for puzzles
+ *     I    order           box order
+ *     I    count           number of records
+ *     I    clueCount       values left in each puzzle
+ *     I    invalidPercent  percentage of broken solutions for C
+ *     I/O  random          generator
+ *     O    corpus          records, one per line
+ *******************************************************************************/
+static void buildCorpus(char command, int order, long count, int clueCount,
+        int invalidPercent, SudokuRandom *random, OutputBuffer *corpus)
+{
+    SudokuCell cells[MAXCELLS];
+    SudokuGrid grid;
+    long recordIndex;
+
+    initGrid(&grid, order, cells);
+    corpus->length = 0;
+    for (recordIndex = 0; recordIndex < count; recordIndex++)
+    {
+        if (command == 'c' || command == 'C')
+        {
+            if (randomBelow(random, 100) < invalidPercent)
+            {
+                generateInvalid(&grid, random);
+            } else
+            {
+                generateSolution(&grid, random);
+            }
+        } else
+        {
+            generatePuzzle(&grid, clueCount, random);
+        }
+        formatRecord(command, &grid, corpus);
+    }
+}
+
+/****************************** packCorpus **************************************
+ * static void packCorpus(const OutputBuffer *corpus, int order,
+ *         OutputBuffer *packed);
+ * Purpose:
+ *     Converts a corpus of text records to the packed format, as
+ *     sudokuConvert would.
+ * Parameters:
+ *     I    corpus      text batch records
+ *     I    order       box order of the records
+ *     O    packed      header and packed records
+ *******************************************************************************/
+static void packCorpus(const OutputBuffer *corpus, int order,
+        OutputBuffer *packed)
+{
+    SudokuCell cells[MAXCELLS];
+    BatchRecord record;
+
+    initGrid(&record.grid, order, cells);
+    readerInitMemory(&reader, corpus->data, corpus->length);
+    formatPackedHeader(order, packed);
+    while (readBatchRecord(&reader, &record))
+    {
+        formatPackedRecord(record.command, &record.grid, packed);
+    }
+    readerClose(&reader);
+}
+
+/****************************** loadCorpus **************************************
+ * static BatchChunk *loadCorpus(const OutputBuffer *corpus, const char *name,
+ *         int order, long count, int *chunkCount, BenchStage *stage);
+ * Purpose:
+ *     Decodes every record of a corpus, text or packed, into chunks, timing
+ *     each chunk.
+ * Parameters:
+ *     I    corpus      batch records
+ *     I    name        name of the stage
+ *     I    order       box order of the records
+ *     I    count       number of records in the corpus
+ *     O    chunkCount  number of chunks holding records
+ *     O    stage       parse timings; stage->samples must be freed
+ * Returns
+ *     Array of chunkCount chunks, each released with freeBatchChunk()
+ *******************************************************************************/
+static BatchChunk *loadCorpus(const OutputBuffer *corpus, const char *name,
+        int order, long count, int *chunkCount, BenchStage *stage)
+{
+    int chunkLimit = (int)(count / BATCH_CHUNKRECORDS) + 1;
+    BatchChunk *chunks = malloc(sizeof(BatchChunk) * chunkLimit);
+    int moreInput = 1;
+    double start;
+    double elapsed;
+
+    if (chunks == NULL)
+    {
+        exitError("Out of memory.");
+    }
+    initStage(stage, name, chunkLimit);
+    readerInitMemory(&reader, corpus->data, corpus->length);
+    readerDetectPacked(&reader);
+    *chunkCount = 0;
+    while (moreInput && *chunkCount < chunkLimit)
+    {
+        initBatchChunk(&chunks[*chunkCount], order);
+        start = now();
+        moreInput = readBatchChunk(&reader, &chunks[*chunkCount]);
+        elapsed = now() - start;
+        if (chunks[*chunkCount].recordCount == 0)
+        {
+            freeBatchChunk(&chunks[*chunkCount]);
+            break;
+        }
+        stage->seconds += elapsed;
+        stage->recordCount += chunks[*chunkCount].recordCount;
+        stage->samples[stage->sampleCount++] =
+            elapsed * 1e9 / chunks[*chunkCount].recordCount;
+        (*chunkCount)++;
+    }
+    readerClose(&reader);
+    return chunks;
+}
+
+/****************************** freeChunks **************************************
+ * static void freeChunks(BatchChunk chunks[], int chunkCount);
+ * Purpose:
+ *     Releases the chunks returned by loadCorpus().
+ *******************************************************************************/
+static void freeChunks(BatchChunk chunks[], int chunkCount)
+{
+    int chunkIndex;
+
+    for (chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+    {
+        freeBatchChunk(&chunks[chunkIndex]);
+    }
+    free(chunks);
+}
+
+/****************************** setCommand **************************************
+ * static void freeChunks(BatchChunk chunks[], int chunkCount);
+static void setCommand(BatchChunk chunks[], int chunkCount, char command);
+ * Purpose:
+ *     Gives every decoded record the same command, so one corpus of
+ *     puzzles serves both L and S.
+ *******************************************************************************/
+static void setCommand(BatchChunk chunks[], int chunkCount, char command)
+{
+    int chunkIndex;
+    int recordIndex;
+
+    for (chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+    {
+        for (recordIndex = 0; recordIndex < chunks[chunkIndex].recordCount;
+                recordIndex++)
+        {
+            chunks[chunkIndex].records[recordIndex].command = command;
+        }
+    }
+}
+
+/****************************** timeChunks **************************************
+ * static void timeChunks(BatchChunk chunks[], int chunkCount,
+ *         BenchStage *stage);
+ * Purpose:
+ *     Processes every chunk as sudokuChecker -b would, timing each chunk.
+ * Parameters:
+ *     I/O  chunks      decoded records; S records are solved in place
+ *     I    chunkCount  number of chunks
+ *     I/O  stage       receives the timings
+ *******************************************************************************/
+static void timeChunks(BatchChunk chunks[], int chunkCount, BenchStage *stage)
+{
+    int chunkIndex;
+    double start;
+    double elapsed;
+
+    for (chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+    {
+        start = now();
+        processBatchChunk(&chunks[chunkIndex]);
+        elapsed = now() - start;
+        stage->seconds += elapsed;
+        stage->recordCount += chunks[chunkIndex].recordCount;
+        stage->samples[stage->sampleCount++] =
+            elapsed * 1e9 / chunks[chunkIndex].recordCount;
+    }
+}
+
+/****************************** initStage ***************************************
+ * static void initStage(BenchStage *stage, const char *name, int chunkCount);
+ * Purpose:
+ *     Prepares an empty stage with room for one sample per chunk.
+ *******************************************************************************/
+static void initStage(BenchStage *stage, const char *name, int chunkCount)
+{
+    stage->name = name;
+    stage->recordCount = 0;
+    stage->seconds = 0;
+    stage->sampleCount = 0;
+    stage->samples = malloc(sizeof(double) * chunkCount);
+    if (stage->samples == NULL)
+    {
+        exitError("Out of memory.");
+    }
+}
+
+/****************************** compareSamples **********************************
+ * static int compareSamples(const void *first, const void *second);
+ * Purpose:
+ *     Orders samples from fastest to slowest for qsort.
+ *******************************************************************************/
+static int compareSamples(const void *first, const void *second)
+{
+    double difference = *(const double *)first - *(const double *)second;
+
+    return (difference > 0) - (difference < 0);
+}
+
+/****************************** reportStage *************************************
+ * static void reportStage(BenchStage *stage);
+ * Purpose:
+ *     Prints the result line of a stage and releases its samples.
+ * Notes:
+ *     Percentiles are nearest rank over the chunk samples.
+ *******************************************************************************/
+static void reportStage(BenchStage *stage)
+{
+    const int count = stage->sampleCount;
+
+    qsort(stage->samples, count, sizeof(double), compareSamples);
+    printf("%-6s %10ld %14.0f %10.1f %10.1f %10.1f %10.1f\n", stage->name,
+            stage->recordCount, stage->recordCount / stage->seconds,
+            stage->seconds * 1e9 / stage->recordCount,
+            stage->samples[(count - 1) * 50 / 100],
+            stage->samples[(count - 1) * 90 / 100],
+            stage->samples[(count - 1) * 99 / 100]);
+    fflush(stdout);
+    free(stage->samples);
+    stage->samples = NULL;
+}
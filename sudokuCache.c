@@ -0,0 +1,523 @@
+/*******************************************************************************
+ * sudokuCache.c by Geoffrey Sessums
+ * Purpose:
+ *  Keeps the results of recent grids in a fixed amount of memory, so a
+ *  grid submitted again is answered without being checked or solved again.
+ * Notes:
+ *  The table is split into CACHE_STRIPES stripes, each with its own lock.
+ *  A key hashes to a stripe and to a window of CACHE_PROBES consecutive
+ *  entries within it (open addressing). When the window is full, CLOCK
+ *  picks the victim: the hand sweeps the window, giving every entry used
+ *  since the last sweep a second chance.
+ *  Each entry is a CacheEntry, then the key cells, then the result bytes:
+ *      | hash, length, command, flags | cells[size^2] | payload |
+ *  Keys may be taken up to symmetry. The grid is then brought to a
+ *  standard frame: the bands and the rows within each band are ordered by
+ *  a weight that no symmetry changes (the values a row holds, then how
+ *  full the columns and how common the digits of those values are), the
+ *  same for stacks and columns, the smaller of the grid and its transpose
+ *  is kept, and the digits are renumbered in order of first appearance.
+ *  Each step maps a grid to an equivalent one, so the transform can be
+ *  undone on a cached solution; ties keep their original order, so some
+ *  equivalent grids still get keys of their own.
+ ******************************************************************************/
+
+// Header
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "sudokuChecker.h"
+#include "sudokuCache.h"
+
+// Header of every entry
+typedef struct
+{
+    uint64_t hash;
+    uint32_t length;            // payload bytes
+    char command;
+    unsigned char used;
+    unsigned char referenced;   // looked up since the clock hand passed
+} CacheEntry;
+
+/****************************** createCache *************************************
+ * SudokuCache *createCache(int order, size_t bytes, int canonical);
+ * Purpose:
+ *     Allocates an empty cache for puzzles of one box order.
+ * Parameters:
+ *     I    order       box order of every puzzle
+ *     I    bytes       memory to use for entries
+ *     I    canonical   1 to take keys up to symmetry
+ * Returns
+ *     The cache
+ * Notes:
+ *     The entries per stripe are rounded down to a power of 2. Exits with
+ *     ERROR_PROCESSING when bytes cannot hold CACHE_PROBES entries per
+ *     stripe or memory is exhausted.
+ *******************************************************************************/
+SudokuCache *createCache(int order, size_t bytes, int canonical)
+{
+    const size_t cellCount = (size_t)order * order * order * order;
+    SudokuCache *cache = malloc(sizeof(SudokuCache));
+    long stripeEntries = CACHE_PROBES;
+    int stripe;
+
+    if (cache == NULL)
+    {
+        exitError("Out of memory.");
+    }
+    cache->order = order;
+    cache->canonical = canonical;
+    cache->payloadSize = cellCount * CACHE_PAYLOADPERCELL;
+    cache->entrySize = (sizeof(CacheEntry) + cellCount + cache->payloadSize
+            + 7) & ~(size_t)7;
+    if (bytes / cache->entrySize < CACHE_STRIPES * CACHE_PROBES)
+    {
+        exitError("Cache size is too small.");
+    }
+    while ((size_t)stripeEntries * 2 * CACHE_STRIPES * cache->entrySize
+            <= bytes)
+    {
+        stripeEntries *= 2;
+    }
+    cache->stripeEntries = stripeEntries;
+    cache->entries = calloc((size_t)stripeEntries * CACHE_STRIPES,
+            cache->entrySize);
+    if (cache->entries == NULL)
+    {
+        exitError("Out of memory.");
+    }
+    for (stripe = 0; stripe < CACHE_STRIPES; stripe++)
+    {
+        pthread_mutex_init(&cache->locks[stripe], NULL);
+        cache->hands[stripe] = 0;
+    }
+    return cache;
+}
+
+/****************************** hashBytes ***************************************
+ * static uint64_t hashBytes(const unsigned char *bytes, size_t length);
+ * Purpose:
+ *     Hashes a key 8 bytes at a time with multiply and xor-shift steps.
+ *******************************************************************************/
+static uint64_t hashBytes(const unsigned char *bytes, size_t length)
+{
+    uint64_t hash = 0x9E3779B97F4A7C15ULL ^ length;
+    uint64_t word;
+    size_t position;
+
+    for (position = 0; position + 8 <= length; position += 8)
+    {
+        memcpy(&word, bytes + position, 8);
+        hash = (hash ^ word) * 0xBF58476D1CE4E5B9ULL;
+        hash ^= hash >> 31;
+    }
+    word = 0;
+    memcpy(&word, bytes + position, length - position);
+    hash = (hash ^ word) * 0x94D049BB133111EBULL;
+    return hash ^ (hash >> 29);
+}
+
+/****************************** orderLines **************************************
+ * static void orderLines(const int counts[], int order, unsigned char lines[]);
+ * Purpose:
+ *     Orders the rows (or columns) of a grid by weight, heaviest first: the
+ *     bands by their total, the rows within each band by their own weight.
+ *     Ties keep their original order.
+ * Parameters:
+ *     I    counts      weight of every row
+ *     I    order       box order
+ *     O    lines       lines[n] is the original row placed at row n
+ *******************************************************************************/
+static void orderLines(const int counts[], int order, unsigned char lines[])
+{
+    int bands[MAXORDER];
+    int bandCounts[MAXORDER] = {0};
+    int within[MAXORDER];
+    int band;
+    int line;
+    int index;
+    int swap;
+
+    for (band = 0; band < order; band++)
+    {
+        bands[band] = band;
+        for (line = 0; line < order; line++)
+        {
+            bandCounts[band] += counts[band * order + line];
+        }
+    }
+    // Insertion sorts: at most 6 items, and stable
+    for (band = 1; band < order; band++)
+    {
+        swap = bands[band];
+        for (index = band; index > 0 && bandCounts[bands[index - 1]]
+                < bandCounts[swap]; index--)
+        {
+            bands[index] = bands[index - 1];
+        }
+        bands[index] = swap;
+    }
+    for (band = 0; band < order; band++)
+    {
+        for (line = 0; line < order; line++)
+        {
+            within[line] = bands[band] * order + line;
+        }
+        for (line = 1; line < order; line++)
+        {
+            swap = within[line];
+            for (index = line; index > 0 && counts[within[index - 1]]
+                    < counts[swap]; index--)
+            {
+                within[index] = within[index - 1];
+            }
+            within[index] = swap;
+        }
+        for (line = 0; line < order; line++)
+        {
+            lines[band * order + line] = (unsigned char)within[line];
+        }
+    }
+}
+
+/****************************** orientedValue ***********************************
+ * static int orientedValue(const SudokuGrid *grid, int transposed, int row,
+ *         int column);
+ * Purpose:
+ *     Value of a cell of the grid, or of its transpose.
+ *******************************************************************************/
+static int orientedValue(const SudokuGrid *grid, int transposed, int row,
+        int column)
+{
+    return transposed ? grid->cells[column * grid->size + row]
+        : grid->cells[row * grid->size + column];
+}
+
+/****************************** standardFrame ***********************************
+ * static void standardFrame(const SudokuGrid *grid, int transposed,
+ *         CacheTransform *transform, unsigned char values[]);
+ * Purpose:
+ *     Builds the transform to the standard frame of one orientation of a
+ *     grid, and the grid in that frame.
+ *******************************************************************************/
+static void standardFrame(const SudokuGrid *grid, int transposed,
+        CacheTransform *transform, unsigned char values[])
+{
+    const int size = grid->size;
+    int rowCounts[MAXSIZE] = {0};
+    int columnCounts[MAXSIZE] = {0};
+    int digitCounts[MAXSIZE + 1] = {0};
+    int rowWeights[MAXSIZE] = {0};
+    int columnWeights[MAXSIZE] = {0};
+    int nextDigit = 1;
+    int row;
+    int column;
+    int value;
+
+    for (row = 0; row < size; row++)
+    {
+        for (column = 0; column < size; column++)
+        {
+            value = orientedValue(grid, transposed, row, column);
+            if (value != 0)
+            {
+                rowCounts[row]++;
+                columnCounts[column]++;
+                digitCounts[value]++;
+            }
+        }
+    }
+    // A line's count, then the crossing counts and digit counts of its
+    // values; the second part stays below 2^16 for the largest grids
+    for (row = 0; row < size; row++)
+    {
+        rowWeights[row] = rowCounts[row] << 16;
+        columnWeights[row] = columnCounts[row] << 16;
+    }
+    for (row = 0; row < size; row++)
+    {
+        for (column = 0; column < size; column++)
+        {
+            value = orientedValue(grid, transposed, row, column);
+            if (value != 0)
+            {
+                rowWeights[row] += columnCounts[column] * (size + 1)
+                    + digitCounts[value];
+                columnWeights[column] += rowCounts[row] * (size + 1)
+                    + digitCounts[value];
+            }
+        }
+    }
+    transform->transposed = transposed;
+    orderLines(rowWeights, grid->order, transform->rows);
+    orderLines(columnWeights, grid->order, transform->columns);
+    memset(transform->digits, 0, sizeof(transform->digits));
+    for (row = 0; row < size; row++)
+    {
+        for (column = 0; column < size; column++)
+        {
+            value = orientedValue(grid, transposed, transform->rows[row],
+                    transform->columns[column]);
+            if (value != 0 && transform->digits[value] == 0)
+            {
+                transform->digits[value] = (unsigned char)nextDigit++;
+            }
+            values[row * size + column] = transform->digits[value];
+        }
+    }
+    // Digits the grid does not use yet take the remaining labels
+    for (value = 1; value <= size; value++)
+    {
+        if (transform->digits[value] == 0)
+        {
+            transform->digits[value] = (unsigned char)nextDigit++;
+        }
+    }
+}
+
+/****************************** cacheKey ****************************************
+ * void cacheKey(const SudokuCache *cache, const SudokuGrid *grid,
+ *         char command, int canonical, CacheKey *key);
+ * Purpose:
+ *     Builds the key under which the result of a command on a grid is kept.
+ * Parameters:
+ *     I    cache       cache the key is for
+ *     I    grid        puzzle or solution, values 0 thru size
+ *     I    command     command whose result is kept
+ *     I    canonical   1 to take the key up to symmetry, if the cache does
+ *     O    key         the key, with its transform from the grid
+ *******************************************************************************/
+void cacheKey(const SudokuCache *cache, const SudokuGrid *grid, char command,
+        int canonical, CacheKey *key)
+{
+    const int size = grid->size;
+    unsigned char transposedCells[MAXCELLS];
+    CacheTransform transposed;
+    int index;
+
+    if (cache->canonical && canonical)
+    {
+        standardFrame(grid, 0, &key->transform, key->cells);
+        standardFrame(grid, 1, &transposed, transposedCells);
+        if (memcmp(transposedCells, key->cells, size * size) < 0)
+        {
+            key->transform = transposed;
+            memcpy(key->cells, transposedCells, size * size);
+        }
+    } else
+    {
+        key->transform.transposed = 0;
+        for (index = 0; index < size; index++)
+        {
+            key->transform.rows[index] = (unsigned char)index;
+            key->transform.columns[index] = (unsigned char)index;
+        }
+        for (index = 0; index <= size; index++)
+        {
+            key->transform.digits[index] = (unsigned char)index;
+        }
+        for (index = 0; index < size * size; index++)
+        {
+            key->cells[index] = (unsigned char)grid->cells[index];
+        }
+    }
+    key->command = command;
+    key->hash = hashBytes(key->cells, size * size)
+        ^ (uint64_t)(unsigned char)command;
+}
+
+/****************************** cacheToKey **************************************
+ * void cacheToKey(const CacheTransform *transform, const SudokuGrid *grid,
+ *         unsigned char values[]);
+ * Purpose:
+ *     Maps a grid, e.g. the solution of a keyed puzzle, into the frame of
+ *     the key.
+ *******************************************************************************/
+void cacheToKey(const CacheTransform *transform, const SudokuGrid *grid,
+        unsigned char values[])
+{
+    const int size = grid->size;
+    int row;
+    int column;
+
+    for (row = 0; row < size; row++)
+    {
+        for (column = 0; column < size; column++)
+        {
+            values[row * size + column] = transform->digits[orientedValue(grid,
+                    transform->transposed, transform->rows[row],
+                    transform->columns[column])];
+        }
+    }
+}
+
+/****************************** cacheFromKey ************************************
+ * void cacheFromKey(const CacheTransform *transform,
+ *         const unsigned char values[], SudokuGrid *grid);
+ * Purpose:
+ *     Maps values in the frame of a key back into the frame of the grid.
+ *******************************************************************************/
+void cacheFromKey(const CacheTransform *transform, const unsigned char values[],
+        SudokuGrid *grid)
+{
+    const int size = grid->size;
+    unsigned char original[MAXSIZE + 1];
+    int row;
+    int column;
+    int cellIndex;
+
+    for (row = 0; row <= size; row++)
+    {
+        original[transform->digits[row]] = (unsigned char)row;
+    }
+    for (row = 0; row < size; row++)
+    {
+        for (column = 0; column < size; column++)
+        {
+            cellIndex = transform->transposed
+                ? transform->columns[column] * size + transform->rows[row]
+                : transform->rows[row] * size + transform->columns[column];
+            grid->cells[cellIndex] = original[values[row * size + column]];
+        }
+    }
+}
+
+/****************************** entryAt *****************************************
+ * static CacheEntry *entryAt(const SudokuCache *cache, const CacheKey *key,
+ *         int probe);
+ * Purpose:
+ *     Finds the entry at a position of a key's probe window.
+ *******************************************************************************/
+static CacheEntry *entryAt(const SudokuCache *cache, const CacheKey *key,
+        int probe)
+{
+    const long stripe = (long)(key->hash >> 58) % CACHE_STRIPES;
+    const long slot = (long)((key->hash + probe) & (cache->stripeEntries - 1));
+
+    return (CacheEntry *)(cache->entries + (stripe * cache->stripeEntries
+                + slot) * cache->entrySize);
+}
+
+/****************************** matches *****************************************
+ * static int matches(const SudokuCache *cache, const CacheEntry *entry,
+ *         const CacheKey *key);
+ * Purpose:
+ *     Tells whether an entry holds the result for a key.
+ *******************************************************************************/
+static int matches(const SudokuCache *cache, const CacheEntry *entry,
+        const CacheKey *key)
+{
+    const int cellCount = cache->order * cache->order * cache->order
+        * cache->order;
+
+    return entry->used && entry->hash == key->hash
+        && entry->command == key->command
+        && memcmp(entry + 1, key->cells, cellCount) == 0;
+}
+
+/****************************** cacheFind ***************************************
+ * int cacheFind(SudokuCache *cache, const CacheKey *key,
+ *         unsigned char *payload, size_t *length);
+ * Purpose:
+ *     Looks up the result kept for a key.
+ * Parameters:
+ *     I/O  cache       cache to search; a hit is marked as used
+ *     I    key         key from cacheKey()
+ *     O    payload     receives the result, up to cache->payloadSize bytes
+ *     O    length      number of result bytes
+ * Returns
+ *     0    no result is kept for the key
+ *     1    result copied
+ *******************************************************************************/
+int cacheFind(SudokuCache *cache, const CacheKey *key, unsigned char *payload,
+        size_t *length)
+{
+    const int cellCount = cache->order * cache->order * cache->order
+        * cache->order;
+    pthread_mutex_t *lock = &cache->locks[(key->hash >> 58) % CACHE_STRIPES];
+    CacheEntry *entry;
+    int probe;
+
+    pthread_mutex_lock(lock);
+    for (probe = 0; probe < CACHE_PROBES; probe++)
+    {
+        entry = entryAt(cache, key, probe);
+        if (matches(cache, entry, key))
+        {
+            entry->referenced = 1;
+            *length = entry->length;
+            memcpy(payload, (unsigned char *)(entry + 1) + cellCount,
+                    entry->length);
+            pthread_mutex_unlock(lock);
+            return 1;
+        }
+    }
+    pthread_mutex_unlock(lock);
+    return 0;
+}
+
+/****************************** cacheStore **************************************
+ * void cacheStore(SudokuCache *cache, const CacheKey *key,
+ *         const unsigned char *payload, size_t length);
+ * Purpose:
+ *     Keeps the result for a key, evicting an entry of its window if need
+ *     be. Results longer than cache->payloadSize are not kept.
+ * Parameters:
+ *     I/O  cache       cache to store in
+ *     I    key         key from cacheKey()
+ *     I    payload     result bytes
+ *     I    length      number of result bytes
+ *******************************************************************************/
+void cacheStore(SudokuCache *cache, const CacheKey *key,
+        const unsigned char *payload, size_t length)
+{
+    const int cellCount = cache->order * cache->order * cache->order
+        * cache->order;
+    const int stripe = (int)((key->hash >> 58) % CACHE_STRIPES);
+    CacheEntry *entry = NULL;
+    CacheEntry *candidate;
+    int probe;
+
+    if (length > cache->payloadSize)
+    {
+        return;
+    }
+    pthread_mutex_lock(&cache->locks[stripe]);
+    // The same key, else a free entry, else the clock's victim
+    for (probe = 0; probe < CACHE_PROBES && entry == NULL; probe++)
+    {
+        candidate = entryAt(cache, key, probe);
+        if (matches(cache, candidate, key))
+        {
+            entry = candidate;
+        }
+    }
+    for (probe = 0; probe < CACHE_PROBES && entry == NULL; probe++)
+    {
+        candidate = entryAt(cache, key, probe);
+        if (!candidate->used)
+        {
+            entry = candidate;
+        }
+    }
+    for (probe = 0; probe < 2 * CACHE_PROBES && entry == NULL; probe++)
+    {
+        candidate = entryAt(cache, key,
+                (int)(cache->hands[stripe]++ % CACHE_PROBES));
+        if (candidate->referenced)
+        {
+            candidate->referenced = 0; // second chance
+        } else
+        {
+            entry = candidate;
+        }
+    }
+    entry->hash = key->hash;
+    entry->length = (uint32_t)length;
+    entry->command = key->command;
+    entry->used = 1;
+    entry->referenced = 0;
+    memcpy(entry + 1, key->cells, cellCount);
+    memcpy((unsigned char *)(entry + 1) + cellCount, payload, length);
+    pthread_mutex_unlock(&cache->locks[stripe]);
+}
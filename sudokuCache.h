@@ -0,0 +1,68 @@
+/*******************************************************************************
+ * sudokuCache.h by Geoffrey Sessums
+ * Purpose:
+ *   Defines the cache of results for repeated grids, its keys and the
+ *   symmetry that maps a grid to its key.
+ *   Prototypes
+ * Notes:
+ *   Requires sudokuChecker.h
+ *******************************************************************************/
+#ifndef SUDOKUCACHE_H
+#define SUDOKUCACHE_H
+
+#include <pthread.h>
+
+// Table layout: independently locked stripes, each probed in a window
+#define CACHE_STRIPES 64
+#define CACHE_PROBES 8
+
+// Result bytes kept per entry, per cell of the puzzle
+#define CACHE_PAYLOADPERCELL 16
+
+// Symmetry taking a grid to its key: key cell (row, column) holds the
+// original cell (rows[row], columns[column]) of the grid, transposed
+// first when transposed is set, with its digit relabeled by digits[]
+typedef struct
+{
+    int transposed;
+    unsigned char rows[MAXSIZE];
+    unsigned char columns[MAXSIZE];
+    unsigned char digits[MAXSIZE + 1];  // original digit -> key digit
+} CacheTransform;
+
+// A grid and command as looked up in the cache
+typedef struct
+{
+    uint64_t hash;
+    char command;
+    unsigned char cells[MAXCELLS];      // grid in the key's frame
+    CacheTransform transform;
+} CacheKey;
+
+// Fixed size table of entries; see sudokuCache.c for the entry layout
+typedef struct
+{
+    int order;
+    int canonical;                      // keys are taken up to symmetry
+    size_t entrySize;
+    size_t payloadSize;                 // result bytes an entry holds
+    long stripeEntries;                 // entries per stripe, a power of 2
+    unsigned char *entries;
+    pthread_mutex_t locks[CACHE_STRIPES];
+    unsigned int hands[CACHE_STRIPES];  // clock hand of every stripe
+} SudokuCache;
+
+// Prototypes
+SudokuCache *createCache(int order, size_t bytes, int canonical);
+void cacheKey(const SudokuCache *cache, const SudokuGrid *grid, char command,
+        int canonical, CacheKey *key);
+void cacheToKey(const CacheTransform *transform, const SudokuGrid *grid,
+        unsigned char values[]);
+void cacheFromKey(const CacheTransform *transform, const unsigned char values[],
+        SudokuGrid *grid);
+int cacheFind(SudokuCache *cache, const CacheKey *key, unsigned char *payload,
+        size_t *length);
+void cacheStore(SudokuCache *cache, const CacheKey *key,
+        const unsigned char *payload, size_t length);
+
+#endif
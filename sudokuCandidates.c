@@ -0,0 +1,75 @@
+/*******************************************************************************
+ * sudokuCandidates.c by Geoffrey Sessums
+ * Purpose:
+ *  Builds the row, column and region occupancy masks of a puzzle in one
+ *  pass. The possible values of any empty cell are then a single AND of
+ *  three masks (candidatesAt), and filling or emptying a cell updates the
+ *  masks in place (fillCandidate, clearCandidate) instead of rescanning.
+ ******************************************************************************/
+
+// Header
+#include <string.h>
+#include "sudokuChecker.h"
+#include "sudokuCandidates.h"
+
+/****************************** initCandidatesOrder *****************************
+ * void initCandidatesOrder(CandidateMasks *masks, const SudokuGrid *grid,
+ *         const int order);
+ * Purpose:
+ *     Records the digits used by every row, column and region of a puzzle.
+ * Parameters:
+ *     O    masks       occupancy masks of the puzzle
+ *     I    grid        puzzle values, zero for empty cells
+ *     I    order       box order of grid, a constant in every instance
+ *******************************************************************************/
+SUDOKU_INLINE void initCandidatesOrder(CandidateMasks *masks,
+        const SudokuGrid *grid, const int order)
+{
+    const int size = order * order;
+    int rowIndex;
+    int columnIndex;
+    int value;
+
+    memset(masks->rowMask, 0, sizeof(DigitMask) * size);
+    memset(masks->columnMask, 0, sizeof(DigitMask) * size);
+    memset(masks->regionMask, 0, sizeof(DigitMask) * size);
+    for (rowIndex = 0; rowIndex < size; rowIndex++)
+    {
+        for (columnIndex = 0; columnIndex < size; columnIndex++)
+        {
+            value = grid->cells[rowIndex * size + columnIndex];
+            if (value > 0 && value <= size)
+            {
+                fillCandidate(masks, rowIndex, columnIndex, order, value);
+            }
+        }
+    }
+}
+
+// initCandidates2 thru initCandidates6
+#define SPECIALIZE_INIT(order) \
+    SUDOKU_CLONES \
+    static void initCandidates##order(CandidateMasks *masks, \
+            const SudokuGrid *grid) \
+    { \
+        initCandidatesOrder(masks, grid, order); \
+    }
+SPECIALIZE_ORDERS(SPECIALIZE_INIT)
+
+/****************************** initCandidates **********************************
+ * void initCandidates(CandidateMasks *masks, const SudokuGrid *grid);
+ * Purpose:
+ *     Records the digits used by every row, column and region of a puzzle.
+ * Parameters:
+ *     O    masks       occupancy masks of the puzzle
+ *     I    grid        puzzle values, zero for empty cells
+ * Notes:
+ *     Only the first grid->size entries of each mask array are set.
+ *******************************************************************************/
+void initCandidates(CandidateMasks *masks, const SudokuGrid *grid)
+{
+    static void (*const initTable[MAXORDER + 1])(CandidateMasks *,
+            const SudokuGrid *) = ORDERTABLE(initCandidates);
+
+    initTable[grid->order](masks, grid);
+}
@@ -0,0 +1,72 @@
+/*******************************************************************************
+ * sudokuCandidates.h by Geoffrey Sessums
+ * Purpose:
+ *   Defines the occupancy masks from which the possible values of every
+ *   empty cell are derived.
+ *   Prototypes and inline mask operations
+ * Notes:
+ *   Requires sudokuChecker.h. The inline operations take the box order as a
+ *   parameter so that routines specialized per order fold it to a constant.
+ *******************************************************************************/
+#ifndef SUDOKUCANDIDATES_H
+#define SUDOKUCANDIDATES_H
+
+// Digits used in each row, column and region
+typedef struct
+{
+    DigitMask rowMask[MAXSIZE];
+    DigitMask columnMask[MAXSIZE];
+    DigitMask regionMask[MAXSIZE];
+} CandidateMasks;
+
+// Prototypes
+void initCandidates(CandidateMasks *masks, const SudokuGrid *grid);
+
+/****************************** candidatesAt ************************************
+ * DigitMask candidatesAt(const CandidateMasks *masks, int rowIndex,
+ *         int columnIndex, int order);
+ * Purpose:
+ *     Possible values of a cell: the digits not used in its row, column or
+ *     region.
+ *******************************************************************************/
+SUDOKU_INLINE DigitMask candidatesAt(const CandidateMasks *masks,
+        int rowIndex, int columnIndex, int order)
+{
+    return ~(masks->rowMask[rowIndex] | masks->columnMask[columnIndex]
+            | masks->regionMask[REGIONINDEX(rowIndex, columnIndex, order)])
+        & ALLDIGITS(order * order);
+}
+
+/****************************** fillCandidate ***********************************
+ * void fillCandidate(CandidateMasks *masks, int rowIndex, int columnIndex,
+ *         int order, int value);
+ * Purpose:
+ *     Records value as used by the row, column and region of a cell.
+ *******************************************************************************/
+SUDOKU_INLINE void fillCandidate(CandidateMasks *masks, int rowIndex,
+        int columnIndex, int order, int value)
+{
+    DigitMask digit = DIGITBIT(value);
+
+    masks->rowMask[rowIndex] |= digit;
+    masks->columnMask[columnIndex] |= digit;
+    masks->regionMask[REGIONINDEX(rowIndex, columnIndex, order)] |= digit;
+}
+
+/****************************** clearCandidate **********************************
+ * void clearCandidate(CandidateMasks *masks, int rowIndex, int columnIndex,
+ *         int order, int value);
+ * Purpose:
+ *     Makes value available again after its cell has been emptied.
+ *******************************************************************************/
+SUDOKU_INLINE void clearCandidate(CandidateMasks *masks, int rowIndex,
+        int columnIndex, int order, int value)
+{
+    DigitMask digit = DIGITBIT(value);
+
+    masks->rowMask[rowIndex] &= ~digit;
+    masks->columnMask[columnIndex] &= ~digit;
+    masks->regionMask[REGIONINDEX(rowIndex, columnIndex, order)] &= ~digit;
+}
+
+#endif
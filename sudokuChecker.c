@@ -5,10 +5,55 @@
  *  rules against duplication values in a row, column, or outlined 3 x 3 square. 
  * Command Parameters:
  *  ./sudokuChecker < textFile
+ *  ./sudokuChecker -b [textFile]
+ *      Batch mode: processes every record of textFile (default stdin) and
+ *      prints one result line per record. See sudokuBatch.c.
+ *  ./sudokuChecker -j threads [textFile]
+ *      Batch mode on a pool of worker threads, 0 for one per processor.
+ *      Results are printed in input order. See sudokuParallel.c.
+ *  ./sudokuChecker -s | --stream [-j threads] [textFile]
+ *      Streaming batch mode: never maps the input, and reads it ahead on
+ *      a thread of its own into a fixed ring of blocks, so inputs of any
+ *      length, e.g. zcat dump.gz | ./sudokuChecker --stream, are checked
+ *      in constant memory. See sudokuReader.c.
+ *  ./sudokuChecker -f path ...
+ *      File mode: checks every record of every file named, and of every
+ *      file below a directory named, printing each result line after the
+ *      path of its file. Many files are read at once through io_uring.
+ *      See sudokuFiles.c.
+ *  ./sudokuChecker -u socketPath | -p port [-j threads]
+ *      Server mode: answers batch records sent over a Unix domain socket or
+ *      a TCP port on the loopback address, on a pool of worker threads
+ *      (default one per processor). See sudokuServer.c.
+ *  ./sudokuChecker -m limit -t threads ...
+ *      Option U counts solutions up to limit (default 2, which proves a
+ *      puzzle unique). Options S and U search each puzzle on threads
+ *      threads (default 1). See sudokuCount.c and sudokuSteal.c.
+ *  ./sudokuChecker -c megabytes [-y] ...
+ *      Batch and server modes keep the results of options C, L and S in a
+ *      cache of megabytes MB and answer repeated grids from it. With -y a
+ *      grid also matches the grids equivalent to it under the symmetries
+ *      of Sudoku (options C and S only). See sudokuCache.c.
+ *  ./sudokuChecker -x | -J layoutFile | -K cageFile ...
+ *      Batch, file and server modes check solutions (option C) and list
+ *      possible values (option L) under variant rules: -x adds both main
+ *      diagonals (X-Sudoku), -J replaces the boxes by the jigsaw regions
+ *      of layoutFile and -K adds the killer cages of cageFile. Rules
+ *      combine. See sudokuVariant.c.
+ *  ./sudokuChecker -M prometheus|json ...
+ *      Dumps counters and per command latency histograms to stderr on
+ *      exit and on SIGUSR1. Needs a build with -DSUDOKU_METRICS. See
+ *      sudokuMetrics.c.
+ *  ./sudokuChecker -n order ...
+ *      Box order of the puzzles, 2 thru 6 (4x4 thru 36x36); default 3.
+ *      Packed batch input (see sudokuConvert.c) is recognized by its
+ *      header, which gives the box order instead.
  * Input:
- *  A line of input containing a single command character L, C, or E.
+ *  A line of input containing a single command character L, C, R, S, U,
+ *  G or E.
  *  Lines of input containing sudoku puzzle values 0-9, zero representing an
- *  an empty cell.
+ *  an empty cell. Puzzles larger than 9x9 take values separated by white
+ *  space, e.g. 0 16 3 0 ...
  *  e.g.    L 
  *          002405800
  *          041800020
@@ -24,61 +69,280 @@
  *      Prints the possible values and their position within the sudoku puzzle. 
  *  Option C:
  *      C-Checks a sudoku puzzle solution and prints "incorrect/correct."
+ *  Option R:
+ *      R-Reports every row, column and region of a sudoku puzzle solution
+ *      that breaks the rules, as one JSON line. See sudokuReport.c.
+ *  Option S:
+ *      S-Solves a sudoku puzzle and prints the solution, or "No solution."
+ *  Option U:
+ *      U-Counts the solutions of a sudoku puzzle up to the limit, and the
+ *      search nodes it took, e.g. "Solutions: 1, nodes: 12."
+ *  Option G:
+ *      G-Generates a puzzle with a unique solution from a seed, 0 thru
+ *      99999999, and prints it with its difficulty grade. See
+ *      sudokuGrade.c.
  * Returns:
  *  0 exit normally. 
  ******************************************************************************/
 
 // Header 
+#include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <unistd.h>
 #include "sudokuChecker.h"
+#include "sudokuOutput.h"
+#include "sudokuReader.h"
+#include "sudokuCache.h"
+#include "sudokuVariant.h"
+#include "sudokuBatch.h"
+#include "sudokuCandidates.h"
+#include "sudokuSolver.h"
+#include "sudokuReport.h"
+#include "sudokuGenerate.h"
+#include "sudokuGrade.h"
+#include "sudokuMetrics.h"
+
+#define USAGE "Usage: sudokuChecker [-b | -s | -f] [-j threads] [-n order] " \
+    "[-m limit] [-t threads] [-c megabytes [-y]] [-x] [-J layoutFile] " \
+    "[-K cageFile] [-M prometheus|json] " \
+    "[-u socketPath | -p port] [inputFile.txt] " \
+    "< inputFile.txt"
+
+static SudokuReader reader; // input reader, shared by all modes
+
+// Long spellings of the options
+static const struct option longOptions[] =
+{
+    {"stream", no_argument, NULL, 's'},
+    {NULL, 0, NULL, 0}
+};
+
+static int getSudokuValues(SudokuReader *reader, SudokuGrid *grid);
+static void loadRules(int order, int diagonals, const char *layoutPath,
+        const char *cagePath);
+static int parseThreadCount(const char *text);
 
 // Main Program
 int main(int argc, char *argv[])
 {
-    int count[MAXSIZE] = {0};
     char userChoice; 
-    int sudoku[MAXROWS][MAXCOLUMNS] = {0}; // 2D Sudoku puzzle
-    int rowIndex; 
-    int columnIndex;
-    int countIndex; 
+    SudokuCell cells[MAXCELLS] = {0}; // Sudoku puzzle values
+    SudokuGrid grid;
+    int order = DEFAULTORDER;
+    int inputFd = STDIN_FILENO;
+    int batchMode = 0;
+    int streamMode = 0;
+    int fileMode = 0;
+    int threadCount = 0;
+    int serverMode = 0;
+    const char *socketPath = NULL;
+    int port = 0;
+    long countLimit = 2;
+    int countThreads = 1;
+    int metricsFormat = METRICS_NONE;
+    long cacheMegabytes = 0;        // 0 for no cache
+    int canonical = 0;
+    int diagonals = 0;              // variant rules
+    const char *layoutPath = NULL;
+    const char *cagePath = NULL;
+    int seed;                       // option G
+    long nodes;                     // option S
+    SudokuRandom random;
+    int readResult;
+    int option;
+    OutputBuffer output;
+
+    // Process command options
+    while ((option = getopt_long(argc, argv, "bsfj:n:u:p:m:t:c:yxJ:K:M:",
+                    longOptions, NULL)) != -1)
+    {
+        switch (option)
+        {
+            case 'b':
+                batchMode = 1;
+                break;
+            case 's':
+                batchMode = 1;
+                streamMode = 1;
+                break;
+            case 'f':
+                fileMode = 1;
+                break;
+            case 'j':
+                batchMode = 1;
+                threadCount = parseThreadCount(optarg);
+                break;
+            case 'n':
+                order = (int)parseNumber(optarg, MINORDER, MAXORDER,
+                        "Box order must be 2 thru 6.");
+                break;
+            case 'm':
+                countLimit = parseNumber(optarg, 2, LONG_MAX,
+                        "Solution limit must be 2 or more.");
+                break;
+            case 't':
+                countThreads = parseThreadCount(optarg);
+                break;
+            case 'c':
+                cacheMegabytes = parseNumber(optarg, 1, 65536,
+                        "Cache size must be 1 thru 65536 MB.");
+                break;
+            case 'y':
+                canonical = 1;
+                break;
+            case 'x':
+                diagonals = 1;
+                break;
+            case 'J':
+                layoutPath = optarg;
+                break;
+            case 'K':
+                cagePath = optarg;
+                break;
+            case 'M':
+                if (strcmp(optarg, "prometheus") == 0)
+                {
+                    metricsFormat = METRICS_PROMETHEUS;
+                } else if (strcmp(optarg, "json") == 0)
+                {
+                    metricsFormat = METRICS_JSON;
+                } else
+                {
+                    exitError("Metrics format must be prometheus or json.");
+                }
+                break;
+            case 'u':
+                serverMode = 1;
+                socketPath = optarg;
+                break;
+            case 'p':
+                serverMode = 1;
+                port = (int)parseNumber(optarg, 1, 65535,
+                        "Port must be 1 thru 65535.");
+                break;
+            default:
+                exitError(USAGE);
+        }
+    }
+    // An input file is only expected in batch mode; file mode takes many
+    if ((!fileMode && (optind < argc - 1 || (optind == argc - 1 && !batchMode)))
+            || (fileMode && (optind == argc || batchMode || serverMode))
+            || (serverMode && optind != argc))
+    {
+        exitError(USAGE);
+    }
+    if (canonical && cacheMegabytes == 0)
+    {
+        exitError("Option -y needs a cache; give -c megabytes.");
+    }
+    if ((diagonals || layoutPath != NULL || cagePath != NULL)
+            && !batchMode && !fileMode && !serverMode)
+    {
+        exitError("Variant rules need batch, file or server mode.");
+    }
+    if (threadCount == 0)
+    {
+        threadCount = serverMode ? (int)sysconf(_SC_NPROCESSORS_ONLN) : 1;
+    }
+    setCountOptions(countLimit, countThreads);
+    // Before any thread starts, so all of them leave SIGUSR1 to the dump
+    if (metricsFormat != METRICS_NONE)
+    {
+        startMetrics(metricsFormat);
+    }
+
+    // Server mode: answer clients until killed
+    if (serverMode)
+    {
+        if (cacheMegabytes != 0)
+        {
+            setRecordCache(createCache(order, (size_t)cacheMegabytes << 20,
+                        canonical));
+        }
+        loadRules(order, diagonals, layoutPath, cagePath);
+        runServer(openServerSocket(socketPath, port), threadCount, order);
+    }
+    // File mode: every file named or below a directory named
+    if (fileMode)
+    {
+        if (cacheMegabytes != 0)
+        {
+            setRecordCache(createCache(order, (size_t)cacheMegabytes << 20,
+                        canonical));
+        }
+        loadRules(order, diagonals, layoutPath, cagePath);
+        runFileBatch(argv + optind, argc - optind, order);
+        return 0;
+    }
+    if (optind == argc - 1 && (inputFd = open(argv[optind], O_RDONLY)) < 0)
+    {
+        exitError("Unable to open input file.");
+    }
 
-    // Command argument is NOT expected
-    if (argc > 1)
+    // Batch mode: every record of the input, one result line each
+    if (batchMode)
     {
-        exitError("Usage: sudokuChecker < inputFile.txt");
+        if (streamMode)
+        {
+            readerInitStream(&reader, inputFd);
+        } else
+        {
+            readerInit(&reader, inputFd);
+        }
+        // Packed input carries its own box order
+        if (readerDetectPacked(&reader) != 0)
+        {
+            order = reader.packedOrder;
+        }
+        if (cacheMegabytes != 0)
+        {
+            setRecordCache(createCache(order, (size_t)cacheMegabytes << 20,
+                        canonical));
+        }
+        loadRules(order, diagonals, layoutPath, cagePath);
+        if (threadCount > 1)
+        {
+            runParallelBatch(&reader, threadCount, order);
+        } else
+        {
+            runBatch(&reader, order);
+        }
+        readerClose(&reader);
+        return 0;
     }
+    readerInit(&reader, inputFd);
+    initGrid(&grid, order, cells);
     // Prompt user
     actionMenu();
+    fflush(stdout);
 
     // Get users' choice 
-    scanf("%c" , &userChoice);
+    if (readerNextCommand(&reader, &userChoice) != READER_OK)
+    {
+        userChoice = 'E';
+    }
     printf("%c\n\n", userChoice);
 
     // Process option L
     if (userChoice == 'l' || userChoice == 'L') {
         // Prompt user for Sudoku values
-        printf("%s\n", "Enter Sudoku values (i.e. 0 thru 9.)");
+        printf("Enter Sudoku values (i.e. 0 thru %d.)\n", grid.size);
+        fflush(stdout);
         // Read user values into sudoku matrix
-        getSudokuValues(sudoku);
-        printf("Possible Solutions:\n");
-        // Loop thru rows
-        for (rowIndex = 0; rowIndex < MAXROWS; rowIndex++) {
-            // Loop thru columns
-            for (columnIndex = 0; columnIndex < MAXCOLUMNS; columnIndex++) {
-                // Detect empty cells
-                if (sudoku[rowIndex][columnIndex] == 0) {
-                // Print location of empty cells
-                    printf("[%d][%d]: ", rowIndex, columnIndex);
-                    // Search for possible values
-                    searchRows(sudoku, count, rowIndex);
-                    searchColumns(sudoku, count, columnIndex);
-                    searchRegions(sudoku, count, rowIndex, columnIndex);
-                    // Print possible values
-                    printValues(count);
-                    printf("\n");
-                }
-            }
+        if (!getSudokuValues(&reader, &grid)) {
+            printf("Input ended before every value.\n");
+        } else {
+            printf("Possible Solutions:\n");
+            // Print location and possible values of empty cells
+            outputInit(&output);
+            formatCandidates(&grid, &output, "\n");
+            outputFlush(&output, stdout);
+            outputFree(&output);
         }
     }
 
@@ -87,10 +351,10 @@ int main(int argc, char *argv[])
      * and print whether the solution is incorrect/correct.
      */
     if (userChoice == 'c' || userChoice == 'C') {
-        getSudokuValues(sudoku);
-        if(checkRows(sudoku) != 1 || 
-                checkColumns(sudoku) != 1 || 
-                checkRegions(sudoku) != 1)
+        if (!getSudokuValues(&reader, &grid))
+        {
+            printf("Input ended before every value.\n");
+        } else if (checkSudoku(&grid) != 1)
         {
             printf("Incorrect solution.\n");
         } else
@@ -99,165 +363,203 @@ int main(int argc, char *argv[])
         }
     }
 
+    // Process option R: report every rule violation of the solution
+    if (userChoice == 'r' || userChoice == 'R') {
+        if (!getSudokuValues(&reader, &grid)) {
+            printf("Input ended before every value.\n");
+        } else {
+            outputInit(&output);
+            formatReport(&grid, &output);
+            outputAppendString(&output, "\n");
+            outputFlush(&output, stdout);
+            outputFree(&output);
+        }
+    }
+
+    // Process option U: count the solutions of the puzzle
+    if (userChoice == 'u' || userChoice == 'U') {
+        printf("Enter Sudoku values (i.e. 0 thru %d.)\n", grid.size);
+        fflush(stdout);
+        if (!getSudokuValues(&reader, &grid)) {
+            printf("Input ended before every value.\n");
+        } else {
+            outputInit(&output);
+            formatCount(&grid, &output);
+            outputAppendString(&output, "\n");
+            outputFlush(&output, stdout);
+            outputFree(&output);
+        }
+    }
+
+    // Process option S: solve the puzzle and print the solution
+    if (userChoice == 's' || userChoice == 'S') {
+        printf("Enter Sudoku values (i.e. 0 thru %d.)\n", grid.size);
+        fflush(stdout);
+        if (!getSudokuValues(&reader, &grid))
+        {
+            printf("Input ended before every value.\n");
+        } else if (solveSudokuParallel(&grid, countThreads, &nodes)
+                == SOLVE_SOLVED)
+        {
+            printf("Solution:\n");
+            outputInit(&output);
+            formatGrid(&grid, &output, " ", "\n");
+            outputAppendString(&output, "\n");
+            outputFlush(&output, stdout);
+            outputFree(&output);
+        } else
+        {
+            printf("No solution.\n");
+        }
+    }
+
+    // Process option G: generate and grade a puzzle from a seed
+    if (userChoice == 'g' || userChoice == 'G') {
+        printf("Enter a seed (i.e. 0 thru %d.)\n", GENERATE_MAXSEED);
+        fflush(stdout);
+        while ((readResult = readerNextValue(&reader, &seed,
+                        GENERATE_MAXSEED)) == READER_INVALID) {
+            printf("Invalid seed: %s.\n", reader.errorToken);
+            printf("Enter a seed between 0 and %d.\n", GENERATE_MAXSEED);
+            fflush(stdout);
+        }
+        if (readResult == READER_OK) {
+            randomSeed(&random, (uint64_t)seed);
+            generateUnique(&grid, &random);
+            printf("Puzzle:\n");
+            outputInit(&output);
+            formatGrid(&grid, &output, " ", "\n");
+            outputAppendString(&output, "\nDifficulty: ");
+            outputAppendString(&output, gradeName(gradePuzzle(&grid)));
+            outputAppendString(&output, "\n");
+            outputFlush(&output, stdout);
+            outputFree(&output);
+        }
+    }
+
+    readerClose(&reader);
     // exit normally
     return 0;
 } // end of main
 
 /****************************** getSudokuValues *********************************
- * void getSudokuValues(int sudoku[][MAXCOLUMNS]);
+ * int getSudokuValues(SudokuReader *reader, SudokuGrid *grid);
  * Purpose:
  *     Read sudoku values entered by the user.
  * Parameters:
- *     I/O    sudoku[][MAXCOLUMNS]    stores sudoku puzzle values
+ *     I/O    reader      reader over the user's input
+ *     I/O    grid        stores sudoku puzzle values
+ * Returns
+ *     0    end of file reached before all values were read
+ *     1    all values read
  * Notes:
- *     Only valid sudoku values and zero are added (i.e. values 0-9)
+ *     Only valid sudoku values and zero are added (i.e. values 0 thru the
+ *     grid size). Up to 9x9 each digit is one value, so 002405800 is read
+ *     as nine values.
  *******************************************************************************/
-void getSudokuValues(int sudoku[][MAXCOLUMNS])
+static int getSudokuValues(SudokuReader *reader, SudokuGrid *grid)
 {
-    int rowIndex;
-    int columnIndex;
+    int cellIndex;
     int userInput;
-    char trash[10];
+    int readResult;
 
     // Read values into Sudoku puzzle array
-    for (rowIndex = 0; rowIndex < MAXROWS; rowIndex++) {
-        for (columnIndex = 0; columnIndex < MAXCOLUMNS; columnIndex++) {
-            // Continue loop as long as invalid puzzle values are entered
-            int continueLoop = 1; // boolean flag
-            while (continueLoop) {
-                // get puzzle value
-                if (1 == scanf("%d", &userInput)) {
-                    // test for valid values: 0 thru 9
-                    if (userInput >= 0 && userInput <= 9) {
-                    continueLoop = 0; // leave while loop
-                    } else { // continue while loop
-                        printf("Invalid value: %d.\n", userInput);
-                        printf("Enter values between 0 and 9.\n");
-                    }
-                } else { // continue while loop
-                    scanf("%s", trash);
-                    printf("Invalid value: %s.\n", trash);
-                    printf("Enter values between 0 and 9.\n");
-                }
-            }
-            // Valid value accepted
-            sudoku[rowIndex][columnIndex] = userInput;
+    for (cellIndex = 0; cellIndex < grid->size * grid->size; cellIndex++) {
+        // Continue loop as long as invalid puzzle values are entered
+        while ((readResult = readerNextValue(reader, &userInput, grid->size))
+                == READER_INVALID) {
+            printf("Invalid value: %s.\n", reader->errorToken);
+            printf("Enter values between 0 and %d.\n", grid->size);
+            fflush(stdout);
         }
+        if (readResult == READER_EOF) {
+            return 0; // input ended mid-puzzle
+        }
+        // Valid value accepted
+        grid->cells[cellIndex] = userInput;
     }
+    return 1;
 }
 
-/****************************** printValues *************************************
- * void printValues(int count[]);
+/****************************** loadRules ***************************************
+ * static void loadRules(int order, int diagonals, const char *layoutPath,
+ *         const char *cagePath);
  * Purpose:
- *     Prints possible values for empty sudoku cells.
+ *     Builds the unit table of the variant rules given, if any, and sets
+ *     it for every batch record.
  * Parameters:
- *     I/O  count[]     contains count of sudoku puzzle values. An index with
- *                      non-zero value represents a possible value for an empty 
- *                      cell with the sudoku puzzle. Count array is reset after
- *                      index is printed.
+ *     I    order       box order of the puzzles
+ *     I    diagonals   1 to add both main diagonals
+ *     I    layoutPath  jigsaw layout file, or NULL
+ *     I    cagePath    killer cage file, or NULL
+ * Notes:
+ *     Exits with ERROR_PROCESSING when a file cannot be opened or is
+ *     malformed. The table lives as long as the process.
  *******************************************************************************/
-void printValues(int count[])
+static void loadRules(int order, int diagonals, const char *layoutPath,
+        const char *cagePath)
 {
-    int rowIndex;
-    /*
-     * If element contains zero, then
-     * print index as possible value.
-     */
-    for (rowIndex = 0; rowIndex < 10; rowIndex++) {
-        if (count[rowIndex] == 0) {
-            printf("%d ", rowIndex);
+    static UnitTable table;
+    SudokuReader ruleReader;
+    int fd;
+
+    if (!diagonals && layoutPath == NULL && cagePath == NULL)
+    {
+        return;
+    }
+    initUnitTable(&table, order);
+    if (layoutPath != NULL)
+    {
+        if ((fd = open(layoutPath, O_RDONLY)) < 0)
+        {
+            exitError("Unable to open jigsaw layout file.");
         }
-        // Reset values 
-        count[rowIndex] = 0;
+        readerInit(&ruleReader, fd);
+        readJigsawRegions(&table, &ruleReader);
+        readerClose(&ruleReader);
+        close(fd);
     }
-}
-
-/****************************** searchRows **************************************
- * void searchRows(int sudoku[][MAXCOLUMNS], int count[], int rowIndex);
- * Purpose:
- *     Search the rows of the sudoku puzzle and track the values by incrementing
- *     the corresponding index of the count array.
- * Parameters:
- *     I    sudoku[][MAXCOLUMNS]    sudoku puzzle values
- *     I    rowIndex                index of sudoku row
- *     I/O  count[]     contains count of sudoku puzzle values. An index with
- *                      non-zero value represents a possible value for an empty 
- *                      cell with the sudoku puzzle. Count array is reset after
- *                      index is printed.
- *******************************************************************************/
-void searchRows(int sudoku[][MAXCOLUMNS], int count[], int rowIndex)
-{
-    int columnIndex;
-    // Loops thru rows of the sudoku puzzle.
-    for (columnIndex = 0; columnIndex < MAXROWS; columnIndex++) {
-        // Track the numbers found within the puzzle by incrementing the
-        // coresponding index within the count array
-        count[sudoku[rowIndex][columnIndex]]++;
+    if (diagonals)
+    {
+        addDiagonals(&table);
     }
-}
-
-/****************************** searchColumns ***********************************
- * void searchColumns(int sudoku[][MAXCOLUMNS], int count[], int columnIndex);
- * Purpose:
- *     Search the columns of the sudoku puzzle and track the values by 
- *     incrementing the corresponding index of the count array.
- * Parameters:
- *     I    sudoku[][MAXCOLUMNS]    sudoku puzzle values
- *     I    columnIndex             index of sudoku column
- *     I/O  count[]     contains count of sudoku puzzle values. An index with
- *                      non-zero value represents a possible value for an empty 
- *                      cell with the sudoku puzzle. Count array is reset after
- *                      index is printed.
- *******************************************************************************/
-void searchColumns(int sudoku[][MAXCOLUMNS], int count[], int columnIndex)
-{
-    int rowIndex;
-    // Loops thru columns of the sudoku puzzle.
-    for (rowIndex = 0; rowIndex < MAXCOLUMNS; rowIndex++) {
-        // Track the numbers found within the puzzle by incrementing the
-        // coresponding index within the count array
-        count[sudoku[rowIndex][columnIndex]]++;
+    if (cagePath != NULL)
+    {
+        if ((fd = open(cagePath, O_RDONLY)) < 0)
+        {
+            exitError("Unable to open killer cage file.");
+        }
+        readerInit(&ruleReader, fd);
+        readKillerCages(&table, &ruleReader);
+        readerClose(&ruleReader);
+        close(fd);
     }
+    setRecordUnits(&table);
 }
 
-/****************************** searchRegions ***********************************
- * void searchRegions(int sudoku[][MAXCOLUMNS], int count[], int rowIndex, 
- * int columnIndex);
+/****************************** parseThreadCount ********************************
+ * static int parseThreadCount(const char *text);
  * Purpose:
- *     Search the 3x3 sub-regions of the sudoku puzzle and track the values by 
- *     incrementing the corresponding index of the count array.
+ *     Reads the thread count of option -j or -t.
  * Parameters:
- *     I    sudoku[][MAXCOLUMNS]    sudoku puzzle values
- *     I    rowIndex                index of sudoku row
- *     I    columnIndex             index of sudoku column
- *     I/O  count[]     contains count of sudoku puzzle values. An index with
- *                      non-zero value represents a possible value for an empty 
- *                      cell with the sudoku puzzle. Count array is reset after
+ *     I    text        option argument
+ * Returns
+ *     Number of threads, one per processor for 0
  *******************************************************************************/
-void searchRegions(int sudoku[][MAXCOLUMNS], int count[], int rowIndex,
-        int columnIndex)
+static int parseThreadCount(const char *text)
 {
-    int countIndex;
-    int regionRowIndex;
-    int regionColIndex;
- 
-    // Loop thru 3x3 sub-regions
-    // Loops thru rows of 3x3 sub-region
-    for(regionRowIndex = (rowIndex / 3) * 3; 
-            regionRowIndex < (rowIndex / 3) * 3 + 3;
-            regionRowIndex++) {
-        // Loops thru columns of 3x3 sub-regions
-        for (regionColIndex = (columnIndex / 3) * 3; 
-                regionColIndex < (columnIndex / 3) * 3 + 3; 
-                regionColIndex++) {
-            // Loops thru count array 
-            for (countIndex = 1; countIndex < MAXSIZE-1; countIndex++) {
-                // Track the numbers found within the puzzle by incrementing the
-                // coresponding index within the count array
-                count[sudoku[regionRowIndex][regionColIndex]]++;
-            }
-        }
+    long count = parseNumber(text, 0, INT_MAX,
+            "Thread count must be 0 or more.");
+
+    if (count == 0)
+    {
+        count = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (count < 1)
+    {
+        count = 1;
     }
+    return (int)count;
 }
 
 /****************************** actionMenu **************************************
@@ -270,343 +572,10 @@ void actionMenu()
     printf("\n%s\n","Enter one of the following actions. ");
     printf("%s\n", "L-list possible values for empty cells in a Sudoku puzzle");
     printf("%s\n", "C-check a Sudoku solution");
+    printf("%s\n", "R-report every rule violation of a Sudoku solution");
+    printf("%s\n", "S-solve a Sudoku puzzle");
+    printf("%s\n", "U-count the solutions of a Sudoku puzzle");
+    printf("%s\n", "G-generate a Sudoku puzzle and grade its difficulty");
     printf("%s\n", "E-exit");
     printf("\n%s", "Enter choice: ");
 }
-/********************************* checkRows ************************************
- * int checkRows(int sudoku[][MAXCOLUMNS]);
- * Purpose:
- *     Checks each row of the sudoku puzzle to insure that there are
- *     no duplicate or missing values.
- * Parameters:
- *     I    sudoku[][MAXCOLUMNS]    sudoku puzzle
- * Returns
- *     0    found error
- *     1    no errors found
- * *****************************************************************************/
-int checkRows(int sudoku[][MAXCOLUMNS])
-{
-    int rowIndex;
-    int countIndex;
-    int columnIndex;
-    int count[MAXSIZE] = {0};
-
-    // Loop thru rows
-    for (rowIndex = 0; rowIndex < MAXROWS; rowIndex++)
-    {
-        // Loop thru columns
-        for (columnIndex = 0; columnIndex < MAXCOLUMNS; columnIndex++)
-        {
-            count[sudoku[rowIndex][columnIndex]]++;
-        }
-        // Loop thru count array
-        for (countIndex = 1; countIndex < MAXSIZE - 1; countIndex++)
-        {
-            // Verify values 1 thru 9 are present & not duplicated
-            // (i.e. not zero and not greater than 1
-            if (count[countIndex] != 1)
-            {
-                return 0; // found error
-            }
-            // Reset count values to zero as we loop thru values
-            count[countIndex] = 0;
-        } // end of for-loop thru count array
-    } // end of for-loop thru rows
-
-    return 1; // no errors found
-}
-
-/******************************* checkColumns ***********************************
- * int checkColumns(int sudoku[][MAXCOLUMNS]);
- * Purpose:
- *     Checks each column of the sudoku puzzle to insure that there are
- *     no duplicate or missing values.
- * Parameters:
- *     I    sudoku[][MAXCOLUMNS]    sudoku puzzle
- * Returns
- *     0    found error
- *     1    no errors found
- * *****************************************************************************/
-int checkColumns(int sudoku[][MAXCOLUMNS])
-{
-    int rowIndex;
-    int countIndex;
-    int columnIndex;
-    int count[MAXSIZE] = {0};
-
-    // Loop thru columns 
-    for (columnIndex = 0; columnIndex < MAXCOLUMNS; columnIndex++)
-    {
-        // Loop thru rows 
-        for (rowIndex = 0; rowIndex < MAXROWS; rowIndex++)
-        {
-            count[sudoku[rowIndex][columnIndex]]++;
-        }
-        // Loop thru count array
-        for (countIndex = 1; countIndex < MAXSIZE - 1; countIndex++)
-        {
-            // Verify values 1 thru 9 are present & not duplicated
-            // (i.e. not zero and not greater than 1
-            if (count[countIndex] != 1)
-            {
-                return 0; // found error
-            }
-            // Reset count values to zero as we loop thru values
-            count[countIndex] = 0;
-        } // end of for-loop thru count array
-    } // end of for-loop thru columns 
-
-    return 1; // no errors found
-}
-
-/******************************* checkRegions ***********************************
- * int checkRegions(int sudoku[][MAXCOLUMNS])
- * Purpose:
- *     Checks each 3x3 sub region of the sudoku puzzle to insure that there are
- *     no duplicate or missing values.
- * Parameters:
- *     I    sudoku[][MAXCOLUMNS]    sudoku puzzle
- * Returns
- *     0    found error
- *     1    no errors found
- * *****************************************************************************/
-int checkRegions(int sudoku[][MAXCOLUMNS])
-{
-    int rowIndex;
-    int countIndex;
-    int columnIndex;
-    int count[MAXSIZE] = {0};
-
-    // Loop thru rows, of top left 3x3 region
-    for (rowIndex = 0; rowIndex < 3; rowIndex++)
-    {
-        // Loop thru columns, of top left 3x3 region
-        for (columnIndex = 0; columnIndex < 3; columnIndex++)
-        {
-            count[sudoku[rowIndex][columnIndex]]++;
-        }
-    } // end of loop thru top left 3x3 region
-
-    // Loop thru count array
-    for (countIndex = 1; countIndex < MAXSIZE - 1; countIndex++)
-    {
-        // Verify values 1 thru 9 are present & not duplicated
-        // (i.e. not zero and not greater than 1
-        if (count[countIndex] != 1)
-        {
-            return 0; // found error
-        }
-        // Reset count values to zero as we loop thru values
-        count[countIndex] = 0;
-    } // end of for-loop thru count array
-    // no errors found in top left 3x3 region
-
-    // Loop thru rows, of top center 3x3 region
-    for (rowIndex = 0; rowIndex < 3; rowIndex++)
-    {
-        // Loop thru columns, of top center 3x3 region
-        for (columnIndex = 3; columnIndex < 6; columnIndex++)
-        {
-            count[sudoku[rowIndex][columnIndex]]++;
-        }
-    } // end of loop thru top center 3x3 region
-
-    // Loop thru count array
-    for (countIndex = 1; countIndex < MAXSIZE - 1; countIndex++)
-    {
-        // Verify values 1 thru 9 are present & not duplicated
-        // (i.e. not zero and not greater than 1
-        if (count[countIndex] != 1)
-        {
-            return 0; // found error
-        }
-        // Reset count values to zero as we loop thru values
-        count[countIndex] = 0;
-    } // end of for-loop thru count array
-    // no errors found in top center 3x3 region
-
-    // Loop thru rows, of top right 3x3 region
-    for (rowIndex = 0; rowIndex < 3; rowIndex++)
-    {
-        // Loop thru columns, of top right 3x3 region
-        for (columnIndex = 6; columnIndex < MAXCOLUMNS; columnIndex++)
-        {
-            count[sudoku[rowIndex][columnIndex]]++;
-        }
-    } // end of loop thru top right 3x3 region
-
-    // Loop thru count array
-    for (countIndex = 1; countIndex < MAXSIZE - 1; countIndex++)
-    {
-        // Verify values 1 thru 9 are present & not duplicated
-        // (i.e. not zero and not greater than 1
-        if (count[countIndex] != 1)
-        {
-            return 0; // found error
-        }
-        // Reset count values to zero as we loop thru values
-        count[countIndex] = 0;
-    } // end of for-loop thru count array
-    // no errors found in top right 3x3 region
-
-    // Loop thru rows, of middle left 3x3 region
-    for (rowIndex = 3; rowIndex < 6; rowIndex++)
-    {
-        // Loop thru columns, of middle left 3x3 region
-        for (columnIndex = 0; columnIndex < 3; columnIndex++)
-        {
-            count[sudoku[rowIndex][columnIndex]]++;
-        }
-    } // end of loop thru middle left 3x3 region
-
-    // Loop thru count array
-    for (countIndex = 1; countIndex < MAXSIZE - 1; countIndex++)
-    {
-        // Verify values 1 thru 9 are present & not duplicated
-        // (i.e. not zero and not greater than 1
-        if (count[countIndex] != 1)
-        {
-            return 0; // found error
-        }
-        // Reset count values to zero as we loop thru values
-        count[countIndex] = 0;
-    } // end of for-loop thru count array
-    // no errors found in middle left 3x3 region
-
-    // Loop thru rows, of mid-center 3x3 region
-    for (rowIndex = 3; rowIndex < 6; rowIndex++)
-    {
-        // Loop thru columns, of mid-center 3x3 region
-        for (columnIndex = 3; columnIndex < 6; columnIndex++)
-        {
-            count[sudoku[rowIndex][columnIndex]]++;
-        }
-    } // end of loop thru mid center 3x3 region
-
-    // Loop thru count array
-    for (countIndex = 1; countIndex < MAXSIZE - 1; countIndex++)
-    {
-        // Verify values 1 thru 9 are present & not duplicated
-        // (i.e. not zero and not greater than 1
-        if (count[countIndex] != 1)
-        {
-            return 0; // found error
-        }
-        // Reset count values to zero as we loop thru values
-        count[countIndex] = 0;
-    } // end of for-loop thru count array
-    // no errors found in mid-right 3x3 region
-    
-    // Loop thru rows, of mid-right 3x3 region
-    for (rowIndex = 3; rowIndex < 6; rowIndex++)
-    {
-        // Loop thru columns, of mid-right 3x3 region
-        for (columnIndex = 6; columnIndex < MAXCOLUMNS; columnIndex++)
-        {
-            count[sudoku[rowIndex][columnIndex]]++;
-        }
-    } // end of loop thru mid-right 3x3 region
-
-    // Loop thru count array
-    for (countIndex = 1; countIndex < MAXSIZE - 1; countIndex++)
-    {
-        // Verify values 1 thru 9 are present & not duplicated
-        // (i.e. not zero and not greater than 1
-        if (count[countIndex] != 1)
-        {
-            return 0; // found error
-        }
-        // Reset count values to zero as we loop thru values
-        count[countIndex] = 0;
-    } // end of for-loop thru count array
-    // no errors found in mid-right 3x3 region
-
-    // Loop thru rows, of bottom left 3x3 region
-    for (rowIndex = 6; rowIndex < MAXROWS; rowIndex++)
-    {
-        // Loop thru columns, of bottom left 3x3 region
-        for (columnIndex = 0; columnIndex < 3; columnIndex++)
-        {
-            count[sudoku[rowIndex][columnIndex]]++;
-        }
-    } // end of loop thru bottom left 3x3 region
-
-    // Loop thru count array
-    for (countIndex = 1; countIndex < MAXSIZE - 1; countIndex++)
-    {
-        // Verify values 1 thru 9 are present & not duplicated
-        // (i.e. not zero and not greater than 1
-        if (count[countIndex] != 1)
-        {
-            return 0; // found error
-        }
-        // Reset count values to zero as we loop thru values
-        count[countIndex] = 0;
-    } // end of for-loop thru count array
-    // no errors found in bottom left 3x3 region
-
-    // Loop thru rows, of bottom center 3x3 region
-    for (rowIndex = 6; rowIndex < MAXROWS; rowIndex++)
-    {
-        // Loop thru columns, of bottom center 3x3 region
-        for (columnIndex = 3; columnIndex < 6; columnIndex++)
-        {
-            count[sudoku[rowIndex][columnIndex]]++;
-        }
-    } // end of loop thru bottom center 3x3 region
-
-    // Loop thru count array
-    for (countIndex = 1; countIndex < MAXSIZE - 1; countIndex++)
-    {
-        // Verify values 1 thru 9 are present & not duplicated
-        // (i.e. not zero and not greater than 1
-        if (count[countIndex] != 1)
-        {
-            return 0; // found error
-        }
-        // Reset count values to zero as we loop thru values
-        count[countIndex] = 0;
-    } // end of for-loop thru count array
-    // no errors found in bottom center 3x3 region
-
-    // Loop thru rows, of bottom right 3x3 region
-    for (rowIndex = 6; rowIndex < MAXROWS; rowIndex++)
-    {
-        // Loop thru columns, of bottom right 3x3 region
-        for (columnIndex = 6; columnIndex < MAXCOLUMNS; columnIndex++)
-        {
-            count[sudoku[rowIndex][columnIndex]]++;
-        }
-    } // end of loop thru bottom right 3x3 region
-
-    // Loop thru count array
-    for (countIndex = 1; countIndex < MAXSIZE - 1; countIndex++)
-    {
-        // Verify values 1 thru 9 are present & not duplicated
-        // (i.e. not zero and not greater than 1
-        if (count[countIndex] != 1)
-        {
-            return 0; // found error
-        }
-        // Reset count values to zero as we loop thru values
-        count[countIndex] = 0;
-    } // end of for-loop thru count array
-    // no errors found in bottom right 3x3 region
-
-    return 1; // no errors found
-}
-
-/******************** exitError *************************************************
-    void exitError(char *message)
-Purpose:
-    Prints an error message. Exits with ERROR_PROCESSING.
-Parameters:
-    I char Message              error message to print
-Notes:
-    This routine causes the program to exit.
-********************************************************************************/
-void exitError(char *message)
-{
-    printf("%s\n", message);
-    exit(ERROR_PROCESSING);
-}
@@ -1,30 +1,57 @@
 /*******************************************************************************
  * sudokuChecker.h by Geoffrey Sessums
  * Purpose:
- *   Defines constants for
- *       rows
- *       columns
- *       row and column size
+ *   Defines the helpers that specialize code per order
  *   Prototypes
  * Notes:
- *   None
+ *   The sudoku grid and its constants are defined in sudokuTypes.h.
  *******************************************************************************/
 
+#ifndef SUDOKUCHECKER_H
+#define SUDOKUCHECKER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "sudokuTypes.h"
+
 #define ERROR_PROCESSING 99
 
-// Constants for 9x9 sudoku puzzle array
-#define MAXROWS 9
-#define MAXCOLUMNS 9
-#define MAXSIZE 10
+/*
+ * Per order specialization: hot routines are written once as always inline
+ * functions taking the order as a parameter, then instantiated for every
+ * order with SPECIALIZE_ORDERS so the compiler sees a constant order and
+ * folds the divisions and loop bounds, as in a hand written 9x9 routine.
+ * ORDERTABLE builds the dispatch table indexed by order.
+ */
+#define SUDOKU_INLINE static inline __attribute__((always_inline))
+#define SPECIALIZE_ORDERS(MACRO) MACRO(2) MACRO(3) MACRO(4) MACRO(5) MACRO(6)
+#define ORDERTABLE(prefix) \
+    { NULL, NULL, prefix##2, prefix##3, prefix##4, prefix##5, prefix##6 }
+
+/*
+ * Function multiversioning: the specialized routines that count and find
+ * digit bits are also compiled for newer x86-64 levels, and the dynamic
+ * loader binds the best clone for the host once, so a generic build still
+ * uses popcnt and tzcnt where the CPU has them. Builds for one CPU
+ * (-march) or without ifunc support define SUDOKU_NOCLONES.
+ */
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__) \
+    && !defined(SUDOKU_NOCLONES)
+#define SUDOKU_CLONES __attribute__((target_clones("arch=x86-64-v3", \
+            "arch=x86-64-v2", "default")))
+#else
+#define SUDOKU_CLONES
+#endif
 
 // Prototypes
 void actionMenu();
 void exitError(char *message);
-void getSudokuValues(int sudoku[][MAXCOLUMNS]);
-void searchRows(int sudoku[][MAXCOLUMNS], int count[], int);
-void searchColumns(int sudoku[][MAXCOLUMNS], int count[], int);
-void searchRegions(int sudoku[][MAXCOLUMNS], int count[], int, int);
-void printValues(int count[]);
-int checkRows(int sudoku[][MAXCOLUMNS]);
-int checkColumns(int sudoku[][MAXCOLUMNS]);
-int checkRegions(int sudoku[][MAXCOLUMNS]);
+long parseNumber(const char *text, long minimum, long maximum,
+        char *message);
+void initGrid(SudokuGrid *grid, int order, SudokuCell *cells);
+int checkRows(const SudokuGrid *grid);
+int checkColumns(const SudokuGrid *grid);
+int checkRegions(const SudokuGrid *grid);
+int checkSudoku(const SudokuGrid *grid);
+
+#endif
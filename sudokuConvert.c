@@ -0,0 +1,125 @@
+/*******************************************************************************
+ * sudokuConvert.c by Geoffrey Sessums
+ * Purpose:
+ *  Converts batch records between the text layout and the packed format.
+ * Command Parameters:
+ *  ./sudokuConvert [-n order] [textFile] > packedFile
+ *      Packs every text record of textFile (default stdin).
+ *  ./sudokuConvert packedFile > textFile
+ *      Unpacks every record of packedFile back to text, one per line.
+ *  -n  box order of text records, 2 thru 6; default 3
+ * Notes:
+ *  The direction follows the input: packed input is recognized by its
+ *  header (see sudokuReader.h). Conversion stops at end of input or at an
+ *  E command. A record with a malformed value cannot be converted; its
+ *  line is reported on stderr and the program exits with ERROR_PROCESSING.
+ *  So does a G record, which has a seed instead of a grid.
+ ******************************************************************************/
+
+// Header
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "sudokuChecker.h"
+#include "sudokuOutput.h"
+#include "sudokuReader.h"
+#include "sudokuCache.h"
+#include "sudokuVariant.h"
+#include "sudokuBatch.h"
+
+#define USAGE "Usage: sudokuConvert [-n order] [inputFile] > outputFile"
+
+static SudokuReader reader; // input reader
+
+// Main Program
+int main(int argc, char *argv[])
+{
+    int order = DEFAULTORDER;
+    int inputFd = STDIN_FILENO;
+    int packing;
+    int option;
+    SudokuCell cells[MAXCELLS];
+    BatchRecord record;
+    OutputBuffer output;
+
+    // Process command options
+    while ((option = getopt(argc, argv, "n:")) != -1)
+    {
+        switch (option)
+        {
+            case 'n':
+                order = (int)parseNumber(optarg, MINORDER, MAXORDER,
+                        "Box order must be 2 thru 6.");
+                break;
+            default:
+                exitError(USAGE);
+        }
+    }
+    if (optind < argc - 1)
+    {
+        exitError(USAGE);
+    }
+    if (optind == argc - 1 && (inputFd = open(argv[optind], O_RDONLY)) < 0)
+    {
+        exitError("Unable to open input file.");
+    }
+
+    readerInit(&reader, inputFd);
+    outputInit(&output);
+    packing = readerDetectPacked(&reader) == 0;
+    if (!packing)
+    {
+        order = reader.packedOrder;
+    } else
+    {
+        formatPackedHeader(order, &output);
+    }
+    initGrid(&record.grid, order, cells);
+
+    // Convert record by record, writing in large blocks
+    while (readBatchRecord(&reader, &record)
+            && record.command != 'e' && record.command != 'E')
+    {
+        if (record.truncated)
+        {
+            outputFlush(&output, stdout);
+            fflush(stdout);
+            fprintf(stderr, "Record ended before every value at line %ld.\n",
+                    record.errorLine);
+            exit(ERROR_PROCESSING);
+        }
+        if (record.errorLine != 0)
+        {
+            outputFlush(&output, stdout);
+            fflush(stdout);
+            fprintf(stderr, "Invalid value: %s at line %ld.\n",
+                    record.errorToken, record.errorLine);
+            exit(ERROR_PROCESSING);
+        }
+        if (record.command == 'g' || record.command == 'G')
+        {
+            outputFlush(&output, stdout);
+            fflush(stdout);
+            fprintf(stderr, "G record at line %ld has no grid.\n",
+                    reader.lineNumber);
+            exit(ERROR_PROCESSING);
+        }
+        if (packing)
+        {
+            formatPackedRecord(record.command, &record.grid, &output);
+        } else
+        {
+            formatRecord(record.command, &record.grid, &output);
+        }
+        if (output.length >= OUTPUT_FLUSHSIZE)
+        {
+            outputFlush(&output, stdout);
+        }
+    }
+    outputFlush(&output, stdout);
+    fflush(stdout);
+    outputFree(&output);
+    readerClose(&reader);
+    return 0;
+} // end of main
@@ -0,0 +1,157 @@
+/*******************************************************************************
+ * sudokuCount.c by Geoffrey Sessums
+ * Purpose:
+ *  Counts the solutions of a puzzle up to a limit, searching the branches
+ *  of its first branching point on several threads.
+ * Notes:
+ *  The puzzle is propagated once; every thread then copies that state,
+ *  claims the next untried digit of the first branching cell and counts
+ *  the solutions below it. Once the total reaches the limit, a shared stop
+ *  flag ends the searches still running.
+ ******************************************************************************/
+
+// Header
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "sudokuChecker.h"
+#include "sudokuCandidates.h"
+#include "sudokuSolver.h"
+
+// Count shared by the threads of one puzzle
+typedef struct
+{
+    pthread_mutex_t lock;
+    const SolverState *base;    // state at the first branching point
+    int cell;                   // first branching cell
+    DigitMask remaining;        // its digits not claimed yet
+    long limit;
+    long solutionCount;
+    long nodes;
+    int stop;                   // set once solutionCount reaches limit
+} CountShare;
+
+/****************************** countThread *************************************
+ * static void *countThread(void *argument);
+ * Purpose:
+ *     Claims branches of the first branching point and counts their
+ *     solutions until none are left or the limit is reached.
+ * Parameters:
+ *     I/O  argument    the shared CountShare
+ *******************************************************************************/
+static void *countThread(void *argument)
+{
+    CountShare *share = argument;
+    SolverState *state = malloc(sizeof(SolverState));
+    long solutionCount;
+    int value;
+
+    if (state == NULL)
+    {
+        exitError("Out of memory.");
+    }
+    pthread_mutex_lock(&share->lock);
+    while (share->remaining != 0 && !share->stop)
+    {
+        value = __builtin_ctzll(share->remaining);
+        share->remaining &= share->remaining - 1;
+        pthread_mutex_unlock(&share->lock);
+
+        memcpy(state, share->base, sizeof(SolverState));
+        state->stop = &share->stop;
+        state->nodes = 0;
+        solutionCount = searchBranch(state, share->cell, value, share->limit);
+
+        pthread_mutex_lock(&share->lock);
+        share->solutionCount += solutionCount;
+        share->nodes += state->nodes;
+        if (share->solutionCount >= share->limit)
+        {
+            __atomic_store_n(&share->stop, 1, __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&share->lock);
+    free(state);
+    return NULL;
+}
+
+/****************************** countSudoku *************************************
+ * long countSudoku(const SudokuGrid *grid, long limit, int threadCount,
+ *         long *nodes);
+ * Purpose:
+ *     Counts the solutions of a puzzle, stopping once limit are found.
+ * Parameters:
+ *     I    grid            puzzle, zero for empty cells
+ *     I    limit           solutions wanted, at least 2 (2 proves
+ *                          uniqueness)
+ *     I    threadCount     threads to search with, at least 1
+ *     O    nodes           branches tried by all threads
+ * Returns
+ *     Number of solutions, 0 thru limit
+ * Notes:
+ *     At most one thread per candidate of the first branching cell is
+ *     used. Exits with ERROR_PROCESSING when memory or threads are
+ *     exhausted.
+ *******************************************************************************/
+long countSudoku(const SudokuGrid *grid, long limit, int threadCount,
+        long *nodes)
+{
+    CountShare share;
+    SolverState *base;
+    pthread_t *threads;
+    DigitMask candidates = 0;
+    int threadIndex;
+
+    if (threadCount <= 1)
+    {
+        return countSolutions(grid, limit, nodes);
+    }
+    base = malloc(sizeof(SolverState));
+    if (base == NULL)
+    {
+        exitError("Out of memory.");
+    }
+    share.cell = prepareSearch(base, grid, &candidates);
+    *nodes = base->nodes;
+    if (share.cell < 0)
+    {
+        free(base);
+        return share.cell == SEARCH_SOLVED ? 1 : 0;
+    }
+
+    share.base = base;
+    share.remaining = candidates;
+    share.limit = limit;
+    share.solutionCount = 0;
+    share.nodes = 0;
+    share.stop = 0;
+    pthread_mutex_init(&share.lock, NULL);
+    if (threadCount > __builtin_popcountll(candidates))
+    {
+        threadCount = __builtin_popcountll(candidates);
+    }
+    threads = malloc(sizeof(pthread_t) * threadCount);
+    if (threads == NULL)
+    {
+        exitError("Out of memory.");
+    }
+    for (threadIndex = 0; threadIndex < threadCount; threadIndex++)
+    {
+        if (pthread_create(&threads[threadIndex], NULL, countThread,
+                    &share) != 0)
+        {
+            exitError("Unable to start search thread.");
+        }
+    }
+    for (threadIndex = 0; threadIndex < threadCount; threadIndex++)
+    {
+        pthread_join(threads[threadIndex], NULL);
+    }
+    pthread_mutex_destroy(&share.lock);
+    free(threads);
+    free(base);
+
+    *nodes += share.nodes;
+    return share.solutionCount < limit ? share.solutionCount : limit;
+}
@@ -0,0 +1,619 @@
+/*******************************************************************************
+ * sudokuFiles.c by Geoffrey Sessums
+ * Purpose:
+ *  Runs batch mode over many small puzzle files, each holding records as
+ *  in batch mode (see sudokuBatch.c), e.g. the bundled
+ *  sudoku-solution1-true-to-be-checked.txt. Directories are walked and
+ *  every file below them is checked. Every result line starts with the
+ *  path of its file:
+ *      audit/0001.txt: Correct solution.
+ * Notes:
+ *  Opening, reading and closing FILES_DEPTH files at a time is left to the
+ *  kernel through io_uring, so one thread keeps the disks busy instead of
+ *  waiting on a system call per file. Each file is one linked chain of
+ *  open, read and close on a fixed file of its slot, so one system call
+ *  starts the chains of every slot freed. Files are written out in the order
+ *  they were walked: the slots form a ring, as in sudokuParallel.c, and a
+ *  file whose read completes early waits for the files before it. Result
+ *  lines are gathered and written FILES_FLUSHSIZE bytes at a time.
+ *  A file longer than FILES_BUFFERSIZE is decoded through a reader of its
+ *  own once its turn comes.
+ *  Where io_uring is missing (kernels before 5.18, seccomp, or a build with
+ *  -DSUDOKU_NOURING) the files are opened and read one after another.
+ ******************************************************************************/
+
+// Header
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#if defined(__linux__) && !defined(SUDOKU_NOURING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#ifdef IORING_FEAT_LINKED_FILE
+#define FILES_URING
+#endif
+#endif
+#endif
+#include "sudokuChecker.h"
+#include "sudokuOutput.h"
+#include "sudokuReader.h"
+#include "sudokuCache.h"
+#include "sudokuVariant.h"
+#include "sudokuBatch.h"
+
+// Files in flight, bytes read per file and output written at a time
+#define FILES_DEPTH 64
+#define FILES_BUFFERSIZE 16384
+#define FILES_FLUSHSIZE 65536
+// Directory levels walked below an operand
+#define FILES_MAXLEVELS 64
+
+// Operations, kept in the low bits of the completion's user data
+#define FILES_OPEN 0
+#define FILES_READ 1
+#define FILES_CLOSE 2
+
+// Files below the operands, in directory order
+typedef struct
+{
+    char **operands;
+    int operandCount;
+    int nextOperand;
+    int levels;                             // directories open
+    DIR *directories[FILES_MAXLEVELS];
+    size_t prefixLengths[FILES_MAXLEVELS];  // of each directory and '/'
+    char path[PATH_MAX];
+} FileWalk;
+
+// One file on its way from the disk to the output
+typedef struct
+{
+    char path[PATH_MAX];
+    int done;                       // read, or failed, and closed
+    const char *error;              // result line of a failed file, or NULL
+    size_t length;                  // bytes read into buffer
+    char buffer[FILES_BUFFERSIZE];
+} FileSlot;
+
+// Records of the file being written out and the pending result lines
+typedef struct
+{
+    SudokuReader reader;
+    BatchRecord record;
+    SudokuCell cells[MAXCELLS];
+    OutputBuffer output;
+} FileBatch;
+
+/****************************** enterDirectory **********************************
+ * static int enterDirectory(FileWalk *walk, const char *path);
+ * Purpose:
+ *     Opens a directory to walk below the current level.
+ * Returns
+ *     1 when the directory was entered; 0 when it cannot be read, so the
+ *     caller reports it as a file that failed
+ *******************************************************************************/
+static int enterDirectory(FileWalk *walk, const char *path)
+{
+    const size_t length = strlen(path);
+    DIR *directory;
+
+    if (walk->levels == FILES_MAXLEVELS || length + 2 >= PATH_MAX
+            || (directory = opendir(path)) == NULL)
+    {
+        return 0;
+    }
+    if (walk->path != path)
+    {
+        memcpy(walk->path, path, length);
+    }
+    walk->path[length] = '/';
+    walk->directories[walk->levels] = directory;
+    walk->prefixLengths[walk->levels] = length + 1;
+    walk->levels++;
+    return 1;
+}
+
+/****************************** nextFile ****************************************
+ * static int nextFile(FileWalk *walk, char *path);
+ * Purpose:
+ *     Finds the next file to check: an operand that is not a directory, or
+ *     a regular file below an operand that is.
+ * Parameters:
+ *     I/O  walk        position of the walk
+ *     O    path        path of the file, PATH_MAX bytes
+ * Returns
+ *     0 when every file has been found, else 1
+ * Notes:
+ *     Symbolic links below a directory are followed to files only, so the
+ *     walk cannot loop. A path too long is skipped.
+ *******************************************************************************/
+static int nextFile(FileWalk *walk, char *path)
+{
+    struct dirent *entry;
+    struct stat status;
+    const char *operand;
+    size_t prefixLength;
+    size_t nameLength;
+    int isDirectory;
+
+    for (;;)
+    {
+        if (walk->levels == 0)
+        {
+            if (walk->nextOperand == walk->operandCount)
+            {
+                return 0;
+            }
+            operand = walk->operands[walk->nextOperand++];
+            if (strlen(operand) >= PATH_MAX
+                    || (stat(operand, &status) == 0 && S_ISDIR(status.st_mode)
+                        && enterDirectory(walk, operand)))
+            {
+                continue;
+            }
+            strcpy(path, operand);
+            return 1;
+        }
+        entry = readdir(walk->directories[walk->levels - 1]);
+        if (entry == NULL)
+        {
+            walk->levels--;
+            closedir(walk->directories[walk->levels]);
+            continue;
+        }
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+        {
+            continue;
+        }
+        prefixLength = walk->prefixLengths[walk->levels - 1];
+        nameLength = strlen(entry->d_name);
+        if (prefixLength + nameLength >= PATH_MAX)
+        {
+            continue;
+        }
+        memcpy(walk->path + prefixLength, entry->d_name, nameLength + 1);
+        if (entry->d_type == DT_DIR || entry->d_type == DT_REG)
+        {
+            isDirectory = entry->d_type == DT_DIR;
+        } else
+        {
+            // Links and file systems without d_type
+            if (stat(walk->path, &status) != 0)
+            {
+                continue;
+            }
+            isDirectory = S_ISDIR(status.st_mode) && entry->d_type != DT_LNK;
+            if (!isDirectory && !S_ISREG(status.st_mode))
+            {
+                continue;
+            }
+        }
+        if (isDirectory && enterDirectory(walk, walk->path))
+        {
+            continue;
+        }
+        memcpy(path, walk->path, prefixLength + nameLength + 1);
+        return 1;
+    }
+}
+
+/****************************** writeFile ***************************************
+ * static void writeFile(FileBatch *batch, FileSlot *slot);
+ * Purpose:
+ *     Appends the result lines of every record of a file that was read.
+ * Parameters:
+ *     I/O  batch       record and output buffer
+ *     I    slot        path and contents of the file
+ *******************************************************************************/
+static void writeFile(FileBatch *batch, FileSlot *slot)
+{
+    BatchRecord *record = &batch->record;
+    int recordCount = 0;
+    int fd = -1;
+
+    // A full buffer means there is more: decode the whole file instead
+    if (slot->error == NULL && slot->length == FILES_BUFFERSIZE)
+    {
+        fd = open(slot->path, O_RDONLY);
+        slot->error = fd < 0 ? "Unable to open file." : NULL;
+    }
+    if (slot->error == NULL)
+    {
+        if (fd >= 0)
+        {
+            readerInit(&batch->reader, fd);
+        } else
+        {
+            readerInitMemory(&batch->reader, slot->buffer, slot->length);
+        }
+        while (readBatchRecord(&batch->reader, record)
+                && record->command != 'e' && record->command != 'E')
+        {
+            outputAppendString(&batch->output, slot->path);
+            outputAppendString(&batch->output, ": ");
+            processRecord(record, &batch->output);
+            recordCount++;
+        }
+        readerClose(&batch->reader);
+        slot->error = recordCount == 0 ? "No record." : NULL;
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    if (slot->error != NULL)
+    {
+        outputAppendString(&batch->output, slot->path);
+        outputAppendString(&batch->output, ": ");
+        outputAppendString(&batch->output, slot->error);
+        outputAppendString(&batch->output, "\n");
+    }
+    if (batch->output.length >= FILES_FLUSHSIZE)
+    {
+        outputFlush(&batch->output, stdout);
+    }
+}
+
+/****************************** readFiles ***************************************
+ * static void readFiles(FileWalk *walk, FileSlot *slot, FileBatch *batch);
+ * Purpose:
+ *     Opens, reads, closes and checks the files one after another, where
+ *     io_uring cannot be used.
+ *******************************************************************************/
+static void readFiles(FileWalk *walk, FileSlot *slot, FileBatch *batch)
+{
+    ssize_t bytesRead;
+    int fd;
+
+    while (nextFile(walk, slot->path))
+    {
+        slot->error = NULL;
+        slot->length = 0;
+        fd = open(slot->path, O_RDONLY);
+        if (fd < 0)
+        {
+            slot->error = "Unable to open file.";
+        } else
+        {
+            do {
+                bytesRead = pread(fd, slot->buffer, FILES_BUFFERSIZE, 0);
+            } while (bytesRead < 0 && errno == EINTR);
+            if (bytesRead < 0)
+            {
+                slot->error = "Unable to read file.";
+            } else
+            {
+                slot->length = (size_t)bytesRead;
+            }
+            close(fd);
+        }
+        writeFile(batch, slot);
+    }
+}
+
+#ifdef FILES_URING
+
+// Submission and completion queues shared with the kernel
+typedef struct
+{
+    int fd;
+    unsigned *sqTail;
+    unsigned sqMask;
+    unsigned *sqArray;
+    struct io_uring_sqe *sqes;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned cqMask;
+    struct io_uring_cqe *cqes;
+    unsigned queued;                // entries not yet submitted
+    void *sqRing;
+    size_t sqRingSize;
+    void *cqRing;
+    size_t cqRingSize;
+    size_t sqesSize;
+} FileRing;
+
+/****************************** openRing ****************************************
+ * static int openRing(FileRing *ring, unsigned entries);
+ * Purpose:
+ *     Sets up an io_uring instance, maps its queues and registers a fixed
+ *     file for every slot.
+ * Returns
+ *     1 on success; 0 when the kernel offers no io_uring, or one older than
+ *     5.18, whose linked opens cannot feed the reads that follow them
+ *******************************************************************************/
+static int openRing(FileRing *ring, unsigned entries)
+{
+    struct io_uring_params params;
+    unsigned char *sq;
+    unsigned char *cq;
+    int files[FILES_DEPTH];
+    int slotIndex;
+
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0)
+    {
+        return 0;
+    }
+    // Empty fixed files, filled by the opens and emptied by the closes
+    for (slotIndex = 0; slotIndex < FILES_DEPTH; slotIndex++)
+    {
+        files[slotIndex] = -1;
+    }
+    if ((params.features & IORING_FEAT_LINKED_FILE) == 0
+            || syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_FILES,
+                files, FILES_DEPTH) != 0)
+    {
+        close(ring->fd);
+        return 0;
+    }
+    ring->sqRingSize = params.sq_off.array + params.sq_entries
+        * sizeof(unsigned);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries
+        * sizeof(struct io_uring_cqe);
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    // Both rings share one mapping (IORING_FEAT_SINGLE_MMAP, since 5.4)
+    if (ring->cqRingSize > ring->sqRingSize)
+    {
+        ring->sqRingSize = ring->cqRingSize;
+    }
+    ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqRing == MAP_FAILED || ring->sqes == MAP_FAILED)
+    {
+        exitError("Unable to map io_uring queues.");
+    }
+    ring->cqRing = ring->sqRing;
+    sq = ring->sqRing;
+    cq = ring->cqRing;
+    ring->sqTail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sqMask = *(unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned *)(sq + params.sq_off.array);
+    ring->cqHead = (unsigned *)(cq + params.cq_off.head);
+    ring->cqTail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cqMask = *(unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    ring->queued = 0;
+    return 1;
+}
+
+/****************************** closeRing ***************************************
+ * static void closeRing(FileRing *ring);
+ * Purpose:
+ *     Unmaps the queues and closes the io_uring instance.
+ *******************************************************************************/
+static void closeRing(FileRing *ring)
+{
+    munmap(ring->sqes, ring->sqesSize);
+    munmap(ring->sqRing, ring->sqRingSize);
+    close(ring->fd);
+}
+
+/****************************** queueOperation **********************************
+ * static struct io_uring_sqe *queueOperation(FileRing *ring, int opcode,
+ *         int slotIndex, int operation);
+ * Purpose:
+ *     Adds an operation on the fixed file of a slot to the submission
+ *     queue; it is submitted with the next call to submitRing().
+ * Returns
+ *     The entry, for the caller to fill in the operation's arguments
+ *******************************************************************************/
+static struct io_uring_sqe *queueOperation(FileRing *ring, int opcode,
+        int slotIndex, int operation)
+{
+    const unsigned tail = *ring->sqTail;
+    const unsigned index = tail & ring->sqMask;
+    struct io_uring_sqe *entry = &ring->sqes[index];
+
+    memset(entry, 0, sizeof(*entry));
+    entry->opcode = (unsigned char)opcode;
+    entry->user_data = (uint64_t)slotIndex << 2 | (uint64_t)operation;
+    ring->sqArray[index] = index;
+    // The kernel sees the entry only once the tail moves past it
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+    ring->queued++;
+    return entry;
+}
+
+/****************************** submitRing **************************************
+ * static void submitRing(FileRing *ring, unsigned waitCount);
+ * Purpose:
+ *     Submits the queued operations and waits for waitCount completions.
+ *******************************************************************************/
+static void submitRing(FileRing *ring, unsigned waitCount)
+{
+    long submitted;
+
+    do {
+        submitted = syscall(__NR_io_uring_enter, ring->fd, ring->queued,
+                waitCount, waitCount > 0 ? IORING_ENTER_GETEVENTS : 0,
+                NULL, 0);
+    } while (submitted < 0 && errno == EINTR);
+    if (submitted < 0)
+    {
+        exitError("Unable to submit file reads.");
+    }
+    ring->queued -= (unsigned)submitted;
+}
+
+/****************************** queueFile ***************************************
+ * static void queueFile(FileRing *ring, FileSlot *slot, int slotIndex);
+ * Purpose:
+ *     Queues the open, read and close of a file as one chain on the fixed
+ *     file of its slot.
+ * Notes:
+ *     The links are hard, so the close runs even after a failed open or a
+ *     short read. An open reports only its failure.
+ *******************************************************************************/
+static void queueFile(FileRing *ring, FileSlot *slot, int slotIndex)
+{
+    struct io_uring_sqe *entry;
+
+    entry = queueOperation(ring, IORING_OP_OPENAT, slotIndex, FILES_OPEN);
+    entry->fd = AT_FDCWD;
+    entry->addr = (uint64_t)(uintptr_t)slot->path;
+    entry->open_flags = O_RDONLY;
+    entry->file_index = (unsigned)slotIndex + 1;
+    entry->flags = IOSQE_IO_HARDLINK | IOSQE_CQE_SKIP_SUCCESS;
+    entry = queueOperation(ring, IORING_OP_READ, slotIndex, FILES_READ);
+    entry->fd = slotIndex;
+    entry->addr = (uint64_t)(uintptr_t)slot->buffer;
+    entry->len = FILES_BUFFERSIZE;
+    entry->off = 0;
+    entry->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+    entry = queueOperation(ring, IORING_OP_CLOSE, slotIndex, FILES_CLOSE);
+    entry->file_index = (unsigned)slotIndex + 1;
+}
+
+/****************************** uringFiles *************************************
+ * static void uringFiles(FileRing *ring, FileWalk *walk, FileSlot slots[],
+ *         FileBatch *batch);
+ * Purpose:
+ *     Keeps up to FILES_DEPTH files being opened, read and closed by the
+ *     kernel, and checks and writes out each one in walk order as soon as
+ *     its chain completes.
+ * Notes:
+ *     A slot, and its fixed file, is reused only after its close.
+ *******************************************************************************/
+static void uringFiles(FileRing *ring, FileWalk *walk, FileSlot slots[],
+        FileBatch *batch)
+{
+    struct io_uring_cqe *completion;
+    FileSlot *slot;
+    unsigned head;
+    long filesStarted = 0;
+    long filesWritten = 0;
+    int walking = 1;
+    int slotIndex;
+
+    for (;;)
+    {
+        // Write out, in walk order, every file that has been read
+        while (filesWritten < filesStarted
+                && slots[filesWritten % FILES_DEPTH].done)
+        {
+            writeFile(batch, &slots[filesWritten % FILES_DEPTH]);
+            filesWritten++;
+        }
+
+        // Start the next files in the slots freed
+        while (walking && filesStarted - filesWritten < FILES_DEPTH)
+        {
+            slotIndex = (int)(filesStarted % FILES_DEPTH);
+            slot = &slots[slotIndex];
+            if (!nextFile(walk, slot->path))
+            {
+                walking = 0;
+                break;
+            }
+            slot->done = 0;
+            slot->error = NULL;
+            slot->length = 0;
+            queueFile(ring, slot, slotIndex);
+            filesStarted++;
+        }
+        if (!walking && filesWritten == filesStarted)
+        {
+            break;
+        }
+
+        // The oldest file is still in flight: wait for any completion
+        submitRing(ring, 1);
+        head = *ring->cqHead;
+        while (head != __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE))
+        {
+            completion = &ring->cqes[head & ring->cqMask];
+            slot = &slots[completion->user_data >> 2];
+            switch ((int)(completion->user_data & 3))
+            {
+                case FILES_OPEN:
+                    slot->error = "Unable to open file.";
+                    break;
+                case FILES_READ:
+                    if (slot->error != NULL)
+                    {
+                        break; // the open failed
+                    }
+                    if (completion->res < 0)
+                    {
+                        slot->error = "Unable to read file.";
+                    } else
+                    {
+                        slot->length = (size_t)completion->res;
+                    }
+                    break;
+                default:
+                    slot->done = 1;
+                    break;
+            }
+            head++;
+            __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+#endif
+
+/****************************** runFileBatch ************************************
+ * void runFileBatch(char *paths[], int pathCount, int order);
+ * Purpose:
+ *     Checks every record of every file named, or found below a directory
+ *     named, and writes one result line per record, led by its file's path.
+ * Parameters:
+ *     I    paths       files and directories to check
+ *     I    pathCount   number of paths
+ *     I    order       box order of every puzzle
+ * Notes:
+ *     A file that cannot be opened or read, or holds no record, gets one
+ *     line saying so. Exits with ERROR_PROCESSING when memory is exhausted.
+ *******************************************************************************/
+void runFileBatch(char *paths[], int pathCount, int order)
+{
+    FileSlot *slots = malloc(sizeof(FileSlot) * FILES_DEPTH);
+    FileBatch *batch = malloc(sizeof(FileBatch));
+    FileWalk walk;
+#ifdef FILES_URING
+    FileRing ring;
+#endif
+
+    if (slots == NULL || batch == NULL)
+    {
+        exitError("Out of memory.");
+    }
+    walk.operands = paths;
+    walk.operandCount = pathCount;
+    walk.nextOperand = 0;
+    walk.levels = 0;
+    initGrid(&batch->record.grid, order, batch->cells);
+    outputInit(&batch->output);
+
+#ifdef FILES_URING
+    // Room for the open, read and close of every slot
+    if (openRing(&ring, 4 * FILES_DEPTH))
+    {
+        uringFiles(&ring, &walk, slots, batch);
+        closeRing(&ring);
+    } else
+    {
+        readFiles(&walk, &slots[0], batch);
+    }
+#else
+    readFiles(&walk, &slots[0], batch);
+#endif
+    outputFlush(&batch->output, stdout);
+    fflush(stdout);
+    outputFree(&batch->output);
+    free(batch);
+    free(slots);
+}
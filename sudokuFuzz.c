@@ -0,0 +1,1297 @@
+/*******************************************************************************
+ * sudokuFuzz.c by Geoffrey Sessums
+ * Purpose:
+ *  Differential fuzzing of the fast paths. Every specialized, vectorized,
+ *  cached, threaded and incremental routine is run on the same input as
+ *  the plain routine it stands in for, and any disagreement stops the run:
+ *      checkSudoku(), the SIMD kernels, checkUnits(), checkRows(),
+ *          checkColumns(), checkRegions() and batch chunks against
+ *          counting the values of every row, column and region
+ *      formatCandidates() and formatUnitCandidates() against a cell by
+ *          cell scan of the row, column and region
+ *      cached C, L and S results against uncached ones
+ *      solveSudokuParallel() and countSudoku() against the single threaded
+ *          solver
+ *      game sessions against counting the conflicts of the whole grid
+ *      readerNextGrid() and sudokuParseGrid() against the readerNextValue()
+ *          loop of getSudokuValues(), on random and malformed text
+ *      readerNextPacked() against unpacking one bit at a time
+ * Command Parameters:
+ *  ./sudokuFuzz [-r rounds] [-s seed] [-n order]
+ *      Runs rounds of generated cases for box orders 2 thru 4, or order.
+ *  ./sudokuFuzz file ...
+ *      Runs every file as one fuzz input instead, e.g. for AFL:
+ *      afl-fuzz -i seeds -o findings ./sudokuFuzz @@
+ *  -r  rounds per box order, each a block of FUZZ_BLOCK grids, a text and
+ *      a packed record; default 100
+ *  -s  random seed; the same seed always runs the same cases
+ *  -n  box order, 2 thru 6
+ * Results:
+ *  One line counting the cases run. On a mismatch the case is printed to
+ *  stderr and the program aborts, which AFL and libFuzzer record as a
+ *  crash.
+ * Notes:
+ *  A fuzz input is a box order byte, a mode byte (grid, text or packed
+ *  record) and the bytes of the case; see fuzzInput(). Built with
+ *  -DSUDOKU_LIBFUZZER the file has no main(), for linking with
+ *  clang -fsanitize=fuzzer, which calls LLVMFuzzerTestOneInput().
+ ******************************************************************************/
+
+// Header
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "sudokuChecker.h"
+#include "sudokuOutput.h"
+#include "sudokuReader.h"
+#include "sudokuCache.h"
+#include "sudokuVariant.h"
+#include "sudokuBatch.h"
+#include "sudokuSimd.h"
+#include "sudokuCandidates.h"
+#include "sudokuSolver.h"
+#include "sudokuGenerate.h"
+#include "sudokuLibrary.h"
+
+#define USAGE "Usage: sudokuFuzz [-r rounds] [-s seed] [-n order] [file ...]"
+
+// Grids checked together: a whole AVX2 block of 32 and a partial one
+#define FUZZ_BLOCK 40
+
+// Largest box order whose grids are solved and counted. Above 9x9 only
+// grids with at least half their cells given are, as a sparse 16x16 puzzle
+// can keep the search busy for minutes
+#define FUZZ_MAXSOLVEORDER 4
+
+// Threads of the parallel solver and counter
+#define FUZZ_THREADS 3
+
+// Longest text of the parser cases and largest fuzz input read from a file
+#define FUZZ_MAXTEXT (16 * MAXCELLS)
+
+// Bytes of the record cache per cell of its puzzles: some 1500 entries,
+// so entries are also evicted
+#define FUZZ_CACHECELLBYTES 32768
+
+// Kinds of generated grids
+#define KIND_SOLUTION 0
+#define KIND_INVALID 1
+#define KIND_PUZZLE 2
+#define KIND_MUTATED 3
+#define KIND_OUTOFRANGE 4
+#define KIND_EDGE 5
+#define KIND_COUNT 6
+
+// Fuzz input modes
+#define MODE_GRID 0
+#define MODE_TEXT 1
+#define MODE_PACKED 2
+#define MODE_COUNT 3
+
+// Cases run, for the summary line
+static long gridCount;
+static long textCount;
+static long packedCount;
+
+static SudokuCache *caches[MAXORDER + 1];  // canonical caches, made on use
+static UnitTable classicUnits;              // rows, columns and boxes
+static OutputBuffer expected;               // result of the reference
+static OutputBuffer found;                  // result of the fast path
+
+static void fuzzInput(const unsigned char *data, size_t length);
+static void fuzzBlock(SudokuGrid grids[], int count, int solve);
+static void fuzzBatchChunk(SudokuGrid grids[], int count);
+static void fuzzCandidates(const SudokuGrid *grid);
+static void fuzzCache(const SudokuGrid *grid, char command);
+static void fuzzSolver(const SudokuGrid *grid);
+static void fuzzSession(const SudokuGrid *grid, SudokuRandom *random);
+static void fuzzText(int order, const char *text, size_t length);
+static void fuzzPacked(int order, const unsigned char *bytes, size_t length);
+static int referenceCheck(const SudokuGrid *grid);
+static int referenceConflicts(const SudokuGrid *grid);
+static void referenceCandidates(const SudokuGrid *grid, OutputBuffer *output);
+static DigitMask referenceMask(const SudokuGrid *grid, int rowIndex,
+        int columnIndex);
+static int inRange(const SudokuGrid *grid);
+static int givenCount(const SudokuGrid *grid);
+static void runRecord(const SudokuGrid *grid, char command,
+        OutputBuffer *output);
+static void compareOutput(const char *what, const SudokuGrid *grid);
+static void fail(const char *what, const SudokuGrid *grid);
+static void failText(const char *what, int order, const char *text,
+        size_t length);
+
+#ifndef SUDOKU_LIBFUZZER
+static void fuzzRound(int order, SudokuRandom *random);
+static void buildGrid(SudokuGrid *grid, int kind, SudokuRandom *random);
+static void buildText(int order, SudokuRandom *random, char *text,
+        size_t *length);
+#endif
+
+#ifdef SUDOKU_LIBFUZZER
+
+/****************************** LLVMFuzzerTestOneInput **************************
+ * int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+ * Purpose:
+ *     Entry point of libFuzzer: runs one fuzz input.
+ * Returns
+ *     0, as libFuzzer requires
+ *******************************************************************************/
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    fuzzInput(data, size);
+    return 0;
+}
+
+#else
+
+// Main Program
+int main(int argc, char *argv[])
+{
+    static unsigned char input[FUZZ_MAXTEXT];
+    int firstOrder = MINORDER;
+    int lastOrder = FUZZ_MAXSOLVEORDER;
+    long roundCount = 100;
+    unsigned long long seed = 1;
+    long roundIndex;
+    ssize_t readLength;
+    size_t length;
+    int option;
+    int order;
+    int fd;
+    SudokuRandom random;
+
+    // Process command options
+    while ((option = getopt(argc, argv, "r:s:n:")) != -1)
+    {
+        switch (option)
+        {
+            case 'r':
+                roundCount = parseNumber(optarg, 1, LONG_MAX,
+                        "Rounds must be 1 or more.");
+                break;
+            case 's':
+                seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'n':
+                firstOrder = lastOrder = (int)parseNumber(optarg, MINORDER,
+                        MAXORDER, "Box order must be 2 thru 6.");
+                break;
+            default:
+                exitError(USAGE);
+        }
+    }
+
+    // Every file named is one fuzz input
+    if (optind < argc)
+    {
+        for (; optind < argc; optind++)
+        {
+            fd = open(argv[optind], O_RDONLY);
+            if (fd < 0)
+            {
+                exitError("Cannot open fuzz input.");
+            }
+            length = 0;
+            while (length < sizeof(input) && (readLength = read(fd,
+                            input + length, sizeof(input) - length)) > 0)
+            {
+                length += (size_t)readLength;
+            }
+            close(fd);
+            fuzzInput(input, length);
+        }
+    } else
+    {
+        randomSeed(&random, seed);
+        for (order = firstOrder; order <= lastOrder; order++)
+        {
+            for (roundIndex = 0; roundIndex < roundCount; roundIndex++)
+            {
+                fuzzRound(order, &random);
+            }
+        }
+    }
+    printf("%ld grids, %ld texts, %ld packed records: no mismatches\n",
+            gridCount, textCount, packedCount);
+    return 0;
+} // end of main
+
+/****************************** fuzzRound ***************************************
+ * static void fuzzRound(int order, SudokuRandom *random);
+ * Purpose:
+ *     Runs one block of generated grids, one generated text and one
+ *     generated packed record.
+ * Parameters:
+ *     I    order       box order
+ *     I/O  random      generator
+ *******************************************************************************/
+static void fuzzRound(int order, SudokuRandom *random)
+{
+    static SudokuCell cells[FUZZ_BLOCK][MAXCELLS];
+    static char text[FUZZ_MAXTEXT];
+    unsigned char bytes[PACKED_MAXRECORDSIZE];
+    SudokuGrid grids[FUZZ_BLOCK];
+    size_t length;
+    size_t byteIndex;
+    int gridIndex;
+
+    for (gridIndex = 0; gridIndex < FUZZ_BLOCK; gridIndex++)
+    {
+        initGrid(&grids[gridIndex], order, cells[gridIndex]);
+        buildGrid(&grids[gridIndex], randomBelow(random, KIND_COUNT), random);
+    }
+    fuzzBlock(grids, FUZZ_BLOCK, order <= FUZZ_MAXSOLVEORDER);
+
+    buildText(order, random, text, &length);
+    fuzzText(order, text, length);
+
+    // Mostly small values, so in range and out of range records both occur
+    length = PACKED_RECORDSIZE(order * order);
+    for (byteIndex = 0; byteIndex < length; byteIndex++)
+    {
+        bytes[byteIndex] = (unsigned char)(randomBelow(random, 8) != 0
+                ? randomBelow(random, 256) & 0x33 : randomBelow(random, 256));
+    }
+    fuzzPacked(order, bytes, length);
+}
+
+/****************************** buildGrid ***************************************
+ * static void buildGrid(SudokuGrid *grid, int kind, SudokuRandom *random);
+ * Purpose:
+ *     Fills a grid with a generated case of the given kind.
+ * Parameters:
+ *     I/O  grid        grid to fill; its order is kept
+ *     I    kind        KIND_SOLUTION thru KIND_EDGE
+ *     I/O  random      generator
+ *******************************************************************************/
+static void buildGrid(SudokuGrid *grid, int kind, SudokuRandom *random)
+{
+    const int order = grid->order;
+    const int size = grid->size;
+    const int cellCount = size * size;
+    int rowIndex;
+    int columnIndex;
+    int changeCount;
+    int first;
+    int second;
+    int pattern;
+    SudokuCell swap;
+
+    switch (kind)
+    {
+        case KIND_SOLUTION:
+            generateSolution(grid, random);
+            break;
+        case KIND_INVALID:
+            generateInvalid(grid, random);
+            break;
+        case KIND_PUZZLE:
+            generatePuzzle(grid, randomBelow(random, cellCount + 1), random);
+            break;
+        case KIND_MUTATED:
+            // Swaps and changed values, each of which may break a unit
+            generateSolution(grid, random);
+            for (changeCount = 1 + randomBelow(random, 3); changeCount > 0;
+                    changeCount--)
+            {
+                first = randomBelow(random, cellCount);
+                if (randomBelow(random, 2))
+                {
+                    second = randomBelow(random, cellCount);
+                    swap = grid->cells[first];
+                    grid->cells[first] = grid->cells[second];
+                    grid->cells[second] = swap;
+                } else
+                {
+                    grid->cells[first] = (SudokuCell)randomBelow(random,
+                            size + 1);
+                }
+            }
+            break;
+        case KIND_OUTOFRANGE:
+            generateSolution(grid, random);
+            grid->cells[randomBelow(random, cellCount)] =
+                (SudokuCell)(size + 1 + randomBelow(random, 63 - size));
+            break;
+        default:
+            // Uniform grids, and patterns right in some units only
+            pattern = randomBelow(random, 4);
+            for (rowIndex = 0; rowIndex < size; rowIndex++)
+            {
+                for (columnIndex = 0; columnIndex < size; columnIndex++)
+                {
+                    grid->cells[rowIndex * size + columnIndex] = (SudokuCell)(
+                        pattern == 0 ? 0
+                        : pattern == 1 ? size
+                        // Latin square: rows and columns only
+                        : pattern == 2 ? (rowIndex + columnIndex) % size + 1
+                        // Band shifted rows: a correct solution
+                        : ((rowIndex % order) * order + rowIndex / order
+                            + columnIndex) % size + 1);
+                }
+            }
+            // Rows of different bands swapped keep rows and columns right
+            if (pattern == 3 && randomBelow(random, 2))
+            {
+                for (columnIndex = 0; columnIndex < size; columnIndex++)
+                {
+                    swap = grid->cells[columnIndex];
+                    grid->cells[columnIndex] =
+                        grid->cells[order * size + columnIndex];
+                    grid->cells[order * size + columnIndex] = swap;
+                }
+            }
+            break;
+    }
+}
+
+/****************************** buildText ***************************************
+ * static void buildText(int order, SudokuRandom *random, char *text,
+ *         size_t *length);
+ * Purpose:
+ *     Writes a few grids' worth of puzzle text with malformed tokens mixed
+ *     in: letters, signs, numbers too large, long runs of zeros and line
+ *     breaks of every kind.
+ * Parameters:
+ *     I    order       box order
+ *     I/O  random      generator
+ *     O    text        FUZZ_MAXTEXT bytes; not null terminated
+ *     O    length      bytes written
+ *******************************************************************************/
+static void buildText(int order, SudokuRandom *random, char *text,
+        size_t *length)
+{
+    static const char *const pieces[] = {" ", " ", "\n", "\t", "\r\n", "x",
+        "-1", "+", "10", "99", "007", "0000000000000000001", "12345678901234",
+        "\0", "1a"};
+    const int size = order * order;
+    const size_t limit = (size_t)(2 + randomBelow(random, 3)) * size * size
+        * (size > 9 ? 3 : 1);
+    const char *piece;
+    char number[4];
+
+    *length = 0;
+    while (*length < limit && *length + 32 < FUZZ_MAXTEXT)
+    {
+        if (randomBelow(random, 8) != 0)
+        {
+            // A value, with the separator larger grids need
+            snprintf(number, sizeof(number), "%d",
+                    randomBelow(random, size + 1));
+            piece = number;
+            if (size > 9)
+            {
+                text[(*length)++] = ' ';
+            }
+        } else
+        {
+            piece = pieces[randomBelow(random,
+                    sizeof(pieces) / sizeof(pieces[0]))];
+        }
+        if (piece[0] == '\0')
+        {
+            text[(*length)++] = '\0';
+            continue;
+        }
+        memcpy(text + *length, piece, strlen(piece));
+        *length += strlen(piece);
+    }
+}
+
+#endif
+
+/****************************** fuzzInput ***************************************
+ * static void fuzzInput(const unsigned char *data, size_t length);
+ * Purpose:
+ *     Runs one fuzz input from AFL, libFuzzer or a file.
+ * Parameters:
+ *     I    data        byte 0 picks the box order, byte 1 the mode; the
+ *                      rest is the case
+ *     I    length      number of bytes in data
+ * Notes:
+ *     MODE_GRID       one byte per cell: bytes below 0xC0 are values 0 thru
+ *                     size, the others values 0 thru 63, mostly out of
+ *                     range. Cells past the input keep a generated
+ *                     solution, so short inputs are near misses. The grid
+ *                     and single cell changes of it fill a block.
+ *     MODE_TEXT       text for the parsers
+ *     MODE_PACKED     packed records after a well formed header
+ *******************************************************************************/
+static void fuzzInput(const unsigned char *data, size_t length)
+{
+    static SudokuCell cells[FUZZ_BLOCK][MAXCELLS];
+    SudokuGrid grids[FUZZ_BLOCK];
+    SudokuRandom random;
+    int order;
+    int cellCount;
+    int cellIndex;
+    int gridIndex;
+
+    if (length < 2)
+    {
+        return;
+    }
+    order = MINORDER + data[0] % (MAXORDER - MINORDER + 1);
+    cellCount = order * order * order * order;
+    randomSeed(&random, length);
+    switch (data[1] % MODE_COUNT)
+    {
+        case MODE_GRID:
+            initGrid(&grids[0], order, cells[0]);
+            generateSolution(&grids[0], &random);
+            for (cellIndex = 0; cellIndex < cellCount
+                    && (size_t)cellIndex + 2 < length; cellIndex++)
+            {
+                cells[0][cellIndex] = (SudokuCell)(data[cellIndex + 2] < 0xC0
+                        ? data[cellIndex + 2] % (order * order + 1)
+                        : data[cellIndex + 2] - 0xC0);
+            }
+            for (gridIndex = 1; gridIndex < FUZZ_BLOCK; gridIndex++)
+            {
+                initGrid(&grids[gridIndex], order, cells[gridIndex]);
+                memcpy(cells[gridIndex], cells[0], sizeof(SudokuCell)
+                        * cellCount);
+                cells[gridIndex][randomBelow(&random, cellCount)] =
+                    (SudokuCell)randomBelow(&random, order * order + 1);
+            }
+            fuzzBlock(grids, FUZZ_BLOCK, order <= DEFAULTORDER);
+            break;
+        case MODE_TEXT:
+            fuzzText(order, (const char *)data + 2, length - 2);
+            break;
+        default:
+            fuzzPacked(order, data + 2, length - 2);
+            break;
+    }
+}
+
+/****************************** fuzzBlock ***************************************
+ * static void fuzzBlock(SudokuGrid grids[], int count, int solve);
+ * Purpose:
+ *     Cross-checks every fast path on a block of grids.
+ * Parameters:
+ *     I    grids       grids of one box order, values 0 thru 63
+ *     I    count       number of grids, at most FUZZ_BLOCK
+ *     I    solve       0 to leave out solving and counting
+ *******************************************************************************/
+static void fuzzBlock(SudokuGrid grids[], int count, int solve)
+{
+    const SudokuGrid *pointers[FUZZ_BLOCK];
+    unsigned char results[FUZZ_BLOCK];
+    SudokuRandom random;
+    int reference;
+    int gridIndex;
+    int level;
+
+    if (classicUnits.order != grids[0].order)
+    {
+        initUnitTable(&classicUnits, grids[0].order);
+    }
+    for (gridIndex = 0; gridIndex < count; gridIndex++)
+    {
+        pointers[gridIndex] = &grids[gridIndex];
+    }
+
+    // Every kernel the host has, on the whole block and on a short tail
+    for (level = SIMD_SCALAR; level <= simdLevel(); level++)
+    {
+        checkSudokuGridsLevel(level, pointers, count, results);
+        for (gridIndex = 0; gridIndex < count; gridIndex++)
+        {
+            if (results[gridIndex] != referenceCheck(&grids[gridIndex]))
+            {
+                fail("checkSudokuGridsLevel()", &grids[gridIndex]);
+            }
+        }
+    }
+
+    randomSeed(&random, (uint64_t)count * grids[0].cells[0]);
+    for (gridIndex = 0; gridIndex < count; gridIndex++)
+    {
+        reference = referenceCheck(&grids[gridIndex]);
+        if (checkSudoku(&grids[gridIndex]) != reference)
+        {
+            fail("checkSudoku()", &grids[gridIndex]);
+        }
+        if (checkUnits(&classicUnits, &grids[gridIndex]) != reference)
+        {
+            fail("checkUnits()", &grids[gridIndex]);
+        }
+        if ((checkRows(&grids[gridIndex]) && checkColumns(&grids[gridIndex])
+                    && checkRegions(&grids[gridIndex])) != reference)
+        {
+            fail("checkRows(), checkColumns(), checkRegions()",
+                    &grids[gridIndex]);
+        }
+        fuzzSession(&grids[gridIndex], &random);
+        gridCount++;
+        // The reader never yields values larger than size
+        if (!inRange(&grids[gridIndex]))
+        {
+            continue;
+        }
+        fuzzCandidates(&grids[gridIndex]);
+        fuzzCache(&grids[gridIndex], 'C');
+        fuzzCache(&grids[gridIndex], 'L');
+        if (solve && (grids[gridIndex].order <= DEFAULTORDER
+                    || 2 * givenCount(&grids[gridIndex])
+                    >= grids[gridIndex].size * grids[gridIndex].size))
+        {
+            fuzzCache(&grids[gridIndex], 'S');
+            fuzzSolver(&grids[gridIndex]);
+        }
+    }
+    fuzzBatchChunk(grids, count);
+}
+
+/****************************** fuzzBatchChunk **********************************
+ * static void fuzzBatchChunk(SudokuGrid grids[], int count);
+ * Purpose:
+ *     Processes a block as one batch chunk, whose C records are checked
+ *     together by checkSudokuGrids(), and compares the result lines with
+ *     those of the records processed one by one.
+ * Parameters:
+ *     I    grids       grids of one box order
+ *     I    count       number of grids
+ *******************************************************************************/
+static void fuzzBatchChunk(SudokuGrid grids[], int count)
+{
+    static BatchChunk chunk;
+    const size_t cellBytes = sizeof(SudokuCell) * grids[0].size
+        * grids[0].size;
+    BatchRecord *record;
+    int gridIndex;
+
+    initBatchChunk(&chunk, grids[0].order);
+    for (gridIndex = 0; gridIndex < count; gridIndex++)
+    {
+        record = &chunk.records[gridIndex];
+        memcpy(record->grid.cells, grids[gridIndex].cells, cellBytes);
+        // Some L records, so C records are not all consecutive
+        record->command = gridIndex % 5 == 4 && inRange(&grids[gridIndex])
+            ? 'L' : gridIndex % 2 ? 'c' : 'C';
+        record->seed = 0;
+        record->errorLine = 0;
+        record->truncated = 0;
+    }
+    chunk.recordCount = count;
+    processBatchChunk(&chunk);
+
+    expected.length = 0;
+    for (gridIndex = 0; gridIndex < count; gridIndex++)
+    {
+        processRecord(&chunk.records[gridIndex], &expected);
+    }
+    if (chunk.output.length != expected.length
+            || memcmp(chunk.output.data, expected.data, expected.length) != 0)
+    {
+        fail("processBatchChunk()", &grids[0]);
+    }
+    freeBatchChunk(&chunk);
+}
+
+/****************************** fuzzCandidates **********************************
+ * static void fuzzCandidates(const SudokuGrid *grid);
+ * Purpose:
+ *     Compares the possible values listed by formatCandidates() and by
+ *     formatUnitCandidates() with the classic units against the reference.
+ *******************************************************************************/
+static void fuzzCandidates(const SudokuGrid *grid)
+{
+    expected.length = 0;
+    referenceCandidates(grid, &expected);
+    found.length = 0;
+    formatCandidates(grid, &found, "");
+    compareOutput("formatCandidates()", grid);
+    found.length = 0;
+    formatUnitCandidates(&classicUnits, grid, &found, "");
+    compareOutput("formatUnitCandidates()", grid);
+}
+
+/****************************** fuzzCache ***************************************
+ * static void fuzzCache(const SudokuGrid *grid, char command);
+ * Purpose:
+ *     Runs a batch record without the record cache, then twice through a
+ *     canonical cache, missing or hitting an equivalent grid and then
+ *     hitting, and compares the result lines.
+ * Parameters:
+ *     I    grid        grid of the record, values 0 thru size
+ *     I    command     C, L or S
+ * Notes:
+ *     A grid equivalent to one seen before gets that grid's solution
+ *     mapped to its own frame, which need not be the solution the solver
+ *     finds first when there are several, so S results from the cache are
+ *     checked for being a solution of the puzzle instead.
+ *******************************************************************************/
+static void fuzzCache(const SudokuGrid *grid, char command)
+{
+    SudokuCell cells[MAXCELLS];
+    SudokuGrid solution;
+    int pass;
+    int cellIndex;
+
+    if (caches[grid->order] == NULL)
+    {
+        caches[grid->order] = createCache(grid->order,
+                (size_t)FUZZ_CACHECELLBYTES * grid->size * grid->size, 1);
+    }
+    expected.length = 0;
+    runRecord(grid, command, &expected);
+    for (pass = 0; pass < 2; pass++)
+    {
+        setRecordCache(caches[grid->order]);
+        found.length = 0;
+        runRecord(grid, command, &found);
+        setRecordCache(NULL);
+        if (command != 'S' || strcmp(expected.data, "No solution.\n") == 0)
+        {
+            compareOutput(pass == 0 ? "runCached() first pass"
+                    : "runCached() second pass", grid);
+            continue;
+        }
+        initGrid(&solution, grid->order, cells);
+        if (sudokuParseGrid(&solution, found.data, found.length, NULL)
+                != SUDOKU_OK || !referenceCheck(&solution))
+        {
+            fail("runCached() solution", grid);
+        }
+        for (cellIndex = 0; cellIndex < grid->size * grid->size; cellIndex++)
+        {
+            if (grid->cells[cellIndex] != 0
+                    && grid->cells[cellIndex] != cells[cellIndex])
+            {
+                fail("runCached() solution given", grid);
+            }
+        }
+    }
+}
+
+/****************************** fuzzSolver **************************************
+ * static void fuzzSolver(const SudokuGrid *grid);
+ * Purpose:
+ *     Compares the work-stealing solver with the single threaded solver,
+ *     which must find the same first solution, and the threaded counter
+ *     with the single threaded counter.
+ * Parameters:
+ *     I    grid        puzzle, values 0 thru size
+ *******************************************************************************/
+static void fuzzSolver(const SudokuGrid *grid)
+{
+    const size_t cellBytes = sizeof(SudokuCell) * grid->size * grid->size;
+    SudokuCell sequentialCells[MAXCELLS];
+    SudokuCell parallelCells[MAXCELLS];
+    SudokuGrid sequential;
+    SudokuGrid parallel;
+    long nodes;
+
+    initGrid(&sequential, grid->order, sequentialCells);
+    initGrid(&parallel, grid->order, parallelCells);
+    memcpy(sequentialCells, grid->cells, cellBytes);
+    memcpy(parallelCells, grid->cells, cellBytes);
+    if (solveSudokuNodes(&sequential, &nodes)
+            != solveSudokuParallel(&parallel, FUZZ_THREADS, &nodes)
+            || memcmp(sequentialCells, parallelCells, cellBytes) != 0)
+    {
+        fail("solveSudokuParallel()", grid);
+    }
+    if (countSolutions(grid, 2, &nodes)
+            != countSudoku(grid, 2, FUZZ_THREADS, &nodes))
+    {
+        fail("countSudoku()", grid);
+    }
+}
+
+/****************************** fuzzSession *************************************
+ * static void fuzzSession(const SudokuGrid *grid, SudokuRandom *random);
+ * Purpose:
+ *     Starts a game session on a grid and plays random moves, comparing the
+ *     conflicts, solved state and candidates the session keeps with those
+ *     of the whole grid after every move.
+ * Parameters:
+ *     I    grid        puzzle, values 0 thru 63
+ *     I/O  random      generator of the moves
+ *******************************************************************************/
+static void fuzzSession(const SudokuGrid *grid, SudokuRandom *random)
+{
+    static SudokuSession session;
+    const int size = grid->size;
+    int moveIndex;
+    int row;
+    int column;
+    int value;
+    int result;
+
+    result = sudokuSessionStart(&session, grid);
+    if (result != (inRange(grid) ? SUDOKU_OK : SUDOKU_ERROR_INVALID))
+    {
+        fail("sudokuSessionStart()", grid);
+    }
+    if (result != SUDOKU_OK)
+    {
+        // A rejected puzzle leaves the session not started
+        if (sudokuSessionPlace(&session, 0, 0, 1) != SUDOKU_ERROR_ORDER
+                || sudokuSessionUndo(&session) != SUDOKU_ERROR_ORDER
+                || sudokuSessionSolved(&session) != SUDOKU_ERROR_ORDER
+                || sudokuSessionConflicts(&session) != SUDOKU_ERROR_ORDER
+                || sudokuSessionCandidates(&session, 0, 0) != 0)
+        {
+            fail("sudokuSessionStart() rejected", grid);
+        }
+        return;
+    }
+    for (moveIndex = 0; moveIndex <= size; moveIndex++)
+    {
+        if (sudokuSessionConflicts(&session)
+                != referenceConflicts(&session.grid)
+                || sudokuSessionSolved(&session)
+                != referenceCheck(&session.grid))
+        {
+            fail("sudokuSessionConflicts()", &session.grid);
+        }
+        row = randomBelow(random, size);
+        column = randomBelow(random, size);
+        if (sudokuSessionCandidates(&session, row, column)
+                != (session.cells[row * size + column] == 0
+                    ? referenceMask(&session.grid, row, column) : 0))
+        {
+            fail("sudokuSessionCandidates()", &session.grid);
+        }
+        value = randomBelow(random, size + 1);
+        switch (randomBelow(random, 4))
+        {
+            case 0:
+                result = sudokuSessionErase(&session, row, column);
+                break;
+            case 1:
+                result = sudokuSessionUndo(&session);
+                if (result == SUDOKU_ERROR_NOMOVE)
+                {
+                    result = SUDOKU_OK;
+                }
+                break;
+            default:
+                result = value != 0
+                    ? sudokuSessionPlace(&session, row, column, value)
+                    : sudokuSessionErase(&session, row, column);
+                break;
+        }
+        if (result < 0 && (result != SUDOKU_ERROR_GIVEN
+                    || grid->cells[row * size + column] == 0))
+        {
+            fail("sudokuSessionPlace()", &session.grid);
+        }
+    }
+}
+
+/****************************** fuzzText ****************************************
+ * static void fuzzText(int order, const char *text, size_t length);
+ * Purpose:
+ *     Decodes text as grids with readerNextGrid() and with the
+ *     readerNextValue() loop of getSudokuValues(), which must agree on
+ *     every value, every malformed token and the lines counted; and the
+ *     first grid with sudokuParseGrid(), which stops at the first
+ *     malformed token.
+ * Parameters:
+ *     I    order       box order
+ *     I    text        puzzle text, any bytes
+ *     I    length      bytes of text
+ *******************************************************************************/
+static void fuzzText(int order, const char *text, size_t length)
+{
+    static SudokuReader fastReader;
+    static SudokuReader valueReader;
+    SudokuCell fastCells[MAXCELLS];
+    SudokuCell valueCells[MAXCELLS];
+    SudokuCell parseCells[MAXCELLS];
+    SudokuGrid fastGrid;
+    SudokuGrid parseGrid;
+    const int cellCount = order * order * order * order;
+    char firstToken[READER_TOKENSIZE];
+    long firstLine = 0;
+    int gridResult;
+    int valueResult = READER_OK;
+    int errorCount;
+    int cellIndex;
+    int value;
+    int parseResult;
+    size_t consumed;
+
+    initGrid(&fastGrid, order, fastCells);
+    readerInitMemory(&fastReader, text, length);
+    readerInitMemory(&valueReader, text, length);
+    for (;;)
+    {
+        gridResult = readerNextGrid(&fastReader, &fastGrid);
+        errorCount = 0;
+        for (cellIndex = 0; cellIndex < cellCount; cellIndex++)
+        {
+            while ((valueResult = readerNextValue(&valueReader, &value,
+                            order * order)) == READER_INVALID)
+            {
+                if (errorCount++ == 0)
+                {
+                    memcpy(firstToken, valueReader.errorToken,
+                            READER_TOKENSIZE);
+                    firstLine = valueReader.errorLine;
+                }
+            }
+            if (valueResult == READER_EOF)
+            {
+                break;
+            }
+            valueCells[cellIndex] = (SudokuCell)value;
+        }
+        if (gridResult != valueResult
+                || fastReader.lineNumber != valueReader.lineNumber)
+        {
+            failText("readerNextGrid() end of input", order, text, length);
+        }
+        if (gridResult == READER_EOF)
+        {
+            break;
+        }
+        if (memcmp(fastCells, valueCells, cellCount) != 0
+                || fastReader.errorCount != errorCount
+                || fastReader.position != valueReader.position
+                || (errorCount != 0
+                    && (fastReader.errorLine != firstLine
+                        || strcmp(fastReader.errorToken, firstToken) != 0)))
+        {
+            failText("readerNextGrid()", order, text, length);
+        }
+        // The reader never yields values larger than size
+        for (cellIndex = 0; cellIndex < cellCount; cellIndex++)
+        {
+            if (fastCells[cellIndex] > order * order)
+            {
+                failText("readerNextGrid() range", order, text, length);
+            }
+        }
+    }
+    readerClose(&fastReader);
+    readerClose(&valueReader);
+    textCount++;
+
+    // The library parser stops at the first malformed token of the first
+    // grid; so far it must agree with the reader
+    initGrid(&parseGrid, order, parseCells);
+    parseResult = sudokuParseGrid(&parseGrid, text, length, &consumed);
+    readerInitMemory(&valueReader, text, length);
+    for (cellIndex = 0; cellIndex < cellCount; cellIndex++)
+    {
+        valueResult = readerNextValue(&valueReader, &value, order * order);
+        if (valueResult != READER_OK)
+        {
+            break;
+        }
+        if (parseCells[cellIndex] != value)
+        {
+            failText("sudokuParseGrid() value", order, text, length);
+        }
+    }
+    if (parseResult != (valueResult == READER_INVALID ? SUDOKU_ERROR_INVALID
+                : valueResult == READER_EOF ? SUDOKU_ERROR_INCOMPLETE
+                : SUDOKU_OK)
+            || (parseResult == SUDOKU_OK && consumed != valueReader.position))
+    {
+        failText("sudokuParseGrid()", order, text, length);
+    }
+    readerClose(&valueReader);
+}
+
+/****************************** fuzzPacked **************************************
+ * static void fuzzPacked(int order, const unsigned char *bytes,
+ *         size_t length);
+ * Purpose:
+ *     Unpacks records with readerNextPacked() and one bit at a time, which
+ *     must agree on every value and on the values out of range.
+ * Parameters:
+ *     I    order       box order
+ *     I    bytes       packed records, without the header
+ *     I    length      number of bytes
+ *******************************************************************************/
+static void fuzzPacked(int order, const unsigned char *bytes, size_t length)
+{
+    static SudokuReader reader;
+    const int size = order * order;
+    const int bits = PACKED_BITS(size);
+    const size_t recordLength = PACKED_RECORDSIZE(size);
+    SudokuCell cells[MAXCELLS];
+    SudokuGrid grid;
+    OutputBuffer input;
+    const unsigned char *record;
+    char command;
+    int errorCount;
+    int cellIndex;
+    int bitIndex;
+    int value;
+
+    outputInit(&input);
+    formatPackedHeader(order, &input);
+    outputAppend(&input, (const char *)bytes, length);
+    initGrid(&grid, order, cells);
+    readerInitMemory(&reader, input.data, input.length);
+    if (readerDetectPacked(&reader) != order)
+    {
+        failText("readerDetectPacked()", order, input.data, input.length);
+    }
+    for (record = bytes; record + recordLength <= bytes + length;
+            record += recordLength)
+    {
+        if (readerNextPacked(&reader, &command, &grid) != READER_OK
+                || command != (char)record[0])
+        {
+            failText("readerNextPacked() record", order, input.data,
+                    input.length);
+        }
+        errorCount = 0;
+        for (cellIndex = 0; cellIndex < size * size; cellIndex++)
+        {
+            value = 0;
+            for (bitIndex = bits - 1; bitIndex >= 0; bitIndex--)
+            {
+                value = value << 1 | ((record[1 + (cellIndex * bits
+                                    + bitIndex) / 8]
+                            >> ((cellIndex * bits + bitIndex) % 8)) & 1);
+            }
+            if (value > size)
+            {
+                errorCount++;
+                value = 0;
+            }
+            if (cells[cellIndex] != value)
+            {
+                failText("readerNextPacked() value", order, input.data,
+                        input.length);
+            }
+        }
+        if (reader.errorCount != errorCount)
+        {
+            failText("readerNextPacked() range", order, input.data,
+                    input.length);
+        }
+        packedCount++;
+    }
+    if (readerNextPacked(&reader, &command, &grid) != READER_EOF)
+    {
+        failText("readerNextPacked() end of input", order, input.data,
+                input.length);
+    }
+    readerClose(&reader);
+    outputFree(&input);
+}
+
+/****************************** referenceCheck **********************************
+ * static int referenceCheck(const SudokuGrid *grid);
+ * Purpose:
+ *     Checks a solution by counting how often each value appears in every
+ *     row, column and region, without the digit masks of the fast paths.
+ * Returns
+ *     1 for a correct solution, else 0
+ *******************************************************************************/
+static int referenceCheck(const SudokuGrid *grid)
+{
+    const int order = grid->order;
+    const int size = grid->size;
+    int count[MAXSIZE + 1];
+    int unit;
+    int unitIndex;
+    int index;
+    int countIndex;
+    int value;
+
+    // Units 0 thru size - 1 are rows, then columns, then regions
+    for (unit = 0; unit < 3 * size; unit++)
+    {
+        unitIndex = unit % size;
+        memset(count, 0, sizeof(count));
+        for (index = 0; index < size; index++)
+        {
+            if (unit < size)
+            {
+                value = grid->cells[unitIndex * size + index];
+            } else if (unit < 2 * size)
+            {
+                value = grid->cells[index * size + unitIndex];
+            } else
+            {
+                value = grid->cells[(unitIndex / order * order + index / order)
+                    * size + unitIndex % order * order + index % order];
+            }
+            if (value > size)
+            {
+                return 0; // out of range
+            }
+            count[value]++;
+        }
+        // Values 1 thru size present once each; no empty cell
+        for (countIndex = 1; countIndex <= size; countIndex++)
+        {
+            if (count[countIndex] != 1)
+            {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/****************************** referenceConflicts ******************************
+ * static int referenceConflicts(const SudokuGrid *grid);
+ * Purpose:
+ *     Counts every value beyond the first of its kind in each row, column
+ *     and region, scanning the whole grid.
+ * Returns
+ *     Number of conflicts
+ *******************************************************************************/
+static int referenceConflicts(const SudokuGrid *grid)
+{
+    const int order = grid->order;
+    const int size = grid->size;
+    int counts[MAXSIZE + 1];
+    int conflicts = 0;
+    int unitIndex;
+    int memberIndex;
+    int row;
+    int column;
+
+    for (unitIndex = 0; unitIndex < 3 * size; unitIndex++)
+    {
+        memset(counts, 0, sizeof(counts));
+        for (memberIndex = 0; memberIndex < size; memberIndex++)
+        {
+            // Rows, then columns, then regions
+            if (unitIndex < size)
+            {
+                row = unitIndex;
+                column = memberIndex;
+            } else if (unitIndex < 2 * size)
+            {
+                row = memberIndex;
+                column = unitIndex - size;
+            } else
+            {
+                row = (unitIndex - 2 * size) / order * order
+                    + memberIndex / order;
+                column = (unitIndex - 2 * size) % order * order
+                    + memberIndex % order;
+            }
+            if (grid->cells[row * size + column] != 0
+                    && counts[grid->cells[row * size + column]]++ != 0)
+            {
+                conflicts++;
+            }
+        }
+    }
+    return conflicts;
+}
+
+/****************************** referenceCandidates *****************************
+ * static void referenceCandidates(const SudokuGrid *grid,
+ *         OutputBuffer *output);
+ * Purpose:
+ *     Appends the possible values of every empty cell in the layout of
+ *     option L, as found by referenceMask().
+ * Parameters:
+ *     I    grid        puzzle, values 0 thru size
+ *     I/O  output      buffer to append to
+ *******************************************************************************/
+static void referenceCandidates(const SudokuGrid *grid, OutputBuffer *output)
+{
+    const int size = grid->size;
+    DigitMask candidates;
+    int rowIndex;
+    int columnIndex;
+    int value;
+
+    for (rowIndex = 0; rowIndex < size; rowIndex++)
+    {
+        for (columnIndex = 0; columnIndex < size; columnIndex++)
+        {
+            if (grid->cells[rowIndex * size + columnIndex] != 0)
+            {
+                continue;
+            }
+            outputAppendString(output, "[");
+            outputAppendNumber(output, rowIndex);
+            outputAppendString(output, "][");
+            outputAppendNumber(output, columnIndex);
+            outputAppendString(output, "]: ");
+            candidates = referenceMask(grid, rowIndex, columnIndex);
+            for (value = 1; value <= size; value++)
+            {
+                if (candidates & DIGITBIT(value))
+                {
+                    outputAppendNumber(output, value);
+                    outputAppendString(output, " ");
+                }
+            }
+        }
+    }
+}
+
+/****************************** referenceMask ***********************************
+ * static DigitMask referenceMask(const SudokuGrid *grid, int rowIndex,
+ *         int columnIndex);
+ * Purpose:
+ *     Finds the possible values of a cell by trying every value against
+ *     every cell of its row, column and region.
+ * Returns
+ *     Bit n set when n is possible
+ *******************************************************************************/
+static DigitMask referenceMask(const SudokuGrid *grid, int rowIndex,
+        int columnIndex)
+{
+    const int order = grid->order;
+    const int size = grid->size;
+    const int top = rowIndex / order * order;
+    const int left = columnIndex / order * order;
+    DigitMask candidates = 0;
+    int value;
+    int index;
+    int used;
+
+    for (value = 1; value <= size; value++)
+    {
+        used = 0;
+        for (index = 0; index < size; index++)
+        {
+            used |= grid->cells[rowIndex * size + index] == value
+                || grid->cells[index * size + columnIndex] == value
+                || grid->cells[(top + index / order) * size + left
+                    + index % order] == value;
+        }
+        if (!used)
+        {
+            candidates |= DIGITBIT(value);
+        }
+    }
+    return candidates;
+}
+
+/****************************** inRange *****************************************
+ * static int inRange(const SudokuGrid *grid);
+ * Purpose:
+ *     Tells whether every value is 0 thru size, as the reader ensures.
+ *******************************************************************************/
+static int inRange(const SudokuGrid *grid)
+{
+    int cellIndex;
+
+    for (cellIndex = 0; cellIndex < grid->size * grid->size; cellIndex++)
+    {
+        if (grid->cells[cellIndex] > grid->size)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/****************************** givenCount **************************************
+ * static int givenCount(const SudokuGrid *grid);
+ * Purpose:
+ *     Counts the cells holding a value.
+ *******************************************************************************/
+static int givenCount(const SudokuGrid *grid)
+{
+    int cellIndex;
+    int count = 0;
+
+    for (cellIndex = 0; cellIndex < grid->size * grid->size; cellIndex++)
+    {
+        count += grid->cells[cellIndex] != 0;
+    }
+    return count;
+}
+
+/****************************** runRecord ***************************************
+ * static void runRecord(const SudokuGrid *grid, char command,
+ *         OutputBuffer *output);
+ * Purpose:
+ *     Processes a well formed batch record on a copy of a grid, so option S
+ *     leaves the grid as it was, and null terminates the result line.
+ *******************************************************************************/
+static void runRecord(const SudokuGrid *grid, char command,
+        OutputBuffer *output)
+{
+    SudokuCell cells[MAXCELLS];
+    BatchRecord record;
+
+    initGrid(&record.grid, grid->order, cells);
+    memcpy(cells, grid->cells, sizeof(SudokuCell) * grid->size * grid->size);
+    record.command = command;
+    record.seed = 0;
+    record.errorLine = 0;
+    record.truncated = 0;
+    processRecord(&record, output);
+    outputAppend(output, "", 1);
+    output->length--;
+}
+
+/****************************** compareOutput ***********************************
+ * static void compareOutput(const char *what, const SudokuGrid *grid);
+ * Purpose:
+ *     Fails unless the fast path found the same text as the reference.
+ *******************************************************************************/
+static void compareOutput(const char *what, const SudokuGrid *grid)
+{
+    if (found.length != expected.length
+            || memcmp(found.data, expected.data, expected.length) != 0)
+    {
+        fail(what, grid);
+    }
+}
+
+/****************************** fail ********************************************
+ * static void fail(const char *what, const SudokuGrid *grid);
+ * Purpose:
+ *     Prints the routine that disagreed with the reference and the grid,
+ *     then aborts.
+ *******************************************************************************/
+static void fail(const char *what, const SudokuGrid *grid)
+{
+    OutputBuffer output;
+
+    outputInit(&output);
+    formatGrid(grid, &output, " ", "\n");
+    fprintf(stderr, "Mismatch in %s, order %d:\n", what, grid->order);
+    fflush(stderr);
+    outputFlush(&output, stderr);
+    fprintf(stderr, "\n");
+    abort();
+}
+
+/****************************** failText ****************************************
+ * static void failText(const char *what, int order, const char *text,
+ *         size_t length);
+ * Purpose:
+ *     Prints the routine that disagreed with the reference and its input
+ *     text, bytes other than digits, letters and spaces as \xNN, then
+ *     aborts.
+ *******************************************************************************/
+static void failText(const char *what, int order, const char *text,
+        size_t length)
+{
+    size_t position;
+
+    fprintf(stderr, "Mismatch in %s, order %d, %zu bytes:\n", what, order,
+            length);
+    for (position = 0; position < length; position++)
+    {
+        if (text[position] == ' ' || (text[position] >= '0'
+                    && text[position] <= 'z'))
+        {
+            fputc(text[position], stderr);
+        } else
+        {
+            fprintf(stderr, "\\x%02X", (unsigned char)text[position]);
+        }
+    }
+    fprintf(stderr, "\n");
+    abort();
+}
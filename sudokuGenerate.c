@@ -0,0 +1,348 @@
+/*******************************************************************************
+ * sudokuGenerate.c by Geoffrey Sessums
+ * Purpose:
+ *  Builds random solved grids, broken solutions and puzzles for testing
+ *  and benchmarking, and puzzles with a unique solution for option G.
+ * Notes:
+ *  A solved grid starts from the pattern solution
+ *      value(row, column) = (order * (row % order) + row / order + column)
+ *                           % size + 1
+ *  which is then shuffled with moves that keep a solution valid: the digits
+ *  are relabeled, rows are permuted within their band and the bands among
+ *  themselves, the same for columns and stacks, and the grid is transposed
+ *  half of the time. This is fast, though it reaches only part of all
+ *  solutions; that is plenty for measuring throughput.
+ *  Puzzles for people need more variety. generateFilled() fills the
+ *  regions on the diagonal with random digits, which cannot conflict since
+ *  they share no row or column, and lets the solver complete the grid.
+ *  generateUnique() then empties the cells in a random order, putting a
+ *  value back whenever removing it would allow a second solution. Removal
+ *  order is the only choice made, so a seed always gives the same puzzle.
+ ******************************************************************************/
+
+// Header
+#include <stdint.h>
+#include "sudokuChecker.h"
+#include "sudokuCandidates.h"
+#include "sudokuSolver.h"
+#include "sudokuGenerate.h"
+
+/****************************** randomSeed **************************************
+ * void randomSeed(SudokuRandom *random, uint64_t seed);
+ * Purpose:
+ *     Starts a generator; equal seeds give equal sequences.
+ *******************************************************************************/
+void randomSeed(SudokuRandom *random, uint64_t seed)
+{
+    random->state = seed;
+}
+
+/****************************** randomNext **************************************
+ * uint64_t randomNext(SudokuRandom *random);
+ * Purpose:
+ *     Returns the next 64 random bits (splitmix64).
+ *******************************************************************************/
+uint64_t randomNext(SudokuRandom *random)
+{
+    uint64_t value;
+
+    random->state += 0x9E3779B97F4A7C15ULL;
+    value = random->state;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+/****************************** randomBelow *************************************
+ * int randomBelow(SudokuRandom *random, int bound);
+ * Purpose:
+ *     Returns a random number 0 thru bound - 1.
+ * Notes:
+ *     Uses the high bits of a 64 bit product instead of a division; the
+ *     bias is far below anything a benchmark could notice.
+ *******************************************************************************/
+int randomBelow(SudokuRandom *random, int bound)
+{
+    return (int)(((randomNext(random) >> 32) * (uint64_t)bound) >> 32);
+}
+
+/****************************** shuffle *****************************************
+ * static void shuffle(int values[], int count, SudokuRandom *random);
+ * Purpose:
+ *     Puts values in a random order (Fisher-Yates).
+ *******************************************************************************/
+static void shuffle(int values[], int count, SudokuRandom *random)
+{
+    int index;
+    int other;
+    int swap;
+
+    for (index = count - 1; index > 0; index--)
+    {
+        other = randomBelow(random, index + 1);
+        swap = values[index];
+        values[index] = values[other];
+        values[other] = swap;
+    }
+}
+
+/****************************** randomLines *************************************
+ * static void randomLines(int lines[], int order, SudokuRandom *random);
+ * Purpose:
+ *     Builds a random order of the rows (or columns) of a grid that keeps
+ *     the rows of each band together.
+ * Parameters:
+ *     O    lines       lines[n] is the pattern row placed at row n
+ *     I    order       box order
+ *     I/O  random      generator
+ *******************************************************************************/
+static void randomLines(int lines[], int order, SudokuRandom *random)
+{
+    int bands[MAXORDER];
+    int withinBand[MAXORDER];
+    int band;
+    int line;
+
+    for (band = 0; band < order; band++)
+    {
+        bands[band] = band;
+    }
+    shuffle(bands, order, random);
+    for (band = 0; band < order; band++)
+    {
+        for (line = 0; line < order; line++)
+        {
+            withinBand[line] = line;
+        }
+        shuffle(withinBand, order, random);
+        for (line = 0; line < order; line++)
+        {
+            lines[band * order + line] = bands[band] * order + withinBand[line];
+        }
+    }
+}
+
+/****************************** generateSolution ********************************
+ * void generateSolution(SudokuGrid *grid, SudokuRandom *random);
+ * Purpose:
+ *     Fills grid with a random solved puzzle of its box order.
+ * Parameters:
+ *     I/O  grid        receives the solution; its order is kept
+ *     I/O  random      generator
+ *******************************************************************************/
+void generateSolution(SudokuGrid *grid, SudokuRandom *random)
+{
+    const int order = grid->order;
+    const int size = grid->size;
+    int rows[MAXSIZE];
+    int columns[MAXSIZE];
+    int digits[MAXSIZE + 1];
+    int transpose = randomBelow(random, 2);
+    int rowIndex;
+    int columnIndex;
+    int row;
+    int column;
+
+    randomLines(rows, order, random);
+    randomLines(columns, order, random);
+    for (rowIndex = 0; rowIndex < size; rowIndex++)
+    {
+        digits[rowIndex] = rowIndex + 1;
+    }
+    shuffle(digits, size, random);
+
+    for (rowIndex = 0; rowIndex < size; rowIndex++)
+    {
+        for (columnIndex = 0; columnIndex < size; columnIndex++)
+        {
+            row = rows[transpose ? columnIndex : rowIndex];
+            column = columns[transpose ? rowIndex : columnIndex];
+            grid->cells[rowIndex * size + columnIndex] =
+                digits[(order * (row % order) + row / order + column) % size];
+        }
+    }
+}
+
+/****************************** generateInvalid *********************************
+ * void generateInvalid(SudokuGrid *grid, SudokuRandom *random);
+ * Purpose:
+ *     Fills grid with a random solution broken in one of the ways a proposed
+ *     solution goes wrong.
+ * Parameters:
+ *     I/O  grid        receives the grid; its order is kept
+ *     I/O  random      generator
+ * Notes:
+ *     One of: a cell changed to another digit (a duplicate in its row,
+ *     column and region), two cells of a row swapped (duplicates in two
+ *     columns), or a cell left empty.
+ *******************************************************************************/
+void generateInvalid(SudokuGrid *grid, SudokuRandom *random)
+{
+    const int size = grid->size;
+    int cellIndex;
+    int otherIndex;
+    SudokuCell swap;
+
+    generateSolution(grid, random);
+    cellIndex = randomBelow(random, size * size);
+    switch (randomBelow(random, 3))
+    {
+        case 0:
+            grid->cells[cellIndex] =
+                (grid->cells[cellIndex] + randomBelow(random, size - 1)) % size
+                + 1;
+            break;
+        case 1:
+            // Another column of the same row
+            otherIndex = cellIndex - cellIndex % size
+                + (cellIndex % size + 1 + randomBelow(random, size - 1)) % size;
+            swap = grid->cells[cellIndex];
+            grid->cells[cellIndex] = grid->cells[otherIndex];
+            grid->cells[otherIndex] = swap;
+            break;
+        default:
+            grid->cells[cellIndex] = 0;
+            break;
+    }
+}
+
+/****************************** generatePuzzle **********************************
+ * void generatePuzzle(SudokuGrid *grid, int clueCount, SudokuRandom *random);
+ * Purpose:
+ *     Fills grid with a random solution and empties all but clueCount of
+ *     its cells.
+ * Parameters:
+ *     I/O  grid        receives the puzzle; its order is kept
+ *     I    clueCount   number of values left, 0 thru size * size
+ *     I/O  random      generator
+ * Notes:
+ *     Every puzzle has a solution, but it need not be unique.
+ *******************************************************************************/
+void generatePuzzle(SudokuGrid *grid, int clueCount, SudokuRandom *random)
+{
+    const int cellCount = grid->size * grid->size;
+    int positions[MAXCELLS];
+    int cellIndex;
+    int otherIndex;
+
+    generateSolution(grid, random);
+    for (cellIndex = 0; cellIndex < cellCount; cellIndex++)
+    {
+        positions[cellIndex] = cellIndex;
+    }
+    // Empty the first cellCount - clueCount positions of a random order
+    for (cellIndex = 0; cellIndex < cellCount - clueCount; cellIndex++)
+    {
+        otherIndex = cellIndex + randomBelow(random, cellCount - cellIndex);
+        grid->cells[positions[otherIndex]] = 0;
+        positions[otherIndex] = positions[cellIndex];
+    }
+}
+
+/****************************** generateFilled **********************************
+ * void generateFilled(SudokuGrid *grid, SudokuRandom *random);
+ * Purpose:
+ *     Fills grid with a random solved puzzle, drawn from far more solutions
+ *     than generateSolution() reaches.
+ * Parameters:
+ *     I/O  grid        receives the solution; its order is kept
+ *     I/O  random      generator
+ *******************************************************************************/
+void generateFilled(SudokuGrid *grid, SudokuRandom *random)
+{
+    const int order = grid->order;
+    const int size = grid->size;
+    int digits[MAXSIZE];
+    int region;
+    int index;
+
+    do
+    {
+        for (index = 0; index < size * size; index++)
+        {
+            grid->cells[index] = 0;
+        }
+        for (region = 0; region < order; region++)
+        {
+            for (index = 0; index < size; index++)
+            {
+                digits[index] = index + 1;
+            }
+            shuffle(digits, size, random);
+            for (index = 0; index < size; index++)
+            {
+                grid->cells[(region * order + index / order) * size
+                    + region * order + index % order] = digits[index];
+            }
+        }
+    } while (solveSudoku(grid) != SOLVE_SOLVED);
+}
+
+/****************************** generateUnique **********************************
+ * int generateUnique(SudokuGrid *grid, SudokuRandom *random);
+ * Purpose:
+ *     Fills grid with a random puzzle that has exactly one solution and
+ *     from which no value can be removed without losing that.
+ * Parameters:
+ *     I/O  grid        receives the puzzle; its order is kept
+ *     I/O  random      generator
+ * Returns
+ *     Number of values left
+ * Notes:
+ *     Removing a value keeps the solution unique when none of the other
+ *     values its cell could take leads to a solution. That needs one
+ *     search per other value instead of a count of every solution, which
+ *     would find the known one again. The time grows quickly with the box
+ *     order; see the README for rates.
+ *******************************************************************************/
+int generateUnique(SudokuGrid *grid, SudokuRandom *random)
+{
+    const int order = grid->order;
+    const int size = grid->size;
+    const int cellCount = size * size;
+    int positions[MAXCELLS];
+    int clueCount = cellCount;
+    int cellIndex;
+    int position;
+    long nodes;
+    SudokuCell value;
+    CandidateMasks masks;
+    DigitMask others;
+
+    generateFilled(grid, random);
+    for (cellIndex = 0; cellIndex < cellCount; cellIndex++)
+    {
+        positions[cellIndex] = cellIndex;
+    }
+    shuffle(positions, cellCount, random);
+    initCandidates(&masks, grid);
+    for (cellIndex = 0; cellIndex < cellCount; cellIndex++)
+    {
+        position = positions[cellIndex];
+        value = grid->cells[position];
+        clearCandidate(&masks, position / size, position % size, order,
+                value);
+        // The solution stays unique if no other value leads to a solution
+        others = candidatesAt(&masks, position / size, position % size, order)
+            & ~DIGITBIT(value);
+        for (; others != 0; others &= others - 1)
+        {
+            grid->cells[position] = __builtin_ctzll(others);
+            if (countSolutions(grid, 1, &nodes) != 0)
+            {
+                break;
+            }
+        }
+        if (others != 0)
+        {
+            grid->cells[position] = value;
+            fillCandidate(&masks, position / size, position % size, order,
+                    value);
+        } else
+        {
+            grid->cells[position] = 0;
+            clueCount--;
+        }
+    }
+    return clueCount;
+}
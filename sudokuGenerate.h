@@ -0,0 +1,32 @@
+/*******************************************************************************
+ * sudokuGenerate.h by Geoffrey Sessums
+ * Purpose:
+ *   Defines the random number generator used to build puzzle corpora and
+ *   the puzzles of option G.
+ *   Prototypes
+ * Notes:
+ *   Requires sudokuChecker.h
+ *******************************************************************************/
+#ifndef SUDOKUGENERATE_H
+#define SUDOKUGENERATE_H
+
+// Seeded generator, so a corpus can be rebuilt exactly
+typedef struct
+{
+    uint64_t state;
+} SudokuRandom;
+
+// Largest seed of option G
+#define GENERATE_MAXSEED 99999999
+
+// Prototypes
+void randomSeed(SudokuRandom *random, uint64_t seed);
+uint64_t randomNext(SudokuRandom *random);
+int randomBelow(SudokuRandom *random, int bound);
+void generateSolution(SudokuGrid *grid, SudokuRandom *random);
+void generateInvalid(SudokuGrid *grid, SudokuRandom *random);
+void generatePuzzle(SudokuGrid *grid, int clueCount, SudokuRandom *random);
+void generateFilled(SudokuGrid *grid, SudokuRandom *random);
+int generateUnique(SudokuGrid *grid, SudokuRandom *random);
+
+#endif
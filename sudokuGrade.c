@@ -0,0 +1,395 @@
+/*******************************************************************************
+ * sudokuGrade.c by Geoffrey Sessums
+ * Purpose:
+ *  Grades the difficulty of a puzzle by the hardest technique a person
+ *  needs to solve it.
+ * Notes:
+ *  The grader keeps the possible values of every empty cell, starting from
+ *  the same occupancy masks as option L, and applies the techniques from
+ *  the easiest up, going back to the easiest after every step:
+ *      naked single        a cell with one possible value
+ *      hidden single       a value possible in only one cell of a unit
+ *      locked candidates   a value whose cells in a unit all lie in one
+ *                          other unit, so it is removed from the rest of
+ *                          that unit (pointing and claiming)
+ *      naked pair          two cells of a unit with the same two values,
+ *                          which are removed from the rest of the unit
+ *  The grade is the hardest technique used. A puzzle these cannot finish
+ *  needs search and is graded expert.
+ ******************************************************************************/
+
+// Header
+#include <stdint.h>
+#include "sudokuChecker.h"
+#include "sudokuCandidates.h"
+#include "sudokuGrade.h"
+
+// Possible values of a puzzle being solved by hand
+typedef struct
+{
+    int order;
+    int size;
+    int emptyCount;
+    unsigned char cells[MAXCELLS];
+    DigitMask candidates[MAXCELLS];     // 0 for filled cells
+    unsigned short units[MAXUNITS][MAXSIZE]; // cells of every unit
+} GradeState;
+
+static const char *const gradeNames[GRADE_COUNT] =
+{
+    "easy", "medium", "hard", "expert"
+};
+
+/****************************** initGradeState **********************************
+ * static void initGradeState(GradeState *state, const SudokuGrid *grid);
+ * Purpose:
+ *     Copies a puzzle and finds the possible values of its empty cells.
+ *******************************************************************************/
+static void initGradeState(GradeState *state, const SudokuGrid *grid)
+{
+    const int order = grid->order;
+    const int size = grid->size;
+    CandidateMasks masks;
+    int rowIndex;
+    int columnIndex;
+    int cellIndex;
+    int regionIndex;
+    int regionCount[MAXSIZE] = {0};
+
+    state->order = order;
+    state->size = size;
+    state->emptyCount = 0;
+    initCandidates(&masks, grid);
+    for (rowIndex = 0; rowIndex < size; rowIndex++)
+    {
+        for (columnIndex = 0; columnIndex < size; columnIndex++)
+        {
+            cellIndex = rowIndex * size + columnIndex;
+            regionIndex = REGIONINDEX(rowIndex, columnIndex, order);
+            state->units[rowIndex][columnIndex] = cellIndex;
+            state->units[size + columnIndex][rowIndex] = cellIndex;
+            state->units[2 * size + regionIndex][regionCount[regionIndex]++] =
+                cellIndex;
+            state->cells[cellIndex] = grid->cells[cellIndex];
+            state->candidates[cellIndex] = 0;
+            if (grid->cells[cellIndex] == 0)
+            {
+                state->candidates[cellIndex] =
+                    candidatesAt(&masks, rowIndex, columnIndex, order);
+                state->emptyCount++;
+            }
+        }
+    }
+}
+
+/****************************** cellUnits ***************************************
+ * static void cellUnits(const GradeState *state, int cellIndex,
+ *         int unitIndexes[3]);
+ * Purpose:
+ *     Finds the row, column and region units holding a cell.
+ *******************************************************************************/
+static void cellUnits(const GradeState *state, int cellIndex,
+        int unitIndexes[3])
+{
+    const int size = state->size;
+    const int rowIndex = cellIndex / size;
+    const int columnIndex = cellIndex % size;
+
+    unitIndexes[0] = rowIndex;
+    unitIndexes[1] = size + columnIndex;
+    unitIndexes[2] = 2 * size + REGIONINDEX(rowIndex, columnIndex,
+            state->order);
+}
+
+/****************************** placeValue **************************************
+ * static void placeValue(GradeState *state, int cellIndex, int value);
+ * Purpose:
+ *     Fills a cell and removes its value from the cells it sees.
+ *******************************************************************************/
+static void placeValue(GradeState *state, int cellIndex, int value)
+{
+    int unitIndexes[3];
+    int kind;
+    int memberIndex;
+
+    cellUnits(state, cellIndex, unitIndexes);
+    state->cells[cellIndex] = value;
+    state->candidates[cellIndex] = 0;
+    state->emptyCount--;
+    for (kind = 0; kind < 3; kind++)
+    {
+        for (memberIndex = 0; memberIndex < state->size; memberIndex++)
+        {
+            state->candidates[state->units[unitIndexes[kind]][memberIndex]]
+                &= ~DIGITBIT(value);
+        }
+    }
+}
+
+/****************************** nakedSingles ************************************
+ * static int nakedSingles(GradeState *state);
+ * Purpose:
+ *     Fills every cell left with one possible value.
+ * Returns
+ *     Number of cells filled, or -1 when an empty cell has no possible value
+ *******************************************************************************/
+static int nakedSingles(GradeState *state)
+{
+    const int cellCount = state->size * state->size;
+    DigitMask candidates;
+    int cellIndex;
+    int placed = 0;
+
+    for (cellIndex = 0; cellIndex < cellCount; cellIndex++)
+    {
+        candidates = state->candidates[cellIndex];
+        if (state->cells[cellIndex] != 0)
+        {
+            continue;
+        }
+        if (candidates == 0)
+        {
+            return -1;
+        }
+        if ((candidates & (candidates - 1)) == 0)
+        {
+            placeValue(state, cellIndex, __builtin_ctzll(candidates));
+            placed++;
+        }
+    }
+    return placed;
+}
+
+/****************************** hiddenSingles ***********************************
+ * static int hiddenSingles(GradeState *state);
+ * Purpose:
+ *     Fills every cell holding the only place of a value within a unit.
+ * Returns
+ *     Number of cells filled
+ *******************************************************************************/
+static int hiddenSingles(GradeState *state)
+{
+    const int size = state->size;
+    const unsigned short *unit;
+    DigitMask once;
+    DigitMask twice;
+    DigitMask singles;
+    int unitIndex;
+    int memberIndex;
+    int value;
+    int placed = 0;
+
+    for (unitIndex = 0; unitIndex < 3 * size; unitIndex++)
+    {
+        unit = state->units[unitIndex];
+        once = 0;
+        twice = 0;
+        for (memberIndex = 0; memberIndex < size; memberIndex++)
+        {
+            twice |= once & state->candidates[unit[memberIndex]];
+            once |= state->candidates[unit[memberIndex]];
+        }
+        for (singles = once & ~twice; singles != 0; singles &= singles - 1)
+        {
+            value = __builtin_ctzll(singles);
+            for (memberIndex = 0; memberIndex < size; memberIndex++)
+            {
+                // Gone if its cell took another single of the unit
+                if (state->candidates[unit[memberIndex]] & DIGITBIT(value))
+                {
+                    placeValue(state, unit[memberIndex], value);
+                    placed++;
+                    break;
+                }
+            }
+        }
+    }
+    return placed;
+}
+
+/****************************** lockedCandidates ********************************
+ * static int lockedCandidates(GradeState *state);
+ * Purpose:
+ *     Removes a value from a unit when all its places within another unit
+ *     lie in the first: a region's places in one row or column (pointing),
+ *     or a row's or column's places in one region (claiming).
+ * Returns
+ *     Number of possible values removed
+ *******************************************************************************/
+static int lockedCandidates(GradeState *state)
+{
+    const int size = state->size;
+    const unsigned short *unit;
+    const unsigned short *target;
+    DigitMask present;
+    DigitMask digit;
+    int shared[3];          // units holding every place, or -1
+    int unitIndexes[3];
+    int unitIndex;
+    int memberIndex;
+    int cellIndex;
+    int placeCount;
+    int kind;
+    int removed = 0;
+
+    for (unitIndex = 0; unitIndex < 3 * size; unitIndex++)
+    {
+        unit = state->units[unitIndex];
+        present = 0;
+        for (memberIndex = 0; memberIndex < size; memberIndex++)
+        {
+            present |= state->candidates[unit[memberIndex]];
+        }
+        for (; present != 0; present &= present - 1)
+        {
+            digit = present & -present;
+            placeCount = 0;
+            for (memberIndex = 0; memberIndex < size; memberIndex++)
+            {
+                cellIndex = unit[memberIndex];
+                if ((state->candidates[cellIndex] & digit) == 0)
+                {
+                    continue;
+                }
+                cellUnits(state, cellIndex, unitIndexes);
+                for (kind = 0; kind < 3; kind++)
+                {
+                    shared[kind] = placeCount == 0
+                        || shared[kind] == unitIndexes[kind]
+                        ? unitIndexes[kind] : -1;
+                }
+                placeCount++;
+            }
+            // Remove the value from the other shared unit, outside this one
+            for (kind = 0; kind < 3; kind++)
+            {
+                if (shared[kind] < 0 || shared[kind] == unitIndex)
+                {
+                    continue;
+                }
+                target = state->units[shared[kind]];
+                for (memberIndex = 0; memberIndex < size; memberIndex++)
+                {
+                    cellIndex = target[memberIndex];
+                    cellUnits(state, cellIndex, unitIndexes);
+                    if ((state->candidates[cellIndex] & digit) != 0
+                            && unitIndexes[unitIndex / size] != unitIndex)
+                    {
+                        state->candidates[cellIndex] &= ~digit;
+                        removed++;
+                    }
+                }
+            }
+        }
+    }
+    return removed;
+}
+
+/****************************** nakedPairs **************************************
+ * static int nakedPairs(GradeState *state);
+ * Purpose:
+ *     Removes the two values of two cells of a unit that can hold only
+ *     those values from the other cells of the unit.
+ * Returns
+ *     Number of possible values removed
+ *******************************************************************************/
+static int nakedPairs(GradeState *state)
+{
+    const int size = state->size;
+    const unsigned short *unit;
+    DigitMask pair;
+    int unitIndex;
+    int memberIndex;
+    int otherIndex;
+    int cellIndex;
+    int removed = 0;
+
+    for (unitIndex = 0; unitIndex < 3 * size; unitIndex++)
+    {
+        unit = state->units[unitIndex];
+        for (memberIndex = 0; memberIndex < size; memberIndex++)
+        {
+            pair = state->candidates[unit[memberIndex]];
+            if (__builtin_popcountll(pair) != 2)
+            {
+                continue;
+            }
+            for (otherIndex = memberIndex + 1; otherIndex < size; otherIndex++)
+            {
+                if (state->candidates[unit[otherIndex]] == pair)
+                {
+                    break;
+                }
+            }
+            if (otherIndex == size)
+            {
+                continue;
+            }
+            for (cellIndex = 0; cellIndex < size; cellIndex++)
+            {
+                if (cellIndex != memberIndex && cellIndex != otherIndex
+                        && (state->candidates[unit[cellIndex]] & pair) != 0)
+                {
+                    state->candidates[unit[cellIndex]] &= ~pair;
+                    removed++;
+                }
+            }
+        }
+    }
+    return removed;
+}
+
+/****************************** gradePuzzle *************************************
+ * int gradePuzzle(const SudokuGrid *grid);
+ * Purpose:
+ *     Finds the hardest technique needed to solve a puzzle by hand.
+ * Parameters:
+ *     I    grid        puzzle, zero for empty cells
+ * Returns
+ *     GRADE_EASY thru GRADE_EXPERT
+ * Notes:
+ *     Meant for puzzles with a unique solution; one without a solution is
+ *     graded expert.
+ *******************************************************************************/
+int gradePuzzle(const SudokuGrid *grid)
+{
+    GradeState state;
+    int grade = GRADE_EASY;
+    int progress;
+
+    initGradeState(&state, grid);
+    while (state.emptyCount > 0)
+    {
+        progress = nakedSingles(&state);
+        if (progress < 0)
+        {
+            return GRADE_EXPERT;
+        }
+        if (progress > 0 || hiddenSingles(&state) > 0)
+        {
+            continue;
+        }
+        if (lockedCandidates(&state) > 0)
+        {
+            grade = grade > GRADE_MEDIUM ? grade : GRADE_MEDIUM;
+            continue;
+        }
+        if (nakedPairs(&state) > 0)
+        {
+            grade = GRADE_HARD;
+            continue;
+        }
+        return GRADE_EXPERT;
+    }
+    return grade;
+}
+
+/****************************** gradeName ***************************************
+ * const char *gradeName(int grade);
+ * Purpose:
+ *     Returns the name of a grade, e.g. "medium".
+ *******************************************************************************/
+const char *gradeName(int grade)
+{
+    return gradeNames[grade];
+}
@@ -0,0 +1,23 @@
+/*******************************************************************************
+ * sudokuGrade.h by Geoffrey Sessums
+ * Purpose:
+ *   Defines the difficulty grades of a puzzle.
+ *   Prototypes
+ * Notes:
+ *   Requires sudokuChecker.h
+ *******************************************************************************/
+#ifndef SUDOKUGRADE_H
+#define SUDOKUGRADE_H
+
+// Hardest technique a puzzle needs, easiest first
+#define GRADE_EASY 0        // naked and hidden singles
+#define GRADE_MEDIUM 1      // locked candidates (pointing and claiming)
+#define GRADE_HARD 2        // naked pairs
+#define GRADE_EXPERT 3      // none of the above suffice: search is needed
+#define GRADE_COUNT 4
+
+// Prototypes
+int gradePuzzle(const SudokuGrid *grid);
+const char *gradeName(int grade);
+
+#endif
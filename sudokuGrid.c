@@ -0,0 +1,253 @@
+/*******************************************************************************
+ * sudokuGrid.c by Geoffrey Sessums
+ * Purpose:
+ *  Routines on a sudoku grid shared by the programs of the package and the
+ *  library: describing a grid and checking a proposed solution.
+ * Notes:
+ *  checkSudoku() is the fast single pass check used for option C;
+ *  checkRows(), checkColumns() and checkRegions() are the straightforward
+ *  reference checks, one unit at a time.
+ ******************************************************************************/
+
+// Header
+#include <stddef.h>
+#include "sudokuChecker.h"
+
+/********************************* initGrid *************************************
+ * void initGrid(SudokuGrid *grid, int order, SudokuCell *cells);
+ * Purpose:
+ *     Describes a puzzle of the given box order stored in cells.
+ * Parameters:
+ *     O    grid        grid to initialize
+ *     I    order       box order, MINORDER thru MAXORDER
+ *     I    cells       order^4 values, row by row, owned by the caller
+ * *****************************************************************************/
+void initGrid(SudokuGrid *grid, int order, SudokuCell *cells)
+{
+    grid->order = order;
+    grid->size = order * order;
+    grid->cells = cells;
+}
+
+/********************************* checkSudokuOrder *****************************
+ * int checkSudokuOrder(const SudokuGrid *grid, const int order);
+ * Purpose:
+ *     Checks every row, column and sub region of the sudoku puzzle in a
+ *     single pass to insure that there are no duplicate or missing values.
+ * Parameters:
+ *     I    grid        sudoku puzzle
+ *     I    order       box order of grid, a constant in every instance
+ * Returns
+ *     0    found error
+ *     1    no errors found
+ * Notes:
+ *     Keeps one digit mask per row, column and region. A duplicate is
+ *     detected as soon as its cell is inserted; once all cells are in, the
+ *     masks of all units are combined and compared against ALLDIGITS at once.
+ * *****************************************************************************/
+SUDOKU_INLINE int checkSudokuOrder(const SudokuGrid *grid, const int order)
+{
+    const int size = order * order;
+    const SudokuCell *cells = grid->cells;
+    DigitMask rowMask;
+    DigitMask columnMask[MAXSIZE] = {0};
+    DigitMask regionMask[MAXSIZE] = {0};
+    DigitMask allMasks = ALLDIGITS(size);
+    DigitMask digit;
+    int rowIndex;
+    int columnIndex;
+    int regionIndex;
+    int value;
+
+    // Loop thru rows
+    for (rowIndex = 0; rowIndex < size; rowIndex++)
+    {
+        rowMask = 0;
+        // Loop thru columns
+        for (columnIndex = 0; columnIndex < size; columnIndex++)
+        {
+            value = cells[rowIndex * size + columnIndex];
+            // Empty cells and out of range values are errors
+            if (value < 1 || value > size)
+            {
+                return 0; // found error
+            }
+            digit = DIGITBIT(value);
+            regionIndex = REGIONINDEX(rowIndex, columnIndex, order);
+            // Digit already seen in this row, column or region
+            if ((rowMask | columnMask[columnIndex]
+                        | regionMask[regionIndex]) & digit)
+            {
+                return 0; // found error
+            }
+            rowMask |= digit;
+            columnMask[columnIndex] |= digit;
+            regionMask[regionIndex] |= digit;
+        }
+        allMasks &= rowMask;
+    }
+
+    // Verify values 1 thru size are present in every unit
+    for (columnIndex = 0; columnIndex < size; columnIndex++)
+    {
+        allMasks &= columnMask[columnIndex] & regionMask[columnIndex];
+    }
+
+    return allMasks == ALLDIGITS(size); // no errors found
+}
+
+// checkSudoku2 thru checkSudoku6
+#define SPECIALIZE_CHECK(order) \
+    SUDOKU_CLONES \
+    static int checkSudoku##order(const SudokuGrid *grid) \
+    { \
+        return checkSudokuOrder(grid, order); \
+    }
+SPECIALIZE_ORDERS(SPECIALIZE_CHECK)
+
+/********************************* checkSudoku **********************************
+ * int checkSudoku(const SudokuGrid *grid);
+ * Purpose:
+ *     Checks every row, column and sub region of the sudoku puzzle, using
+ *     the routine specialized for its box order.
+ * Parameters:
+ *     I    grid        sudoku puzzle
+ * Returns
+ *     0    found error
+ *     1    no errors found
+ * *****************************************************************************/
+int checkSudoku(const SudokuGrid *grid)
+{
+    static int (*const checkTable[MAXORDER + 1])(const SudokuGrid *) =
+        ORDERTABLE(checkSudoku);
+
+    return checkTable[grid->order](grid);
+}
+
+/********************************* unitMask *************************************
+ * static DigitMask unitMask(const SudokuGrid *grid, int rowIndex,
+ *         int columnIndex, int rowCount, int columnCount);
+ * Purpose:
+ *     Combines the digits of a block of cells, failing on values that are
+ *     out of range.
+ * Parameters:
+ *     I    grid                    sudoku puzzle
+ *     I    rowIndex, columnIndex   top left cell of the block
+ *     I    rowCount, columnCount   dimensions of the block
+ * Returns
+ *     Digit mask of the block, or 0 when a value is not 1 thru size
+ * *****************************************************************************/
+static DigitMask unitMask(const SudokuGrid *grid, int rowIndex,
+        int columnIndex, int rowCount, int columnCount)
+{
+    DigitMask mask = 0;
+    int row;
+    int column;
+    int value;
+
+    for (row = rowIndex; row < rowIndex + rowCount; row++)
+    {
+        for (column = columnIndex; column < columnIndex + columnCount; column++)
+        {
+            value = grid->cells[row * grid->size + column];
+            if (value < 1 || value > grid->size)
+            {
+                return 0;
+            }
+            mask |= DIGITBIT(value);
+        }
+    }
+    return mask;
+}
+
+/********************************* checkRows ************************************
+ * int checkRows(const SudokuGrid *grid);
+ * Purpose:
+ *     Checks each row of the sudoku puzzle to insure that there are
+ *     no duplicate or missing values.
+ * Parameters:
+ *     I    grid        sudoku puzzle
+ * Returns
+ *     0    found error
+ *     1    no errors found
+ * *****************************************************************************/
+int checkRows(const SudokuGrid *grid)
+{
+    int rowIndex;
+
+    // Loop thru rows
+    for (rowIndex = 0; rowIndex < grid->size; rowIndex++)
+    {
+        // Verify values 1 thru size are present & not duplicated
+        if (unitMask(grid, rowIndex, 0, 1, grid->size)
+                != ALLDIGITS(grid->size))
+        {
+            return 0; // found error
+        }
+    } // end of for-loop thru rows
+
+    return 1; // no errors found
+}
+
+/******************************* checkColumns ***********************************
+ * int checkColumns(const SudokuGrid *grid);
+ * Purpose:
+ *     Checks each column of the sudoku puzzle to insure that there are
+ *     no duplicate or missing values.
+ * Parameters:
+ *     I    grid        sudoku puzzle
+ * Returns
+ *     0    found error
+ *     1    no errors found
+ * *****************************************************************************/
+int checkColumns(const SudokuGrid *grid)
+{
+    int columnIndex;
+
+    // Loop thru columns 
+    for (columnIndex = 0; columnIndex < grid->size; columnIndex++)
+    {
+        // Verify values 1 thru size are present & not duplicated
+        if (unitMask(grid, 0, columnIndex, grid->size, 1)
+                != ALLDIGITS(grid->size))
+        {
+            return 0; // found error
+        }
+    } // end of for-loop thru columns 
+
+    return 1; // no errors found
+}
+
+/******************************* checkRegions ***********************************
+ * int checkRegions(const SudokuGrid *grid)
+ * Purpose:
+ *     Checks each sub region of the sudoku puzzle to insure that there are
+ *     no duplicate or missing values.
+ * Parameters:
+ *     I    grid        sudoku puzzle
+ * Returns
+ *     0    found error
+ *     1    no errors found
+ * *****************************************************************************/
+int checkRegions(const SudokuGrid *grid)
+{
+    int regionRow;
+    int regionColumn;
+
+    // Loop thru the regions, top left to bottom right
+    for (regionRow = 0; regionRow < grid->size; regionRow += grid->order)
+    {
+        for (regionColumn = 0; regionColumn < grid->size;
+                regionColumn += grid->order)
+        {
+            // Verify values 1 thru size are present & not duplicated
+            if (unitMask(grid, regionRow, regionColumn, grid->order,
+                        grid->order) != ALLDIGITS(grid->size))
+            {
+                return 0; // found error
+            }
+        }
+    } // end of for-loop thru regions
+
+    return 1; // no errors found
+}
@@ -0,0 +1,304 @@
+/*******************************************************************************
+ * sudokuLibrary.c by Geoffrey Sessums
+ * Purpose:
+ *  The interface of libsudokuchecker: parsing, checking, candidate listing
+ *  and solving of caller owned grids, with errors returned as codes.
+ * Notes:
+ *  These routines validate their arguments, then call the same specialized
+ *  routines as sudokuChecker. The library holds no state of its own; the
+ *  only tables it uses are constant.
+ *  Text follows the batch layout: up to 9x9 every digit is one value and
+ *  white space is ignored, e.g. 002405800; larger puzzles take decimal
+ *  values separated by white space. Unlike the reader of sudokuChecker,
+ *  parsing stops at the first malformed value instead of skipping it.
+ ******************************************************************************/
+
+// Header
+#include <stddef.h>
+#include "sudokuChecker.h"
+#include "sudokuCandidates.h"
+#include "sudokuSolver.h"
+#include "sudokuLibrary.h"
+
+/****************************** validGrid ***************************************
+ * static int validGrid(const SudokuGrid *grid);
+ * Purpose:
+ *     Verifies that a grid describes a puzzle of a supported box order.
+ * Returns
+ *     SUDOKU_OK or SUDOKU_ERROR_ORDER
+ *******************************************************************************/
+static int validGrid(const SudokuGrid *grid)
+{
+    if (grid == NULL || grid->cells == NULL || grid->order < MINORDER
+            || grid->order > MAXORDER || grid->size != grid->order * grid->order)
+    {
+        return SUDOKU_ERROR_ORDER;
+    }
+    return SUDOKU_OK;
+}
+
+/****************************** isBlank *****************************************
+ * static int isBlank(char next);
+ * Purpose:
+ *     Tells whether a character separates values.
+ *******************************************************************************/
+static int isBlank(char next)
+{
+    return next == ' ' || next == '\t' || next == '\r' || next == '\n';
+}
+
+/****************************** sudokuInitGrid **********************************
+ * int sudokuInitGrid(SudokuGrid *grid, int order, SudokuCell *cells);
+ * Purpose:
+ *     Describes a puzzle of the given box order stored in cells.
+ * Parameters:
+ *     O    grid        grid to initialize
+ *     I    order       box order, MINORDER thru MAXORDER
+ *     I    cells       room for order^4 values, owned by the caller
+ * Returns
+ *     SUDOKU_OK or SUDOKU_ERROR_ORDER
+ *******************************************************************************/
+int sudokuInitGrid(SudokuGrid *grid, int order, SudokuCell *cells)
+{
+    if (grid == NULL || cells == NULL || order < MINORDER || order > MAXORDER)
+    {
+        return SUDOKU_ERROR_ORDER;
+    }
+    initGrid(grid, order, cells);
+    return SUDOKU_OK;
+}
+
+/****************************** sudokuParseGrid *********************************
+ * int sudokuParseGrid(SudokuGrid *grid, const char *text, size_t length,
+ *         size_t *consumed);
+ * Purpose:
+ *     Reads the values of a puzzle from text.
+ * Parameters:
+ *     I/O  grid        receives the values; its order is kept
+ *     I    text        puzzle values, need not be null terminated
+ *     I    length      number of bytes in text
+ *     O    consumed    bytes used up to the last value read; on
+ *                      SUDOKU_ERROR_INVALID, offset of the bad value.
+ *                      May be NULL.
+ * Returns
+ *     SUDOKU_OK, SUDOKU_ERROR_ORDER, SUDOKU_ERROR_INVALID or
+ *     SUDOKU_ERROR_INCOMPLETE. The values read so far are stored either way.
+ *******************************************************************************/
+int sudokuParseGrid(SudokuGrid *grid, const char *text, size_t length,
+        size_t *consumed)
+{
+    const int cellCount = grid != NULL ? grid->size * grid->size : 0;
+    size_t position = 0;
+    size_t tokenStart;
+    int cellIndex = 0;
+    int result = SUDOKU_ERROR_INCOMPLETE;
+    int number;
+    unsigned char digit;
+
+    if (validGrid(grid) != SUDOKU_OK || (text == NULL && length > 0))
+    {
+        return SUDOKU_ERROR_ORDER;
+    }
+    while (cellIndex < cellCount && position < length)
+    {
+        if (isBlank(text[position]))
+        {
+            position++;
+            continue;
+        }
+        tokenStart = position;
+        // Up to 9x9: one digit per value
+        if (grid->size <= 9)
+        {
+            digit = (unsigned char)(text[position] - '0');
+            if (digit > grid->size)
+            {
+                result = SUDOKU_ERROR_INVALID;
+                break;
+            }
+            grid->cells[cellIndex++] = digit;
+            position++;
+            continue;
+        }
+        // Larger puzzles: a decimal number up to the next white space
+        number = 0;
+        while (position < length && (unsigned char)(text[position] - '0') <= 9
+                && number <= grid->size)
+        {
+            number = number * 10 + (text[position++] - '0');
+        }
+        if (position == tokenStart || number > grid->size
+                || (position < length && !isBlank(text[position])))
+        {
+            position = tokenStart;
+            result = SUDOKU_ERROR_INVALID;
+            break;
+        }
+        grid->cells[cellIndex++] = number;
+    }
+    if (cellIndex == cellCount)
+    {
+        result = SUDOKU_OK;
+    }
+    if (consumed != NULL)
+    {
+        *consumed = position;
+    }
+    return result;
+}
+
+/****************************** sudokuCheckGrid *********************************
+ * int sudokuCheckGrid(const SudokuGrid *grid);
+ * Purpose:
+ *     Checks a proposed solution, as option C.
+ * Returns
+ *     SUDOKU_OK            the solution is correct
+ *     SUDOKU_INCORRECT     a value is missing, duplicated or out of range
+ *     SUDOKU_ERROR_ORDER   grid is not a supported puzzle
+ *******************************************************************************/
+int sudokuCheckGrid(const SudokuGrid *grid)
+{
+    if (validGrid(grid) != SUDOKU_OK)
+    {
+        return SUDOKU_ERROR_ORDER;
+    }
+    return checkSudoku(grid) == 1 ? SUDOKU_OK : SUDOKU_INCORRECT;
+}
+
+/****************************** listCandidatesOrder *****************************
+ * void listCandidatesOrder(const SudokuGrid *grid, DigitMask candidates[],
+ *         const int order);
+ * Purpose:
+ *     Stores the possible values of every cell, 0 for filled cells.
+ *******************************************************************************/
+SUDOKU_INLINE void listCandidatesOrder(const SudokuGrid *grid,
+        DigitMask candidates[], const int order)
+{
+    const int size = order * order;
+    CandidateMasks masks;
+    int rowIndex;
+    int columnIndex;
+    int cellIndex;
+
+    initCandidates(&masks, grid);
+    for (rowIndex = 0; rowIndex < size; rowIndex++)
+    {
+        for (columnIndex = 0; columnIndex < size; columnIndex++)
+        {
+            cellIndex = rowIndex * size + columnIndex;
+            candidates[cellIndex] = grid->cells[cellIndex] != 0 ? 0
+                : candidatesAt(&masks, rowIndex, columnIndex, order);
+        }
+    }
+}
+
+// listCandidates2 thru listCandidates6
+#define SPECIALIZE_LIST(order) \
+    SUDOKU_CLONES \
+    static void listCandidates##order(const SudokuGrid *grid, \
+            DigitMask candidates[]) \
+    { \
+        listCandidatesOrder(grid, candidates, order); \
+    }
+SPECIALIZE_ORDERS(SPECIALIZE_LIST)
+
+/****************************** sudokuListCandidates ****************************
+ * int sudokuListCandidates(const SudokuGrid *grid, DigitMask candidates[]);
+ * Purpose:
+ *     Finds the possible values of every empty cell, as option L.
+ * Parameters:
+ *     I    grid        puzzle, zero for empty cells
+ *     O    candidates  one mask per cell, row by row: bit n is set when n
+ *                      is possible; 0 for filled cells
+ * Returns
+ *     SUDOKU_OK or SUDOKU_ERROR_ORDER
+ *******************************************************************************/
+int sudokuListCandidates(const SudokuGrid *grid, DigitMask candidates[])
+{
+    static void (*const listTable[MAXORDER + 1])(const SudokuGrid *,
+            DigitMask []) = ORDERTABLE(listCandidates);
+
+    if (validGrid(grid) != SUDOKU_OK || candidates == NULL)
+    {
+        return SUDOKU_ERROR_ORDER;
+    }
+    listTable[grid->order](grid, candidates);
+    return SUDOKU_OK;
+}
+
+/****************************** sudokuSolveGrid *********************************
+ * int sudokuSolveGrid(SudokuGrid *grid);
+ * Purpose:
+ *     Solves a puzzle in place, as option S.
+ * Returns
+ *     SUDOKU_OK            grid holds the solution
+ *     SUDOKU_NOSOLUTION    no solution; grid is unchanged
+ *     SUDOKU_ERROR_ORDER   grid is not a supported puzzle
+ *******************************************************************************/
+int sudokuSolveGrid(SudokuGrid *grid)
+{
+    if (validGrid(grid) != SUDOKU_OK)
+    {
+        return SUDOKU_ERROR_ORDER;
+    }
+    return solveSudoku(grid) == SOLVE_SOLVED ? SUDOKU_OK : SUDOKU_NOSOLUTION;
+}
+
+/****************************** sudokuFormatGrid ********************************
+ * int sudokuFormatGrid(const SudokuGrid *grid, char *text, size_t capacity,
+ *         size_t *length);
+ * Purpose:
+ *     Writes the values of a puzzle as one null terminated line: one digit
+ *     per value up to 9x9, else separated by spaces.
+ * Parameters:
+ *     I    grid        puzzle values, 0 thru size
+ *     O    text        receives the line; SUDOKU_MAXTEXT bytes always do
+ *     I    capacity    bytes available in text: the line and its null,
+ *                      e.g. 82 for a 9x9 grid
+ *     O    length      length of the line, without the null. May be NULL.
+ * Returns
+ *     SUDOKU_OK, SUDOKU_ERROR_ORDER, SUDOKU_ERROR_INVALID for a value out of
+ *     range, or SUDOKU_ERROR_SPACE when text is too small
+ *******************************************************************************/
+int sudokuFormatGrid(const SudokuGrid *grid, char *text, size_t capacity,
+        size_t *length)
+{
+    size_t position = 0;
+    size_t needed;
+    int cellIndex;
+    int value;
+
+    if (validGrid(grid) != SUDOKU_OK || text == NULL)
+    {
+        return SUDOKU_ERROR_ORDER;
+    }
+    for (cellIndex = 0; cellIndex < grid->size * grid->size; cellIndex++)
+    {
+        value = grid->cells[cellIndex];
+        if (value < 0 || value > grid->size)
+        {
+            return SUDOKU_ERROR_INVALID;
+        }
+        // Room for this value, its separator and the null
+        needed = (cellIndex > 0 && grid->size > 9) + (value >= 10 ? 2 : 1);
+        if (position + needed + 1 > capacity)
+        {
+            return SUDOKU_ERROR_SPACE;
+        }
+        if (cellIndex > 0 && grid->size > 9)
+        {
+            text[position++] = ' ';
+        }
+        if (value >= 10)
+        {
+            text[position++] = (char)('0' + value / 10);
+        }
+        text[position++] = (char)('0' + value % 10);
+    }
+    text[position] = '\0';
+    if (length != NULL)
+    {
+        *length = position;
+    }
+    return SUDOKU_OK;
+}
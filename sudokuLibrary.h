@@ -0,0 +1,93 @@
+/*******************************************************************************
+ * sudokuLibrary.h by Geoffrey Sessums
+ * Purpose:
+ *   Defines the interface of libsudokuchecker, for programs that embed the
+ *   checker instead of running sudokuChecker.
+ *   Return codes
+ *   Visibility
+ *   Game session
+ *   Prototypes
+ * Notes:
+ *   Every routine works only on the caller's grid and buffers and on its own
+ *   stack: none allocates, prints or exits, and any number of threads may
+ *   call them at once on different grids. sudokuSolveGrid() uses up to
+ *   32 KB of stack. A game session is likewise owned by the caller, and
+ *   one thread at a time may use it.
+ *******************************************************************************/
+#ifndef SUDOKULIBRARY_H
+#define SUDOKULIBRARY_H
+
+#include <stddef.h>
+#include "sudokuTypes.h"
+
+// Return codes
+#define SUDOKU_OK 0                 // done; the solution is correct
+#define SUDOKU_INCORRECT 1          // the solution breaks the rules
+#define SUDOKU_NOSOLUTION 2         // the puzzle cannot be solved
+#define SUDOKU_ERROR_ORDER -1       // box order not MINORDER thru MAXORDER
+#define SUDOKU_ERROR_INVALID -2     // malformed or out of range value
+#define SUDOKU_ERROR_INCOMPLETE -3  // text ended before every value
+#define SUDOKU_ERROR_SPACE -4       // caller's buffer too small
+#define SUDOKU_ERROR_GIVEN -5       // cell holds a value of the puzzle
+#define SUDOKU_ERROR_NOMOVE -6      // no move left to undo
+
+// The library objects are built with hidden visibility; only the routines
+// below are exported from libsudokuchecker.so
+#if defined(__GNUC__)
+#define SUDOKU_API __attribute__((visibility("default")))
+#else
+#define SUDOKU_API
+#endif
+
+// Largest text written by sudokuFormatGrid(), with the terminating null
+#define SUDOKU_MAXTEXT (MAXCELLS * 3)
+
+// Moves a session remembers for sudokuSessionUndo(); older ones are dropped
+#define SUDOKU_UNDODEPTH 256
+
+// One move: the cell changed and the value it held before
+typedef struct
+{
+    unsigned short cell;
+    SudokuCell previous;
+} SudokuMove;
+
+// A game in progress: the grid and, for every row, column and region, how
+// many times each value appears in it, kept up to date move by move
+typedef struct
+{
+    SudokuGrid grid;
+    SudokuCell cells[MAXCELLS];
+    DigitMask givens[MAXSIZE];              // per row, columns of the puzzle
+    DigitMask unitMasks[MAXUNITS];          // values present in each unit
+    unsigned char valueCounts[MAXUNITS][MAXSIZE + 1];
+    int filledCount;                        // cells holding a value
+    int conflictCount;                      // values repeated within a unit
+    int undoCount;                          // moves held, at most UNDODEPTH
+    int undoNext;                           // where the next move goes
+    SudokuMove undo[SUDOKU_UNDODEPTH];
+} SudokuSession;
+
+// Prototypes
+SUDOKU_API int sudokuInitGrid(SudokuGrid *grid, int order, SudokuCell *cells);
+SUDOKU_API int sudokuParseGrid(SudokuGrid *grid, const char *text,
+        size_t length, size_t *consumed);
+SUDOKU_API int sudokuCheckGrid(const SudokuGrid *grid);
+SUDOKU_API int sudokuListCandidates(const SudokuGrid *grid,
+        DigitMask candidates[]);
+SUDOKU_API int sudokuSolveGrid(SudokuGrid *grid);
+SUDOKU_API int sudokuFormatGrid(const SudokuGrid *grid, char *text,
+        size_t capacity, size_t *length);
+SUDOKU_API int sudokuSessionStart(SudokuSession *session,
+        const SudokuGrid *puzzle);
+SUDOKU_API int sudokuSessionPlace(SudokuSession *session, int row,
+        int column, int value);
+SUDOKU_API int sudokuSessionErase(SudokuSession *session, int row,
+        int column);
+SUDOKU_API int sudokuSessionUndo(SudokuSession *session);
+SUDOKU_API int sudokuSessionSolved(const SudokuSession *session);
+SUDOKU_API int sudokuSessionConflicts(const SudokuSession *session);
+SUDOKU_API DigitMask sudokuSessionCandidates(const SudokuSession *session,
+        int row, int column);
+
+#endif
@@ -0,0 +1,329 @@
+/*******************************************************************************
+ * sudokuMetrics.c by Geoffrey Sessums
+ * Purpose:
+ *  Collects the counters and latency histograms of every thread and dumps
+ *  them, in the Prometheus text format or as JSON, on exit and whenever
+ *  the process receives SIGUSR1.
+ * Output:
+ *  Written to stderr, e.g.
+ *      sudoku_grids_validated_total 1000
+ *      sudoku_grids_rejected_total{unit="row"} 12
+ *      sudoku_command_seconds_bucket{command="C",le="2.56e-07"} 980
+ *  or {"bytesParsed":84000,"gridsValidated":1000,...} on one line.
+ * Notes:
+ *  SIGUSR1 is blocked in every thread and taken by sigwait() on a thread
+ *  of its own, so the dump runs as ordinary code rather than in a signal
+ *  handler. startMetrics() must run before any other thread starts.
+ *  Built without -DSUDOKU_METRICS only startMetrics() remains, and it
+ *  refuses to start.
+ ******************************************************************************/
+
+// Header
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sudokuChecker.h"
+#include "sudokuMetrics.h"
+
+#ifdef SUDOKU_METRICS
+
+#include <signal.h>
+#include <pthread.h>
+
+// Blocks of every thread that has counted, and the dump format
+static pthread_mutex_t metricsLock = PTHREAD_MUTEX_INITIALIZER;
+static MetricsBlock *metricsBlocks = NULL;
+static int metricsFormat = METRICS_NONE;
+
+__thread MetricsBlock *metricsThread = NULL;
+
+// Names of the counters, in the order of the METRIC_ constants
+static const char *const counterNames[METRIC_COUNT] =
+{
+    "bytesParsed", "gridsValidated", "row", "column", "region",
+    "candidatesComputed", "solverNodes", "cacheHits", "cacheMisses"
+};
+static const char rejectedMetric[] = "sudoku_grids_rejected_total";
+static const char *const counterMetrics[METRIC_COUNT] =
+{
+    "sudoku_bytes_parsed_total", "sudoku_grids_validated_total",
+    rejectedMetric, rejectedMetric, rejectedMetric,
+    "sudoku_candidates_computed_total", "sudoku_solver_nodes_total",
+    "sudoku_cache_hits_total", "sudoku_cache_misses_total"
+};
+
+/****************************** registerMetrics *********************************
+ * MetricsBlock *registerMetrics(void);
+ * Purpose:
+ *     Gives the calling thread a zeroed block and chains it for the dump.
+ * Returns
+ *     The block of the calling thread
+ * Notes:
+ *     Exits with ERROR_PROCESSING when memory is exhausted.
+ *******************************************************************************/
+MetricsBlock *registerMetrics(void)
+{
+    MetricsBlock *block = calloc(1, sizeof(MetricsBlock));
+
+    if (block == NULL)
+    {
+        exitError("Out of memory.");
+    }
+    pthread_mutex_lock(&metricsLock);
+    block->next = metricsBlocks;
+    metricsBlocks = block;
+    pthread_mutex_unlock(&metricsLock);
+    metricsThread = block;
+    return block;
+}
+
+/****************************** countRejection **********************************
+ * void countRejection(const SudokuGrid *grid);
+ * Purpose:
+ *     Counts a rejected solution under the first kind of unit it breaks:
+ *     a row, else a column, else a region.
+ *******************************************************************************/
+void countRejection(const SudokuGrid *grid)
+{
+    if (!checkRows(grid))
+    {
+        METRICS_ADD(METRIC_REJECTEDROW, 1);
+    } else if (!checkColumns(grid))
+    {
+        METRICS_ADD(METRIC_REJECTEDCOLUMN, 1);
+    } else
+    {
+        METRICS_ADD(METRIC_REJECTEDREGION, 1);
+    }
+}
+
+/****************************** sumMetrics **************************************
+ * static void sumMetrics(MetricsBlock *total);
+ * Purpose:
+ *     Adds up the blocks of every thread. The caller holds metricsLock.
+ *******************************************************************************/
+static void sumMetrics(MetricsBlock *total)
+{
+    const MetricsBlock *block;
+    int index;
+    int bucket;
+
+    memset(total, 0, sizeof(MetricsBlock));
+    for (block = metricsBlocks; block != NULL; block = block->next)
+    {
+        for (index = 0; index < METRIC_COUNT; index++)
+        {
+            total->counters[index] +=
+                __atomic_load_n(&block->counters[index], __ATOMIC_RELAXED);
+        }
+        for (index = 0; index < METRICS_COMMANDCOUNT; index++)
+        {
+            for (bucket = 0; bucket < METRICS_BUCKETS; bucket++)
+            {
+                total->latency[index][bucket] += __atomic_load_n(
+                        &block->latency[index][bucket], __ATOMIC_RELAXED);
+            }
+            total->latencySum[index] += __atomic_load_n(
+                    &block->latencySum[index], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/****************************** writePrometheus *********************************
+ * static void writePrometheus(const MetricsBlock *total, FILE *file);
+ * Purpose:
+ *     Writes the totals in the Prometheus text exposition format.
+ *******************************************************************************/
+static void writePrometheus(const MetricsBlock *total, FILE *file)
+{
+    uint64_t count;
+    int index;
+    int bucket;
+
+    for (index = 0; index < METRIC_COUNT; index++)
+    {
+        // The rejections are one counter labeled by unit
+        if (index == 0 || counterMetrics[index] != counterMetrics[index - 1])
+        {
+            fprintf(file, "# TYPE %s counter\n", counterMetrics[index]);
+        }
+        if (index >= METRIC_REJECTEDROW && index <= METRIC_REJECTEDREGION)
+        {
+            fprintf(file, "%s{unit=\"%s\"} %llu\n", counterMetrics[index],
+                    counterNames[index],
+                    (unsigned long long)total->counters[index]);
+        } else
+        {
+            fprintf(file, "%s %llu\n", counterMetrics[index],
+                    (unsigned long long)total->counters[index]);
+        }
+    }
+    fprintf(file, "# TYPE sudoku_command_seconds histogram\n");
+    for (index = 0; index < METRICS_COMMANDCOUNT; index++)
+    {
+        count = 0;
+        for (bucket = 0; bucket < METRICS_BUCKETS; bucket++)
+        {
+            count += total->latency[index][bucket];
+            if (bucket < METRICS_BUCKETS - 1)
+            {
+                fprintf(file, "sudoku_command_seconds_bucket{command=\"%c\","
+                        "le=\"%g\"} %llu\n", METRICS_COMMANDS[index],
+                        (double)(1ULL << (bucket + METRICS_FIRSTBUCKET)) / 1e9,
+                        (unsigned long long)count);
+            }
+        }
+        fprintf(file, "sudoku_command_seconds_bucket{command=\"%c\","
+                "le=\"+Inf\"} %llu\n", METRICS_COMMANDS[index],
+                (unsigned long long)count);
+        fprintf(file, "sudoku_command_seconds_sum{command=\"%c\"} %.9f\n",
+                METRICS_COMMANDS[index],
+                (double)total->latencySum[index] / 1e9);
+        fprintf(file, "sudoku_command_seconds_count{command=\"%c\"} %llu\n",
+                METRICS_COMMANDS[index], (unsigned long long)count);
+    }
+}
+
+/****************************** writeJson ***************************************
+ * static void writeJson(const MetricsBlock *total, FILE *file);
+ * Purpose:
+ *     Writes the totals as one line of JSON. Histogram buckets are given
+ *     by their upper bound in ns and are not cumulative; commands never
+ *     run are left out.
+ *******************************************************************************/
+static void writeJson(const MetricsBlock *total, FILE *file)
+{
+    const char *separator = "";
+    uint64_t count;
+    int index;
+    int bucket;
+
+    fprintf(file, "{\"%s\":%llu,\"%s\":%llu,\"gridsRejected\":{",
+            counterNames[METRIC_BYTES],
+            (unsigned long long)total->counters[METRIC_BYTES],
+            counterNames[METRIC_VALIDATED],
+            (unsigned long long)total->counters[METRIC_VALIDATED]);
+    for (index = METRIC_REJECTEDROW; index <= METRIC_REJECTEDREGION; index++)
+    {
+        fprintf(file, "%s\"%s\":%llu", index > METRIC_REJECTEDROW ? "," : "",
+                counterNames[index],
+                (unsigned long long)total->counters[index]);
+    }
+    fprintf(file, "}");
+    for (index = METRIC_CANDIDATES; index < METRIC_COUNT; index++)
+    {
+        fprintf(file, ",\"%s\":%llu", counterNames[index],
+                (unsigned long long)total->counters[index]);
+    }
+    fprintf(file, ",\"latency\":{");
+    for (index = 0; index < METRICS_COMMANDCOUNT; index++)
+    {
+        count = 0;
+        for (bucket = 0; bucket < METRICS_BUCKETS; bucket++)
+        {
+            count += total->latency[index][bucket];
+        }
+        if (count == 0)
+        {
+            continue;
+        }
+        fprintf(file, "%s\"%c\":{\"count\":%llu,\"sumNs\":%llu,\"buckets\":[",
+                separator, METRICS_COMMANDS[index], (unsigned long long)count,
+                (unsigned long long)total->latencySum[index]);
+        for (bucket = 0; bucket < METRICS_BUCKETS; bucket++)
+        {
+            if (bucket < METRICS_BUCKETS - 1)
+            {
+                fprintf(file, "%s[%llu,%llu]", bucket > 0 ? "," : "",
+                        1ULL << (bucket + METRICS_FIRSTBUCKET),
+                        (unsigned long long)total->latency[index][bucket]);
+            } else
+            {
+                fprintf(file, ",[null,%llu]",
+                        (unsigned long long)total->latency[index][bucket]);
+            }
+        }
+        fprintf(file, "]}");
+        separator = ",";
+    }
+    fprintf(file, "}}\n");
+}
+
+/****************************** dumpMetrics *************************************
+ * static void dumpMetrics(void);
+ * Purpose:
+ *     Writes the totals of every thread to stderr in the chosen format.
+ *******************************************************************************/
+static void dumpMetrics(void)
+{
+    static MetricsBlock total;
+
+    pthread_mutex_lock(&metricsLock);
+    sumMetrics(&total);
+    if (metricsFormat == METRICS_JSON)
+    {
+        writeJson(&total, stderr);
+    } else
+    {
+        writePrometheus(&total, stderr);
+    }
+    fflush(stderr);
+    pthread_mutex_unlock(&metricsLock);
+}
+
+/****************************** signalThread ************************************
+ * static void *signalThread(void *argument);
+ * Purpose:
+ *     Dumps the metrics every time SIGUSR1 arrives, forever.
+ * Parameters:
+ *     I    argument    the blocked signal set holding SIGUSR1
+ *******************************************************************************/
+static void *signalThread(void *argument)
+{
+    const sigset_t *signals = argument;
+    int signalNumber;
+
+    for (;;)
+    {
+        if (sigwait(signals, &signalNumber) == 0)
+        {
+            dumpMetrics();
+        }
+    }
+    return NULL;
+}
+
+#endif
+
+/****************************** startMetrics ************************************
+ * void startMetrics(int format);
+ * Purpose:
+ *     Arranges for the metrics to be dumped on exit and on SIGUSR1.
+ * Parameters:
+ *     I    format      METRICS_PROMETHEUS or METRICS_JSON
+ * Notes:
+ *     Call before starting any thread, so all of them inherit the blocked
+ *     SIGUSR1. Exits with ERROR_PROCESSING when metrics were not compiled
+ *     in or the signal thread cannot start.
+ *******************************************************************************/
+void startMetrics(int format)
+{
+#ifdef SUDOKU_METRICS
+    static sigset_t signals;
+    pthread_t thread;
+
+    metricsFormat = format;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    if (pthread_create(&thread, NULL, signalThread, &signals) != 0)
+    {
+        exitError("Unable to start metrics thread.");
+    }
+    pthread_detach(thread);
+    atexit(dumpMetrics);
+#else
+    (void)format;
+    exitError("Metrics are not compiled in; rebuild with -DSUDOKU_METRICS.");
+#endif
+}
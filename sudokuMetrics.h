@@ -0,0 +1,137 @@
+/*******************************************************************************
+ * sudokuMetrics.h by Geoffrey Sessums
+ * Purpose:
+ *   Defines the counters and latency histograms of the hot paths.
+ *   Prototypes and inline counter operations
+ * Notes:
+ *   Requires sudokuChecker.h. Metrics exist only when compiled with
+ *   -DSUDOKU_METRICS; otherwise METRICS_ADD() expands to nothing and the
+ *   hot paths are exactly as without metrics. Every thread counts into
+ *   its own block, so counting takes no lock and shares no cache line.
+ *******************************************************************************/
+#ifndef SUDOKUMETRICS_H
+#define SUDOKUMETRICS_H
+
+// Dump formats
+#define METRICS_NONE 0
+#define METRICS_PROMETHEUS 1
+#define METRICS_JSON 2
+
+// Counters
+#define METRIC_BYTES 0              // input bytes decoded
+#define METRIC_VALIDATED 1          // grids checked by options C and R
+#define METRIC_REJECTEDROW 2        // grids rejected, by first broken unit
+#define METRIC_REJECTEDCOLUMN 3
+#define METRIC_REJECTEDREGION 4
+#define METRIC_CANDIDATES 5         // cells listed by option L
+#define METRIC_NODES 6              // branches tried by options S and U
+#define METRIC_CACHEHITS 7          // results answered from the cache
+#define METRIC_CACHEMISSES 8
+#define METRIC_COUNT 9
+
+// Commands timed, and latency buckets: bucket n holds times below
+// 2^(n + METRICS_FIRSTBUCKET) ns, except the last, which holds the rest
+#define METRICS_COMMANDS "CLRSUG"
+#define METRICS_COMMANDCOUNT 6
+#define METRICS_FIRSTBUCKET 7       // 128 ns
+#define METRICS_BUCKETS 21          // the last starts at 2^26 ns, 67 ms
+
+// Prototypes
+void startMetrics(int format);
+
+#ifdef SUDOKU_METRICS
+
+#include <string.h>
+#include <time.h>
+
+// Counts of one thread; blocks are chained for the dump and never freed
+typedef struct MetricsBlock
+{
+    uint64_t counters[METRIC_COUNT];
+    uint64_t latency[METRICS_COMMANDCOUNT][METRICS_BUCKETS];
+    uint64_t latencySum[METRICS_COMMANDCOUNT]; // ns
+    struct MetricsBlock *next;
+} MetricsBlock;
+
+extern __thread MetricsBlock *metricsThread;
+MetricsBlock *registerMetrics(void);
+void countRejection(const SudokuGrid *grid);
+
+/****************************** metricsBump *************************************
+ * void metricsBump(uint64_t *counter, uint64_t amount);
+ * Purpose:
+ *     Adds to a counter of this thread. The relaxed load and store compile
+ *     to a plain add, yet let a dump read the counter while it changes.
+ *******************************************************************************/
+SUDOKU_INLINE void metricsBump(uint64_t *counter, uint64_t amount)
+{
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED)
+            + amount, __ATOMIC_RELAXED);
+}
+
+/****************************** metricsBlock ************************************
+ * MetricsBlock *metricsBlock(void);
+ * Purpose:
+ *     Returns the block of this thread, registering it on first use.
+ *******************************************************************************/
+SUDOKU_INLINE MetricsBlock *metricsBlock(void)
+{
+    return metricsThread != NULL ? metricsThread : registerMetrics();
+}
+
+/****************************** metricsNow **************************************
+ * uint64_t metricsNow(void);
+ * Purpose:
+ *     Returns a monotonic time in ns, for timing commands.
+ *******************************************************************************/
+SUDOKU_INLINE uint64_t metricsNow(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/****************************** metricsTime *************************************
+ * void metricsTime(char command, uint64_t elapsed, uint64_t count);
+ * Purpose:
+ *     Records count runs of a command that took elapsed ns together, each
+ *     in the bucket of their average time.
+ *******************************************************************************/
+SUDOKU_INLINE void metricsTime(char command, uint64_t elapsed, uint64_t count)
+{
+    MetricsBlock *block = metricsBlock();
+    const char *found;
+    uint64_t average;
+    int bucket;
+
+    if (command >= 'a' && command <= 'z')
+    {
+        command -= 'a' - 'A';
+    }
+    found = command != '\0' ? strchr(METRICS_COMMANDS, command) : NULL;
+    if (found == NULL || count == 0)
+    {
+        return;
+    }
+    average = elapsed / count;
+    bucket = average >> METRICS_FIRSTBUCKET == 0 ? 0
+        : 64 - __builtin_clzll(average >> METRICS_FIRSTBUCKET);
+    if (bucket >= METRICS_BUCKETS)
+    {
+        bucket = METRICS_BUCKETS - 1;
+    }
+    metricsBump(&block->latency[found - METRICS_COMMANDS][bucket], count);
+    metricsBump(&block->latencySum[found - METRICS_COMMANDS], elapsed);
+}
+
+#define METRICS_ADD(counter, amount) \
+    metricsBump(&metricsBlock()->counters[counter], (amount))
+
+#else
+
+#define METRICS_ADD(counter, amount) ((void)0)
+
+#endif
+
+#endif
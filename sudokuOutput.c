@@ -0,0 +1,451 @@
+/*******************************************************************************
+ * sudokuOutput.c by Geoffrey Sessums
+ * Purpose:
+ *  Assembles result text in a growable buffer. Results are formatted by
+ *  hand instead of with printf and written in large blocks. Also writes
+ *  batch records, as text or packed (see sudokuReader.h), and holds the
+ *  error exit of the programs and their parsing of numeric options.
+ * Notes:
+ *  Buffers are never shrunk, so a buffer reused across records stops
+ *  allocating once it has grown to its working size.
+ ******************************************************************************/
+
+// Header
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sudokuChecker.h"
+#include "sudokuOutput.h"
+#include "sudokuReader.h"
+#include "sudokuCandidates.h"
+#include "sudokuMetrics.h"
+
+/****************************** outputInit **************************************
+ * void outputInit(OutputBuffer *output);
+ * Purpose:
+ *     Initializes an empty output buffer.
+ * Parameters:
+ *     O    output      buffer to initialize
+ *******************************************************************************/
+void outputInit(OutputBuffer *output)
+{
+    output->data = NULL;
+    output->length = 0;
+    output->capacity = 0;
+}
+
+/****************************** outputFree **************************************
+ * void outputFree(OutputBuffer *output);
+ * Purpose:
+ *     Releases the memory held by an output buffer.
+ * Parameters:
+ *     I/O  output      buffer to release
+ *******************************************************************************/
+void outputFree(OutputBuffer *output)
+{
+    free(output->data);
+    outputInit(output);
+}
+
+/****************************** outputReserve ***********************************
+ * void outputReserve(OutputBuffer *output, size_t extra);
+ * Purpose:
+ *     Makes sure the buffer has room for extra more bytes.
+ * Parameters:
+ *     I/O  output      buffer to grow
+ *     I    extra       number of bytes about to be appended
+ * Notes:
+ *     Exits with ERROR_PROCESSING when memory is exhausted.
+ *******************************************************************************/
+void outputReserve(OutputBuffer *output, size_t extra)
+{
+    size_t capacity = output->capacity ? output->capacity : 4096;
+    char *data;
+
+    if (output->length + extra <= output->capacity)
+    {
+        return;
+    }
+    while (capacity < output->length + extra)
+    {
+        capacity *= 2;
+    }
+    data = realloc(output->data, capacity);
+    if (data == NULL)
+    {
+        exitError("Out of memory.");
+    }
+    output->data = data;
+    output->capacity = capacity;
+}
+
+/****************************** outputAppend ************************************
+ * void outputAppend(OutputBuffer *output, const char *text, size_t length);
+ * Purpose:
+ *     Appends length bytes of text to the buffer.
+ * Parameters:
+ *     I/O  output      buffer to append to
+ *     I    text        bytes to append
+ *     I    length      number of bytes
+ *******************************************************************************/
+void outputAppend(OutputBuffer *output, const char *text, size_t length)
+{
+    outputReserve(output, length);
+    memcpy(output->data + output->length, text, length);
+    output->length += length;
+}
+
+/****************************** outputAppendString ******************************
+ * void outputAppendString(OutputBuffer *output, const char *text);
+ * Purpose:
+ *     Appends a null terminated string to the buffer.
+ * Parameters:
+ *     I/O  output      buffer to append to
+ *     I    text        string to append
+ *******************************************************************************/
+void outputAppendString(OutputBuffer *output, const char *text)
+{
+    outputAppend(output, text, strlen(text));
+}
+
+/****************************** outputAppendNumber ******************************
+ * void outputAppendNumber(OutputBuffer *output, long number);
+ * Purpose:
+ *     Appends the decimal digits of a non-negative number to the buffer.
+ * Parameters:
+ *     I/O  output      buffer to append to
+ *     I    number      value to append
+ *******************************************************************************/
+void outputAppendNumber(OutputBuffer *output, long number)
+{
+    char digits[12];
+    int digitIndex = sizeof(digits);
+
+    do {
+        digits[--digitIndex] = (char)('0' + number % 10);
+        number /= 10;
+    } while (number > 0);
+    outputAppend(output, digits + digitIndex, sizeof(digits) - digitIndex);
+}
+
+/****************************** outputFlush *************************************
+ * void outputFlush(OutputBuffer *output, FILE *file);
+ * Purpose:
+ *     Writes the buffered text to file and empties the buffer.
+ * Parameters:
+ *     I/O  output      buffer to write
+ *     I    file        destination stream
+ * Notes:
+ *     The stream is flushed too, so a full disk or a closed pipe is found
+ *     here: exits with ERROR_PROCESSING when not every byte was written.
+ *******************************************************************************/
+void outputFlush(OutputBuffer *output, FILE *file)
+{
+    if (output->length > 0)
+    {
+        if (fwrite(output->data, 1, output->length, file) != output->length
+                || fflush(file) != 0)
+        {
+            exitError("Unable to write output.");
+        }
+        output->length = 0;
+    }
+}
+
+/****************************** putNumber ***************************************
+ * static char *putNumber(char *text, int number);
+ * Purpose:
+ *     Writes a number of one or two digits and returns the end of the text.
+ *******************************************************************************/
+SUDOKU_INLINE char *putNumber(char *text, int number)
+{
+    if (number >= 10)
+    {
+        *text++ = (char)('0' + number / 10);
+    }
+    *text++ = (char)('0' + number % 10);
+    return text;
+}
+
+/****************************** putCandidates ***********************************
+ * void putCandidates(OutputBuffer *output, int rowIndex, int columnIndex,
+ *         DigitMask candidates, const char *separator,
+ *         size_t separatorLength, int size);
+ * Purpose:
+ *     Appends "[row][column]: values " and the separator for one cell.
+ *******************************************************************************/
+SUDOKU_INLINE void putCandidates(OutputBuffer *output, int rowIndex,
+        int columnIndex, DigitMask candidates, const char *separator,
+        size_t separatorLength, int size)
+{
+    char *text;
+
+    // "[r][c]: " plus up to size "v " pairs, written in place
+    outputReserve(output, 10 + 3 * size + separatorLength);
+    text = output->data + output->length;
+    *text++ = '[';
+    text = putNumber(text, rowIndex);
+    *text++ = ']';
+    *text++ = '[';
+    text = putNumber(text, columnIndex);
+    *text++ = ']';
+    *text++ = ':';
+    *text++ = ' ';
+    METRICS_ADD(METRIC_CANDIDATES, 1);
+    while (candidates != 0) {
+        text = putNumber(text, __builtin_ctzll(candidates));
+        *text++ = ' ';
+        candidates &= candidates - 1;
+    }
+    memcpy(text, separator, separatorLength);
+    output->length = (size_t)(text - output->data) + separatorLength;
+}
+
+/****************************** formatCandidatesOrder ***************************
+ * void formatCandidatesOrder(const SudokuGrid *grid, OutputBuffer *output,
+ *         const char *separator, const int order);
+ * Purpose:
+ *     Appends the position and possible values of every empty cell, in the
+ *     "[row][column]: values " layout of option L.
+ * Parameters:
+ *     I    grid        sudoku puzzle values
+ *     I/O  output      buffer to append to
+ *     I    separator   text appended after each empty cell
+ *     I    order       box order of grid, a constant in every instance
+ *******************************************************************************/
+SUDOKU_INLINE void formatCandidatesOrder(const SudokuGrid *grid,
+        OutputBuffer *output, const char *separator, const int order)
+{
+    const int size = order * order;
+    CandidateMasks masks;
+    size_t separatorLength = strlen(separator);
+    int rowIndex;
+    int columnIndex;
+
+    // Occupancy of every row, column and region, computed once
+    initCandidates(&masks, grid);
+    // Loop thru rows
+    for (rowIndex = 0; rowIndex < size; rowIndex++) {
+        // Loop thru columns
+        for (columnIndex = 0; columnIndex < size; columnIndex++) {
+            // Detect empty cells
+            if (grid->cells[rowIndex * size + columnIndex] != 0) {
+                continue;
+            }
+            // Values not used in the row, column or region are possible
+            putCandidates(output, rowIndex, columnIndex,
+                    candidatesAt(&masks, rowIndex, columnIndex, order),
+                    separator, separatorLength, size);
+        }
+    }
+}
+
+// formatCandidates2 thru formatCandidates6
+#define SPECIALIZE_FORMAT(order) \
+    SUDOKU_CLONES \
+    static void formatCandidates##order(const SudokuGrid *grid, \
+            OutputBuffer *output, const char *separator) \
+    { \
+        formatCandidatesOrder(grid, output, separator, order); \
+    }
+SPECIALIZE_ORDERS(SPECIALIZE_FORMAT)
+
+/****************************** formatCandidates ********************************
+ * void formatCandidates(const SudokuGrid *grid, OutputBuffer *output,
+ *         const char *separator);
+ * Purpose:
+ *     Appends the position and possible values of every empty cell, in the
+ *     "[row][column]: values " layout of option L.
+ * Parameters:
+ *     I    grid        sudoku puzzle values
+ *     I/O  output      buffer to append to
+ *     I    separator   text appended after each empty cell
+ *******************************************************************************/
+void formatCandidates(const SudokuGrid *grid, OutputBuffer *output,
+        const char *separator)
+{
+    static void (*const formatTable[MAXORDER + 1])(const SudokuGrid *,
+            OutputBuffer *, const char *) = ORDERTABLE(formatCandidates);
+
+    formatTable[grid->order](grid, output, separator);
+}
+
+/****************************** formatCellCandidates ****************************
+ * void formatCellCandidates(OutputBuffer *output, int rowIndex,
+ *         int columnIndex, DigitMask candidates, const char *separator);
+ * Purpose:
+ *     Appends the position and possible values of one empty cell, in the
+ *     layout of option L, for candidates found by other rules.
+ * Parameters:
+ *     I/O  output      buffer to append to
+ *     I    rowIndex    position of the cell
+ *     I    columnIndex
+ *     I    candidates  possible values of the cell
+ *     I    separator   text appended after the cell
+ *******************************************************************************/
+void formatCellCandidates(OutputBuffer *output, int rowIndex, int columnIndex,
+        DigitMask candidates, const char *separator)
+{
+    putCandidates(output, rowIndex, columnIndex, candidates, separator,
+            strlen(separator), MAXSIZE);
+}
+
+/****************************** formatGrid **************************************
+ * void formatGrid(const SudokuGrid *grid, OutputBuffer *output,
+ *         const char *valueSeparator, const char *rowSeparator);
+ * Purpose:
+ *     Appends the values of a puzzle row by row.
+ * Parameters:
+ *     I    grid                    sudoku puzzle values
+ *     I/O  output                  buffer to append to
+ *     I    valueSeparator          text between the values of a row
+ *     I    rowSeparator            text between rows
+ *******************************************************************************/
+void formatGrid(const SudokuGrid *grid, OutputBuffer *output,
+        const char *valueSeparator, const char *rowSeparator)
+{
+    int rowIndex;
+    int columnIndex;
+
+    for (rowIndex = 0; rowIndex < grid->size; rowIndex++) {
+        if (rowIndex > 0) {
+            outputAppendString(output, rowSeparator);
+        }
+        for (columnIndex = 0; columnIndex < grid->size; columnIndex++) {
+            if (columnIndex > 0) {
+                outputAppendString(output, valueSeparator);
+            }
+            outputAppendNumber(output,
+                    grid->cells[rowIndex * grid->size + columnIndex]);
+        }
+    }
+}
+
+/****************************** formatRecord ************************************
+ * void formatRecord(char command, const SudokuGrid *grid,
+ *         OutputBuffer *output);
+ * Purpose:
+ *     Appends a batch record: the command, then the values on one line.
+ * Parameters:
+ *     I    command     command character, e.g. C
+ *     I    grid        puzzle values
+ *     I/O  output      buffer receiving the record
+ *******************************************************************************/
+void formatRecord(char command, const SudokuGrid *grid, OutputBuffer *output)
+{
+    outputAppend(output, &command, 1);
+    outputAppendString(output, " ");
+    // One digit per value up to 9x9, else space separated
+    formatGrid(grid, output, grid->size > 9 ? " " : "",
+            grid->size > 9 ? " " : "");
+    outputAppendString(output, "\n");
+}
+
+/****************************** formatPackedHeader ******************************
+ * void formatPackedHeader(int order, OutputBuffer *output);
+ * Purpose:
+ *     Appends the header of packed records of a box order.
+ * Parameters:
+ *     I    order       box order of the records that follow
+ *     I/O  output      buffer receiving the header
+ *******************************************************************************/
+void formatPackedHeader(int order, OutputBuffer *output)
+{
+    char header[PACKED_HEADERSIZE] = {0};
+
+    memcpy(header, PACKED_MAGIC, PACKED_MAGICLENGTH);
+    header[PACKED_MAGICLENGTH] = PACKED_VERSION;
+    header[PACKED_MAGICLENGTH + 1] = (char)order;
+    header[PACKED_MAGICLENGTH + 2] = (char)PACKED_BITS(order * order);
+    outputAppend(output, header, PACKED_HEADERSIZE);
+}
+
+/****************************** formatPackedRecord ******************************
+ * void formatPackedRecord(char command, const SudokuGrid *grid,
+ *         OutputBuffer *output);
+ * Purpose:
+ *     Appends a packed record: the command byte, then the values.
+ * Parameters:
+ *     I    command     command character, e.g. C
+ *     I    grid        puzzle values, 0 thru size
+ *     I/O  output      buffer receiving the record
+ *******************************************************************************/
+void formatPackedRecord(char command, const SudokuGrid *grid,
+        OutputBuffer *output)
+{
+    const int cellCount = grid->size * grid->size;
+    const int bits = PACKED_BITS(grid->size);
+    const size_t recordLength = PACKED_RECORDSIZE(grid->size);
+    unsigned char *bytes;
+    DigitMask pending = 0;
+    int pendingBits = 0;
+    int cellIndex;
+
+    outputReserve(output, recordLength);
+    bytes = (unsigned char *)output->data + output->length;
+    *bytes++ = (unsigned char)command;
+    for (cellIndex = 0; cellIndex < cellCount; cellIndex++)
+    {
+        pending |= (DigitMask)grid->cells[cellIndex] << pendingBits;
+        pendingBits += bits;
+        while (pendingBits >= 8)
+        {
+            *bytes++ = (unsigned char)pending;
+            pending >>= 8;
+            pendingBits -= 8;
+        }
+    }
+    if (pendingBits > 0)
+    {
+        *bytes = (unsigned char)pending;
+    }
+    output->length += recordLength;
+}
+
+/****************************** parseNumber *************************************
+ * long parseNumber(const char *text, long minimum, long maximum,
+ *         char *message);
+ * Purpose:
+ *     Reads the number of a numeric option.
+ * Parameters:
+ *     I    text        option argument
+ *     I    minimum     smallest value allowed
+ *     I    maximum     largest value allowed
+ *     I    message     error message when the argument is not allowed
+ * Returns
+ *     The number
+ * Notes:
+ *     Exits with ERROR_PROCESSING unless the whole argument is a decimal
+ *     number from minimum thru maximum.
+ *******************************************************************************/
+long parseNumber(const char *text, long minimum, long maximum,
+        char *message)
+{
+    char *end;
+    long number;
+
+    errno = 0;
+    number = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno != 0 || number < minimum
+            || number > maximum)
+    {
+        exitError(message);
+    }
+    return number;
+}
+
+/******************** exitError *************************************************
+    void exitError(char *message)
+Purpose:
+    Prints an error message. Exits with ERROR_PROCESSING.
+Parameters:
+    I char Message              error message to print
+Notes:
+    This routine causes the program to exit.
+********************************************************************************/
+void exitError(char *message)
+{
+    printf("%s\n", message);
+    exit(ERROR_PROCESSING);
+}
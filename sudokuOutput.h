@@ -0,0 +1,46 @@
+/*******************************************************************************
+ * sudokuOutput.h by Geoffrey Sessums
+ * Purpose:
+ *   Defines the output buffer used to assemble result lines before they are
+ *   written, so that a result costs one copy instead of one printf per value.
+ *   Prototypes
+ * Notes:
+ *   Requires sudokuChecker.h
+ *******************************************************************************/
+#ifndef SUDOKUOUTPUT_H
+#define SUDOKUOUTPUT_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// Flush the buffer once it holds this many bytes
+#define OUTPUT_FLUSHSIZE 65536
+
+// Growable output buffer, reused across records
+typedef struct
+{
+    char *data;
+    size_t length;
+    size_t capacity;
+} OutputBuffer;
+
+// Prototypes
+void outputInit(OutputBuffer *output);
+void outputFree(OutputBuffer *output);
+void outputReserve(OutputBuffer *output, size_t extra);
+void outputAppend(OutputBuffer *output, const char *text, size_t length);
+void outputAppendString(OutputBuffer *output, const char *text);
+void outputAppendNumber(OutputBuffer *output, long number);
+void outputFlush(OutputBuffer *output, FILE *file);
+void formatCandidates(const SudokuGrid *grid, OutputBuffer *output,
+        const char *separator);
+void formatCellCandidates(OutputBuffer *output, int rowIndex, int columnIndex,
+        DigitMask candidates, const char *separator);
+void formatGrid(const SudokuGrid *grid, OutputBuffer *output,
+        const char *valueSeparator, const char *rowSeparator);
+void formatRecord(char command, const SudokuGrid *grid, OutputBuffer *output);
+void formatPackedHeader(int order, OutputBuffer *output);
+void formatPackedRecord(char command, const SudokuGrid *grid,
+        OutputBuffer *output);
+
+#endif
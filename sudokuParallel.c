@@ -0,0 +1,226 @@
+/*******************************************************************************
+ * sudokuParallel.c by Geoffrey Sessums
+ * Purpose:
+ *  Runs batch mode on a pool of worker threads. The main thread reads the
+ *  input in chunks, the workers process chunks in any order and a writer
+ *  thread prints them back in input order, so the output is identical to
+ *  a single threaded run.
+ * Notes:
+ *  The chunks form a ring that doubles as the reorder buffer: the chunk with
+ *  sequence number n lives in slot n % slotCount. The reader waits for its
+ *  next slot to be written out before refilling it, which bounds memory to
+ *  slotCount chunks no matter how long the input is.
+ ******************************************************************************/
+
+// Header
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "sudokuChecker.h"
+#include "sudokuOutput.h"
+#include "sudokuReader.h"
+#include "sudokuCache.h"
+#include "sudokuVariant.h"
+#include "sudokuBatch.h"
+
+// Chunks in flight per worker thread
+#define SLOTS_PER_THREAD 2
+
+// State shared by the reader, the workers and the writer
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t slotFree;        // signaled when a slot is written out
+    pthread_cond_t chunkReady;      // signaled when a chunk is read
+    pthread_cond_t chunkDone;       // signaled when a chunk is processed
+    BatchChunk *slots;
+    char *slotDone;                 // per slot: chunk processed
+    int slotCount;
+    long chunksRead;                // chunks filled by the reader
+    long chunksTaken;               // chunks claimed by workers
+    long chunksWritten;             // chunks printed by the writer
+    int endOfInput;                 // reader has filled its last chunk
+} BatchPipeline;
+
+/****************************** workerThread ************************************
+ * static void *workerThread(void *argument);
+ * Purpose:
+ *     Claims chunks in input order and processes them until the input is
+ *     exhausted.
+ * Parameters:
+ *     I/O  argument    the shared BatchPipeline
+ *******************************************************************************/
+static void *workerThread(void *argument)
+{
+    BatchPipeline *pipeline = argument;
+    BatchChunk *chunk;
+    int slotIndex;
+
+    pthread_mutex_lock(&pipeline->lock);
+    for (;;)
+    {
+        while (pipeline->chunksTaken == pipeline->chunksRead
+                && !pipeline->endOfInput)
+        {
+            pthread_cond_wait(&pipeline->chunkReady, &pipeline->lock);
+        }
+        if (pipeline->chunksTaken == pipeline->chunksRead)
+        {
+            break; // nothing left to claim
+        }
+        slotIndex = (int)(pipeline->chunksTaken++ % pipeline->slotCount);
+        chunk = &pipeline->slots[slotIndex];
+        pthread_mutex_unlock(&pipeline->lock);
+
+        processBatchChunk(chunk);
+
+        pthread_mutex_lock(&pipeline->lock);
+        pipeline->slotDone[slotIndex] = 1;
+        pthread_cond_signal(&pipeline->chunkDone);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+    return NULL;
+}
+
+/****************************** writerThread ************************************
+ * static void *writerThread(void *argument);
+ * Purpose:
+ *     Prints processed chunks to stdout strictly in input order and hands
+ *     their slots back to the reader.
+ * Parameters:
+ *     I/O  argument    the shared BatchPipeline
+ *******************************************************************************/
+static void *writerThread(void *argument)
+{
+    BatchPipeline *pipeline = argument;
+    int slotIndex;
+
+    pthread_mutex_lock(&pipeline->lock);
+    for (;;)
+    {
+        slotIndex = (int)(pipeline->chunksWritten % pipeline->slotCount);
+        while (!pipeline->slotDone[slotIndex]
+                && !(pipeline->endOfInput
+                    && pipeline->chunksWritten == pipeline->chunksRead))
+        {
+            pthread_cond_wait(&pipeline->chunkDone, &pipeline->lock);
+        }
+        if (!pipeline->slotDone[slotIndex])
+        {
+            break; // every chunk has been written
+        }
+        pthread_mutex_unlock(&pipeline->lock);
+
+        outputFlush(&pipeline->slots[slotIndex].output, stdout);
+
+        pthread_mutex_lock(&pipeline->lock);
+        pipeline->slotDone[slotIndex] = 0;
+        pipeline->chunksWritten++;
+        pthread_cond_signal(&pipeline->slotFree);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+    fflush(stdout);
+    return NULL;
+}
+
+/****************************** runParallelBatch ********************************
+ * void runParallelBatch(SudokuReader *reader, int threadCount, int order);
+ * Purpose:
+ *     Processes every record of the input on threadCount worker threads and
+ *     writes one result line per record to stdout, in input order.
+ * Parameters:
+ *     I/O  reader          reader over the stream of records
+ *     I    threadCount     number of worker threads, at least 1
+ *     I    order           box order of every puzzle in the input
+ * Notes:
+ *     Exits with ERROR_PROCESSING when memory or threads are exhausted.
+ *******************************************************************************/
+void runParallelBatch(SudokuReader *reader, int threadCount, int order)
+{
+    BatchPipeline pipeline;
+    pthread_t *workers;
+    pthread_t writer;
+    BatchChunk *chunk;
+    int slotIndex;
+    int threadIndex;
+    int moreInput = 1;
+
+    pipeline.slotCount = threadCount * SLOTS_PER_THREAD;
+    pipeline.slots = malloc(sizeof(BatchChunk) * pipeline.slotCount);
+    pipeline.slotDone = calloc(pipeline.slotCount, 1);
+    workers = malloc(sizeof(pthread_t) * threadCount);
+    if (pipeline.slots == NULL || pipeline.slotDone == NULL || workers == NULL)
+    {
+        exitError("Out of memory.");
+    }
+    for (slotIndex = 0; slotIndex < pipeline.slotCount; slotIndex++)
+    {
+        initBatchChunk(&pipeline.slots[slotIndex], order);
+    }
+    pipeline.chunksRead = 0;
+    pipeline.chunksTaken = 0;
+    pipeline.chunksWritten = 0;
+    pipeline.endOfInput = 0;
+    pthread_mutex_init(&pipeline.lock, NULL);
+    pthread_cond_init(&pipeline.slotFree, NULL);
+    pthread_cond_init(&pipeline.chunkReady, NULL);
+    pthread_cond_init(&pipeline.chunkDone, NULL);
+
+    for (threadIndex = 0; threadIndex < threadCount; threadIndex++)
+    {
+        if (pthread_create(&workers[threadIndex], NULL, workerThread,
+                    &pipeline) != 0)
+        {
+            exitError("Unable to start worker thread.");
+        }
+    }
+    if (pthread_create(&writer, NULL, writerThread, &pipeline) != 0)
+    {
+        exitError("Unable to start writer thread.");
+    }
+
+    // Read chunks into the ring as slots are written out
+    while (moreInput)
+    {
+        pthread_mutex_lock(&pipeline.lock);
+        while (pipeline.chunksRead - pipeline.chunksWritten
+                == pipeline.slotCount)
+        {
+            pthread_cond_wait(&pipeline.slotFree, &pipeline.lock);
+        }
+        pthread_mutex_unlock(&pipeline.lock);
+
+        chunk = &pipeline.slots[pipeline.chunksRead % pipeline.slotCount];
+        chunk->sequence = pipeline.chunksRead;
+        moreInput = readBatchChunk(reader, chunk);
+
+        pthread_mutex_lock(&pipeline.lock);
+        pipeline.chunksRead++;
+        pipeline.endOfInput = !moreInput;
+        pthread_cond_signal(&pipeline.chunkReady);
+        pthread_mutex_unlock(&pipeline.lock);
+    }
+
+    // Wake every idle thread so it can see the end of input
+    pthread_mutex_lock(&pipeline.lock);
+    pthread_cond_broadcast(&pipeline.chunkReady);
+    pthread_cond_broadcast(&pipeline.chunkDone);
+    pthread_mutex_unlock(&pipeline.lock);
+    for (threadIndex = 0; threadIndex < threadCount; threadIndex++)
+    {
+        pthread_join(workers[threadIndex], NULL);
+    }
+    pthread_join(writer, NULL);
+
+    pthread_cond_destroy(&pipeline.chunkDone);
+    pthread_cond_destroy(&pipeline.chunkReady);
+    pthread_cond_destroy(&pipeline.slotFree);
+    pthread_mutex_destroy(&pipeline.lock);
+    for (slotIndex = 0; slotIndex < pipeline.slotCount; slotIndex++)
+    {
+        freeBatchChunk(&pipeline.slots[slotIndex]);
+    }
+    free(workers);
+    free(pipeline.slotDone);
+    free(pipeline.slots);
+}
@@ -0,0 +1,851 @@
+/*******************************************************************************
+ * sudokuReader.c by Geoffrey Sessums
+ * Purpose:
+ *  Decodes commands and puzzle values directly from large blocks of input.
+ *  Regular files are memory mapped; pipes and terminals are read with
+ *  read() into a fixed buffer. Input already in memory is decoded in place.
+ *  In streaming mode nothing is mapped: a thread reads the input into a
+ *  ring of READER_RINGBLOCKS blocks while the decoder works through the
+ *  block before them, so reading overlaps processing and memory stays
+ *  fixed however long the input is.
+ * Input:
+ *  Up to 9x9, every digit is one puzzle value, so both layouts are accepted:
+ *  e.g.    0 0 2 4 0 5 8 0 0       002405800
+ *  Spaces, tabs and line breaks separate values and are otherwise ignored.
+ *  Larger puzzles take decimal numbers separated by white space.
+ *  Values may run over several lines. For batch records (recordLines), a
+ *  line whose first character is not a digit starts the next record, so
+ *  a record with too few values ends there instead of taking values from
+ *  the records after it.
+ *  Packed input (see sudokuReader.h) is recognized by its header and
+ *  unpacked straight from the mapping into the caller's cells.
+ * Notes:
+ *  Up to 9x9 any other character is malformed on its own, and the digits
+ *  around it still count. Above 9x9 a token containing any other character,
+ *  or a value larger than the puzzle allows, is malformed and skipped up to
+ *  the next white space. The first one is remembered in the reader so the
+ *  caller can report it; no formatting is done while decoding.
+ ******************************************************************************/
+
+// Header
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "sudokuChecker.h"
+#include "sudokuReader.h"
+#include "sudokuMetrics.h"
+
+// Blocks of a streaming reader. Block n lives in slot n % READER_RINGBLOCKS;
+// the thread fills a slot once the decoder has released it. A block of
+// length 0 marks the end of input.
+struct ReaderRing
+{
+    pthread_mutex_t lock;
+    pthread_cond_t blockFilled;     // signaled when a block is read
+    pthread_cond_t blockReleased;   // signaled when a block is decoded
+    pthread_t thread;
+    int fd;
+    long blocksFilled;              // blocks read by the thread
+    long blocksTaken;               // blocks handed to the decoder
+    long blocksReleased;            // blocks the decoder is done with
+    int endOfInput;                 // thread has filled its last block
+    int closing;                    // reader closed before the end
+    size_t lengths[READER_RINGBLOCKS];
+    char blocks[READER_RINGBLOCKS][READER_BUFFERSIZE];
+};
+
+/****************************** readerInit **************************************
+ * void readerInit(SudokuReader *reader, int fd);
+ * Purpose:
+ *     Prepares a reader for the input on fd, mapping it into memory when it
+ *     is a regular file.
+ * Parameters:
+ *     O    reader      reader to initialize
+ *     I    fd          open input file descriptor
+ *******************************************************************************/
+void readerInit(SudokuReader *reader, int fd)
+{
+    struct stat status;
+    off_t offset;
+    void *mapping;
+
+    reader->data = reader->buffer;
+    reader->position = 0;
+    reader->length = 0;
+    reader->fd = fd;
+    reader->mapping = NULL;
+    reader->mappingLength = 0;
+    reader->lineNumber = 1;
+    reader->packedOrder = 0;
+    reader->recordLines = 0;
+    reader->fillHook = NULL;
+    reader->fillContext = NULL;
+    reader->ring = NULL;
+    reader->errorCount = 0;
+    reader->errorLine = 0;
+    reader->errorToken[0] = '\0';
+
+    // Map regular files, starting at the current file offset
+    if (fstat(fd, &status) != 0 || !S_ISREG(status.st_mode)
+            || status.st_size == 0)
+    {
+        return;
+    }
+    offset = lseek(fd, 0, SEEK_CUR);
+    if (offset < 0 || offset >= status.st_size)
+    {
+        return;
+    }
+    mapping = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        return;
+    }
+    madvise(mapping, (size_t)status.st_size, MADV_SEQUENTIAL);
+    reader->mapping = mapping;
+    reader->mappingLength = (size_t)status.st_size;
+    reader->data = mapping;
+    reader->position = (size_t)offset;
+    reader->length = (size_t)status.st_size;
+    METRICS_ADD(METRIC_BYTES, reader->length - reader->position);
+}
+
+/****************************** ringThread **************************************
+ * static void *ringThread(void *argument);
+ * Purpose:
+ *     Reads the input into the ring, one read() per block, until the end of
+ *     input, waiting whenever every slot holds a block not yet decoded.
+ * Parameters:
+ *     I/O  argument    the reader's ReaderRing
+ * Notes:
+ *     The thread can be canceled only inside read(), where it holds no
+ *     lock; anywhere else readerClose() stops it with ring->closing.
+ *******************************************************************************/
+static void *ringThread(void *argument)
+{
+    ReaderRing *ring = argument;
+    ssize_t bytesRead;
+    int slotIndex;
+
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+    for (;;)
+    {
+        pthread_mutex_lock(&ring->lock);
+        while (!ring->closing && ring->blocksFilled - ring->blocksReleased
+                >= READER_RINGBLOCKS)
+        {
+            pthread_cond_wait(&ring->blockReleased, &ring->lock);
+        }
+        if (ring->closing)
+        {
+            pthread_mutex_unlock(&ring->lock);
+            return NULL;
+        }
+        slotIndex = (int)(ring->blocksFilled % READER_RINGBLOCKS);
+        pthread_mutex_unlock(&ring->lock);
+
+        // The slot is the thread's alone until it is counted as filled
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+        do {
+            bytesRead = read(ring->fd, ring->blocks[slotIndex],
+                    READER_BUFFERSIZE);
+        } while (bytesRead < 0 && errno == EINTR);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+        pthread_mutex_lock(&ring->lock);
+        ring->lengths[slotIndex] = bytesRead > 0 ? (size_t)bytesRead : 0;
+        ring->blocksFilled++;
+        ring->endOfInput = bytesRead <= 0;
+        pthread_cond_signal(&ring->blockFilled);
+        pthread_mutex_unlock(&ring->lock);
+        if (bytesRead <= 0)
+        {
+            return NULL;
+        }
+    }
+}
+
+/****************************** readerInitStream ********************************
+ * void readerInitStream(SudokuReader *reader, int fd);
+ * Purpose:
+ *     Prepares a reader that streams the input on fd through a fixed ring
+ *     of blocks filled ahead by a thread of its own, for inputs of any
+ *     length and for pipes.
+ * Parameters:
+ *     O    reader      reader to initialize
+ *     I    fd          open input file descriptor
+ * Notes:
+ *     Exits with ERROR_PROCESSING when the ring cannot be allocated or the
+ *     thread cannot start. readerClose() stops the thread.
+ *******************************************************************************/
+void readerInitStream(SudokuReader *reader, int fd)
+{
+    ReaderRing *ring = malloc(sizeof(ReaderRing));
+
+    if (ring == NULL)
+    {
+        exitError("Out of memory.");
+    }
+    readerInit(reader, -1);
+    reader->fd = fd;
+    ring->fd = fd;
+    ring->blocksFilled = 0;
+    ring->blocksTaken = 0;
+    ring->blocksReleased = 0;
+    ring->endOfInput = 0;
+    ring->closing = 0;
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->blockFilled, NULL);
+    pthread_cond_init(&ring->blockReleased, NULL);
+    // Ignored by pipes; lets the kernel read files well ahead
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    if (pthread_create(&ring->thread, NULL, ringThread, ring) != 0)
+    {
+        exitError("Unable to start input thread.");
+    }
+    reader->ring = ring;
+}
+
+/****************************** readerInitMemory ********************************
+ * void readerInitMemory(SudokuReader *reader, const char *data,
+ *         size_t length);
+ * Purpose:
+ *     Prepares a reader for input already held in memory.
+ * Parameters:
+ *     O    reader      reader to initialize
+ *     I    data        input, owned by the caller for the life of the reader
+ *     I    length      number of bytes in data
+ *******************************************************************************/
+void readerInitMemory(SudokuReader *reader, const char *data, size_t length)
+{
+    readerInit(reader, -1);
+    reader->data = data;
+    reader->length = length;
+    METRICS_ADD(METRIC_BYTES, length);
+}
+
+/****************************** readerClose *************************************
+ * void readerClose(SudokuReader *reader);
+ * Purpose:
+ *     Releases the memory mapping of a reader, or stops its read ahead
+ *     thread and frees its ring. The descriptor stays open.
+ * Parameters:
+ *     I/O  reader      reader to close
+ *******************************************************************************/
+void readerClose(SudokuReader *reader)
+{
+    ReaderRing *ring = reader->ring;
+
+    if (ring != NULL)
+    {
+        // A thread still reading may be blocked in read() for good
+        pthread_mutex_lock(&ring->lock);
+        if (!ring->endOfInput)
+        {
+            ring->closing = 1;
+            pthread_cond_signal(&ring->blockReleased);
+            pthread_cancel(ring->thread);
+        }
+        pthread_mutex_unlock(&ring->lock);
+        pthread_join(ring->thread, NULL);
+        pthread_mutex_destroy(&ring->lock);
+        pthread_cond_destroy(&ring->blockFilled);
+        pthread_cond_destroy(&ring->blockReleased);
+        free(ring);
+        reader->ring = NULL;
+    }
+    if (reader->mapping != NULL)
+    {
+        munmap(reader->mapping, reader->mappingLength);
+        reader->mapping = NULL;
+    }
+    reader->data = reader->buffer;
+    reader->position = 0;
+    reader->length = 0;
+}
+
+/****************************** ringFill ****************************************
+ * static int ringFill(SudokuReader *reader);
+ * Purpose:
+ *     Releases the block just decoded to the read ahead thread and takes
+ *     the next one, waiting for it to be read.
+ * Returns
+ *     0    end of input
+ *     1    more input available
+ *******************************************************************************/
+static int ringFill(SudokuReader *reader)
+{
+    ReaderRing *ring = reader->ring;
+    int slotIndex;
+
+    pthread_mutex_lock(&ring->lock);
+    if (ring->blocksTaken > ring->blocksReleased)
+    {
+        ring->blocksReleased++;
+        pthread_cond_signal(&ring->blockReleased);
+    }
+    while (ring->blocksFilled == ring->blocksTaken)
+    {
+        pthread_cond_wait(&ring->blockFilled, &ring->lock);
+    }
+    slotIndex = (int)(ring->blocksTaken % READER_RINGBLOCKS);
+    if (ring->lengths[slotIndex] == 0)
+    {
+        pthread_mutex_unlock(&ring->lock);
+        return 0; // the end of input block is never taken
+    }
+    ring->blocksTaken++;
+    pthread_mutex_unlock(&ring->lock);
+    reader->data = ring->blocks[slotIndex];
+    reader->position = 0;
+    reader->length = ring->lengths[slotIndex];
+    METRICS_ADD(METRIC_BYTES, reader->length);
+    return 1;
+}
+
+/****************************** readerFill **************************************
+ * static int readerFill(SudokuReader *reader);
+ * Purpose:
+ *     Reads the next block of input once the current one is used up.
+ * Parameters:
+ *     I/O  reader      reader to refill
+ * Returns
+ *     0    end of input
+ *     1    more input available
+ *******************************************************************************/
+static int readerFill(SudokuReader *reader)
+{
+    ssize_t bytesRead;
+
+    if (reader->mapping != NULL || reader->fd < 0)
+    {
+        return 0; // the whole input is already in memory
+    }
+    // Let the caller act before read() may block, e.g. send pending replies
+    if (reader->fillHook != NULL)
+    {
+        reader->fillHook(reader->fillContext);
+    }
+    if (reader->ring != NULL)
+    {
+        return ringFill(reader);
+    }
+    do {
+        bytesRead = read(reader->fd, reader->buffer, READER_BUFFERSIZE);
+    } while (bytesRead < 0 && errno == EINTR);
+    if (bytesRead <= 0)
+    {
+        return 0;
+    }
+    reader->position = 0;
+    reader->length = (size_t)bytesRead;
+    METRICS_ADD(METRIC_BYTES, bytesRead);
+    return 1;
+}
+
+/****************************** readerBadCharacter ******************************
+ * static void readerBadCharacter(SudokuReader *reader, char character);
+ * Purpose:
+ *     Remembers a character that is not a value of a puzzle up to 9x9, if it
+ *     is the first one seen since the last grid started.
+ * Parameters:
+ *     I/O  reader      reader positioned just after character
+ *     I    character   the malformed character, already consumed
+ * Notes:
+ *     Nothing more is skipped: every digit is a value of its own, so the
+ *     digits around the character still count.
+ *******************************************************************************/
+static void readerBadCharacter(SudokuReader *reader, char character)
+{
+    if (reader->errorCount++ == 0)
+    {
+        reader->errorLine = reader->lineNumber;
+        reader->errorToken[0] = character;
+        reader->errorToken[1] = '\0';
+    }
+}
+
+/****************************** readerSkipToken *********************************
+ * static void readerSkipToken(SudokuReader *reader, const char *prefix,
+ *         int prefixLength);
+ * Purpose:
+ *     Skips a malformed token up to the next white space and remembers the
+ *     first one seen since the last grid started.
+ * Parameters:
+ *     I/O  reader          reader positioned just after prefix
+ *     I    prefix          start of the token, already consumed
+ *     I    prefixLength    number of bytes in prefix, at least 1
+ *******************************************************************************/
+static void readerSkipToken(SudokuReader *reader, const char *prefix,
+        int prefixLength)
+{
+    int tokenLength = 0;
+    int keep = reader->errorCount == 0;
+    char next;
+
+    if (keep)
+    {
+        reader->errorLine = reader->lineNumber;
+        while (tokenLength < prefixLength && tokenLength < READER_TOKENSIZE - 1)
+        {
+            reader->errorToken[tokenLength] = prefix[tokenLength];
+            tokenLength++;
+        }
+    }
+    reader->errorCount++;
+    for (;;)
+    {
+        if (reader->position == reader->length && !readerFill(reader))
+        {
+            break;
+        }
+        next = reader->data[reader->position];
+        if (next == ' ' || next == '\t' || next == '\r' || next == '\n')
+        {
+            break;
+        }
+        reader->position++;
+        if (keep && tokenLength < READER_TOKENSIZE - 1)
+        {
+            reader->errorToken[tokenLength++] = next;
+        }
+    }
+    if (keep)
+    {
+        reader->errorToken[tokenLength] = '\0';
+    }
+}
+
+/****************************** readerNextNumber ********************************
+ * static int readerNextNumber(SudokuReader *reader, int *value, int size);
+ * Purpose:
+ *     Reads the next white space separated number, for puzzles larger than
+ *     9x9 where one digit is not enough.
+ * Parameters:
+ *     I/O  reader      reader to decode from
+ *     O    value       number read, 0 thru size
+ *     I    size        largest value allowed
+ * Returns
+ *     READER_EOF       end of input
+ *     READER_OK        value read
+ *     READER_INVALID   malformed or out of range token skipped
+ *     READER_SHORT     recordLines is set and the next line starts with
+ *                      no digit; it is left unread
+ *******************************************************************************/
+static int readerNextNumber(SudokuReader *reader, int *value, int size)
+{
+    char token[READER_TOKENSIZE];
+    int tokenLength = 0;
+    int number = 0;
+    int newLine = 0;
+    char next;
+
+    // Skip white space before the number
+    for (;;)
+    {
+        if (reader->position == reader->length && !readerFill(reader))
+        {
+            return READER_EOF;
+        }
+        next = reader->data[reader->position];
+        if (next == '\n')
+        {
+            reader->lineNumber++;
+            newLine = 1;
+        } else if (next != ' ' && next != '\t' && next != '\r')
+        {
+            break;
+        }
+        reader->position++;
+    }
+    if (newLine && reader->recordLines && (unsigned char)(next - '0') > 9)
+    {
+        return READER_SHORT;
+    }
+    // Decimal digits up to the next white space or end of input
+    for (;;)
+    {
+        next = reader->data[reader->position];
+        if ((unsigned char)(next - '0') > 9 || number > size)
+        {
+            break;
+        }
+        number = number * 10 + (next - '0');
+        // Leading zeros may run past the token kept for error messages
+        if (tokenLength < READER_TOKENSIZE - 1)
+        {
+            token[tokenLength++] = next;
+        }
+        reader->position++;
+        if (reader->position == reader->length && !readerFill(reader))
+        {
+            next = ' ';
+            break;
+        }
+    }
+    if (tokenLength > 0 && number <= size && (next == ' ' || next == '\t'
+                || next == '\r' || next == '\n'))
+    {
+        *value = number;
+        return READER_OK;
+    }
+    if (tokenLength == 0)
+    {
+        token[tokenLength++] = next;
+        reader->position++;
+    }
+    readerSkipToken(reader, token, tokenLength);
+    return READER_INVALID;
+}
+
+/****************************** readerAtEnd *************************************
+ * int readerAtEnd(SudokuReader *reader);
+ * Purpose:
+ *     Tells whether the input is used up, reading ahead when the current
+ *     block is.
+ * Parameters:
+ *     I/O  reader      reader to look at
+ * Returns
+ *     1    no input left
+ *     0    more input to decode
+ *******************************************************************************/
+int readerAtEnd(SudokuReader *reader)
+{
+    return reader->position == reader->length && !readerFill(reader);
+}
+
+/****************************** readerNextCommand *******************************
+ * int readerNextCommand(SudokuReader *reader, char *command);
+ * Purpose:
+ *     Reads the next command character, skipping white space before it.
+ * Parameters:
+ *     I/O  reader      reader to decode from
+ *     O    command     command character read
+ * Returns
+ *     READER_EOF   end of input
+ *     READER_OK    command read
+ *******************************************************************************/
+int readerNextCommand(SudokuReader *reader, char *command)
+{
+    char next;
+
+    for (;;)
+    {
+        if (reader->position == reader->length && !readerFill(reader))
+        {
+            return READER_EOF;
+        }
+        next = reader->data[reader->position++];
+        if (next == '\n')
+        {
+            reader->lineNumber++;
+        } else if (next != ' ' && next != '\t' && next != '\r')
+        {
+            *command = next;
+            return READER_OK;
+        }
+    }
+}
+
+/****************************** readerNextValue *********************************
+ * int readerNextValue(SudokuReader *reader, int *value, int size);
+ * Purpose:
+ *     Reads the next puzzle value, stopping at the first malformed token.
+ * Parameters:
+ *     I/O  reader      reader to decode from
+ *     O    value       puzzle value read, 0 thru size
+ *     I    size        largest value allowed (9 for a 9x9 puzzle)
+ * Returns
+ *     READER_EOF       end of input
+ *     READER_OK        value read
+ *     READER_INVALID   malformed token skipped; see reader->errorToken
+ *     READER_SHORT     above 9x9, as for readerNextGrid()
+ * Notes:
+ *     Used for interactive input, where each bad token is reported as soon
+ *     as it is typed. The error state is reset on every call.
+ *******************************************************************************/
+int readerNextValue(SudokuReader *reader, int *value, int size)
+{
+    char next;
+
+    reader->errorCount = 0;
+    if (size > 9)
+    {
+        return readerNextNumber(reader, value, size);
+    }
+    for (;;)
+    {
+        if (reader->position == reader->length && !readerFill(reader))
+        {
+            return READER_EOF;
+        }
+        next = reader->data[reader->position++];
+        if ((unsigned char)(next - '0') <= size)
+        {
+            *value = next - '0';
+            return READER_OK;
+        }
+        if (next == '\n')
+        {
+            reader->lineNumber++;
+        } else if (next != ' ' && next != '\t' && next != '\r')
+        {
+            readerBadCharacter(reader, next);
+            return READER_INVALID;
+        }
+    }
+}
+
+/****************************** readerNextGrid **********************************
+ * int readerNextGrid(SudokuReader *reader, SudokuGrid *grid);
+ * Purpose:
+ *     Decodes the next size x size puzzle values.
+ * Parameters:
+ *     I/O  reader      reader to decode from
+ *     I/O  grid        receives the puzzle values; its order is kept
+ * Returns
+ *     READER_EOF       input ended before the grid was complete
+ *     READER_OK        grid read; reader->errorCount tells whether
+ *                      malformed tokens were skipped along the way
+ *     READER_SHORT     recordLines is set and a line starting with no
+ *                      digit came before the grid was complete; the
+ *                      reader is left at that character
+ *******************************************************************************/
+int readerNextGrid(SudokuReader *reader, SudokuGrid *grid)
+{
+    SudokuCell *cells = grid->cells;
+    const int cellCount = grid->size * grid->size;
+    const unsigned char size = (unsigned char)grid->size;
+    int cellIndex = 0;
+    int lineCell = -1;          // cells read when the last line began
+    const char *data = reader->data;
+    size_t position = reader->position;
+    size_t length = reader->length;
+    unsigned char digit;
+    int readResult;
+    int value;
+    char next;
+
+    reader->errorCount = 0;
+    // Larger puzzles: white space separated numbers
+    if (size > 9)
+    {
+        while (cellIndex < cellCount)
+        {
+            readResult = readerNextNumber(reader, &value, size);
+            if (readResult == READER_EOF || readResult == READER_SHORT)
+            {
+                return readResult;
+            }
+            if (readResult == READER_OK)
+            {
+                cells[cellIndex++] = (SudokuCell)value;
+            }
+        }
+        return READER_OK;
+    }
+    // Up to 9x9: one digit per value
+    while (cellIndex < cellCount)
+    {
+        if (position == length)
+        {
+            reader->position = position;
+            if (!readerFill(reader))
+            {
+                return READER_EOF;
+            }
+            data = reader->data;
+            position = reader->position;
+            length = reader->length;
+        }
+        next = data[position++];
+        digit = (unsigned char)(next - '0');
+        if (digit <= size)
+        {
+            cells[cellIndex++] = digit;
+        } else if (next == '\n')
+        {
+            reader->lineNumber++;
+            lineCell = cellIndex;
+        } else if (next != ' ' && next != '\t' && next != '\r')
+        {
+            // Nothing but white space on this line yet: the next record
+            if (lineCell == cellIndex && reader->recordLines
+                    && (unsigned char)(next - '0') > 9)
+            {
+                reader->position = position - 1;
+                return READER_SHORT;
+            }
+            lineCell = -1;
+            readerBadCharacter(reader, next);
+        }
+    }
+    reader->position = position;
+    return READER_OK;
+}
+
+/****************************** readerDetectPacked ******************************
+ * int readerDetectPacked(SudokuReader *reader);
+ * Purpose:
+ *     Recognizes packed input by its header and consumes the header.
+ * Parameters:
+ *     I/O  reader      reader positioned at the start of the input
+ * Returns
+ *     Box order of the packed records, or 0 for text input
+ * Notes:
+ *     The header must arrive in the first block, which holds for files and
+ *     for pipes written a block at a time. Exits with ERROR_PROCESSING when
+ *     the header is not one this reader understands.
+ *******************************************************************************/
+int readerDetectPacked(SudokuReader *reader)
+{
+    const unsigned char *header;
+    int order;
+
+    if (reader->position == reader->length && !readerFill(reader))
+    {
+        return 0;
+    }
+    if (reader->length - reader->position < PACKED_HEADERSIZE
+            || memcmp(reader->data + reader->position, PACKED_MAGIC,
+                PACKED_MAGICLENGTH) != 0)
+    {
+        return 0; // text input
+    }
+    header = (const unsigned char *)reader->data + reader->position;
+    order = header[PACKED_MAGICLENGTH + 1];
+    if (header[PACKED_MAGICLENGTH] != PACKED_VERSION
+            || order < MINORDER || order > MAXORDER
+            || header[PACKED_MAGICLENGTH + 2] != PACKED_BITS(order * order))
+    {
+        exitError("Unsupported packed input.");
+    }
+    reader->position += PACKED_HEADERSIZE;
+    reader->packedOrder = order;
+    return order;
+}
+
+/****************************** readerNextPacked ********************************
+ * int readerNextPacked(SudokuReader *reader, char *command, SudokuGrid *grid);
+ * Purpose:
+ *     Unpacks the next record of packed input.
+ * Parameters:
+ *     I/O  reader      reader over packed input
+ *     O    command     command byte of the record
+ *     I/O  grid        receives the puzzle values; its order must be the
+ *                      packed order
+ * Returns
+ *     READER_EOF       input ended before the record was complete
+ *     READER_OK        record read; reader->errorCount tells whether
+ *                      values larger than size were found, and
+ *                      reader->errorLine is then the record number
+ * Notes:
+ *     A record lying wholly within the current block, which is every record
+ *     of a mapped file, is unpacked in place; only a record split across
+ *     two read() blocks is gathered into a local copy first.
+ *******************************************************************************/
+int readerNextPacked(SudokuReader *reader, char *command, SudokuGrid *grid)
+{
+    const int size = grid->size;
+    const int cellCount = size * size;
+    const int bits = PACKED_BITS(size);
+    const size_t recordLength = PACKED_RECORDSIZE(size);
+    const DigitMask valueMask = ((DigitMask)1 << bits) - 1;
+    unsigned char split[PACKED_MAXRECORDSIZE];
+    const unsigned char *record;
+    const unsigned char *bytes;
+    SudokuCell *cells = grid->cells;
+    DigitMask pending = 0;
+    int pendingBits = 0;
+    size_t copied = 0;
+    size_t available;
+    int cellIndex;
+    int outOfRange = 0;
+    int byte;
+
+    reader->errorCount = 0;
+    if (reader->length - reader->position >= recordLength)
+    {
+        record = (const unsigned char *)reader->data + reader->position;
+        reader->position += recordLength;
+    } else
+    {
+        while (copied < recordLength)
+        {
+            if (reader->position == reader->length && !readerFill(reader))
+            {
+                return READER_EOF;
+            }
+            available = reader->length - reader->position;
+            if (available > recordLength - copied)
+            {
+                available = recordLength - copied;
+            }
+            memcpy(split + copied, reader->data + reader->position, available);
+            reader->position += available;
+            copied += available;
+        }
+        record = split;
+    }
+    *command = (char)record[0];
+    bytes = record + 1;
+
+    if (bits == 4)
+    {
+        // Up to 9x9: two values per byte
+        for (cellIndex = 0; cellIndex + 1 < cellCount; cellIndex += 2)
+        {
+            byte = bytes[cellIndex >> 1];
+            cells[cellIndex] = byte & 0xF;
+            cells[cellIndex + 1] = byte >> 4;
+            outOfRange |= ((byte & 0xF) > size) | ((byte >> 4) > size);
+        }
+        if (cellIndex < cellCount)
+        {
+            cells[cellIndex] = bytes[cellIndex >> 1] & 0xF;
+            outOfRange |= cells[cellIndex] > size;
+        }
+    } else
+    {
+        for (cellIndex = 0; cellIndex < cellCount; cellIndex++)
+        {
+            if (pendingBits < bits)
+            {
+                pending |= (DigitMask)*bytes++ << pendingBits;
+                pendingBits += 8;
+            }
+            cells[cellIndex] = (int)(pending & valueMask);
+            outOfRange |= cells[cellIndex] > size;
+            pending >>= bits;
+            pendingBits -= bits;
+        }
+    }
+
+    // Values that fit in the bits but not in the puzzle
+    if (outOfRange)
+    {
+        for (cellIndex = 0; cellIndex < cellCount; cellIndex++)
+        {
+            if (cells[cellIndex] <= size)
+            {
+                continue;
+            }
+            // Keep the first bad value for the result line
+            if (reader->errorCount++ == 0)
+            {
+                reader->errorLine = reader->lineNumber;
+                snprintf(reader->errorToken, READER_TOKENSIZE, "%d",
+                        cells[cellIndex]);
+            }
+            cells[cellIndex] = 0;
+        }
+    }
+    reader->lineNumber++;
+    return READER_OK;
+}
@@ -0,0 +1,83 @@
+/*******************************************************************************
+ * sudokuReader.h by Geoffrey Sessums
+ * Purpose:
+ *   Defines the buffered puzzle reader and its return codes, and the
+ *   packed puzzle format.
+ *   Prototypes
+ * Notes:
+ *   Requires sudokuChecker.h
+ *******************************************************************************/
+#ifndef SUDOKUREADER_H
+#define SUDOKUREADER_H
+
+#include <stddef.h>
+
+// Size of the block read at a time when the input cannot be mapped
+#define READER_BUFFERSIZE 65536
+// Blocks read ahead of the decoder in streaming mode
+#define READER_RINGBLOCKS 4
+// Longest malformed token kept for error messages
+#define READER_TOKENSIZE 16
+
+// Return codes
+#define READER_EOF 0
+#define READER_OK 1
+#define READER_INVALID 2
+#define READER_SHORT 3      // a line starting a new record ended the values
+
+/*
+ * Packed input: a PACKED_HEADERSIZE byte header, then fixed size records of
+ * one command byte and the size * size cell values, PACKED_BITS bits each,
+ * least significant bit first (41 bytes of values for 9x9). Record n starts
+ * at byte PACKED_HEADERSIZE + n * PACKED_RECORDSIZE(size).
+ * Header: the PACKED_MAGIC bytes, PACKED_VERSION, the box order, the bits
+ * per value, and zero bytes up to PACKED_HEADERSIZE.
+ */
+#define PACKED_MAGIC "SUDOKUPK"
+#define PACKED_MAGICLENGTH 8
+#define PACKED_VERSION 1
+#define PACKED_HEADERSIZE 16
+#define PACKED_BITS(size) (32 - __builtin_clz(size))
+#define PACKED_RECORDSIZE(size) \
+    (1 + ((size) * (size) * PACKED_BITS(size) + 7) / 8)
+#define PACKED_MAXRECORDSIZE PACKED_RECORDSIZE(MAXSIZE)
+
+// Blocks shared with the read ahead thread; see sudokuReader.c
+typedef struct ReaderRing ReaderRing;
+
+// Buffered reader over a file descriptor
+typedef struct
+{
+    const char *data;       // current block of input
+    size_t position;        // next byte to decode within data
+    size_t length;          // number of bytes in data
+    int fd;                 // input file descriptor, -1 for memory input
+    void *mapping;          // whole input when memory mapped, else NULL
+    size_t mappingLength;
+    long lineNumber;        // line of the next byte, starting at 1; for
+                            // packed input, number of the next record
+    int packedOrder;        // box order of packed input, 0 for text
+    int recordLines;        // 1 when a line starting with anything but a
+                            // digit ends the values (batch records)
+    void (*fillHook)(void *context); // called before each read(), or NULL
+    void *fillContext;
+    ReaderRing *ring;       // read ahead blocks in streaming mode, or NULL
+    int errorCount;         // malformed tokens in the last grid read
+    long errorLine;         // line of the first malformed token
+    char errorToken[READER_TOKENSIZE]; // first malformed token
+    char buffer[READER_BUFFERSIZE];
+} SudokuReader;
+
+// Prototypes
+void readerInit(SudokuReader *reader, int fd);
+void readerInitStream(SudokuReader *reader, int fd);
+void readerInitMemory(SudokuReader *reader, const char *data, size_t length);
+void readerClose(SudokuReader *reader);
+int readerAtEnd(SudokuReader *reader);
+int readerNextCommand(SudokuReader *reader, char *command);
+int readerNextValue(SudokuReader *reader, int *value, int size);
+int readerNextGrid(SudokuReader *reader, SudokuGrid *grid);
+int readerDetectPacked(SudokuReader *reader);
+int readerNextPacked(SudokuReader *reader, char *command, SudokuGrid *grid);
+
+#endif
@@ -0,0 +1,351 @@
+/*******************************************************************************
+ * sudokuReport.c by Geoffrey Sessums
+ * Purpose:
+ *  Explains why a proposed solution is wrong: every row, column and region
+ *  that breaks the rules, with its duplicate digits, missing digits and the
+ *  cells involved, as one JSON line.
+ * Results:
+ *  {"correct":true,"violations":[]}
+ *  {"correct":false,"violations":[{"unit":"row","index":0,"missing":[3],
+ *      "duplicates":[{"value":5,"cells":[[0,1],[0,4]]}],"empty":[[0,2]]}]}
+ *  Units, rows and columns are numbered from 0, as in option L. Every
+ *  broken unit is listed once: rows first, then columns, then regions
+ *  numbered left to right and top to bottom.
+ * Notes:
+ *  reportSudoku() builds the masks of all units in a single pass over the
+ *  cells, like checkSudoku() but without stopping at the first error. Only
+ *  the cells of the units found broken are visited again to list them.
+ ******************************************************************************/
+
+// Header
+#include <stdio.h>
+#include <stdlib.h>
+#include "sudokuChecker.h"
+#include "sudokuOutput.h"
+#include "sudokuReport.h"
+
+/****************************** addCell *****************************************
+ * static void addCell(UnitReport *report, int unitIndex, DigitMask digit);
+ * Purpose:
+ *     Records one digit of a unit, marking it duplicate when already seen.
+ *******************************************************************************/
+SUDOKU_INLINE void addCell(UnitReport *report, int unitIndex, DigitMask digit)
+{
+    report->duplicateMask[unitIndex] |= report->seenMask[unitIndex] & digit;
+    report->seenMask[unitIndex] |= digit;
+}
+
+/****************************** reportSudokuOrder *******************************
+ * int reportSudokuOrder(const SudokuGrid *grid, UnitReport *report,
+ *         const int order);
+ * Purpose:
+ *     Builds the digit masks of every row, column and region in one pass.
+ * Parameters:
+ *     I    grid        proposed solution
+ *     O    report      masks of every unit
+ *     I    order       box order of grid, a constant in every instance
+ * Returns
+ *     Number of units with a duplicate, missing or empty cell; 0 when the
+ *     solution is correct
+ * Notes:
+ *     Empty cells and values out of range are recorded as bit 0.
+ *******************************************************************************/
+SUDOKU_INLINE int reportSudokuOrder(const SudokuGrid *grid,
+        UnitReport *report, const int order)
+{
+    const int size = order * order;
+    const SudokuCell *cells = grid->cells;
+    DigitMask digit;
+    int rowIndex;
+    int columnIndex;
+    int unitIndex;
+    int value;
+    int violationCount = 0;
+
+    for (unitIndex = 0; unitIndex < 3 * size; unitIndex++)
+    {
+        report->seenMask[unitIndex] = 0;
+        report->duplicateMask[unitIndex] = 0;
+    }
+
+    // Loop thru rows
+    for (rowIndex = 0; rowIndex < size; rowIndex++)
+    {
+        // Loop thru columns
+        for (columnIndex = 0; columnIndex < size; columnIndex++)
+        {
+            value = cells[rowIndex * size + columnIndex];
+            digit = (value < 1 || value > size) ? DIGITBIT(0)
+                : DIGITBIT(value);
+            addCell(report, UNIT_ROW * size + rowIndex, digit);
+            addCell(report, UNIT_COLUMN * size + columnIndex, digit);
+            addCell(report, UNIT_REGION * size
+                    + REGIONINDEX(rowIndex, columnIndex, order), digit);
+        }
+    }
+
+    // A unit is correct when it holds exactly the digits 1 thru size
+    for (unitIndex = 0; unitIndex < 3 * size; unitIndex++)
+    {
+        violationCount += report->seenMask[unitIndex] != ALLDIGITS(size)
+            || report->duplicateMask[unitIndex] != 0;
+    }
+    return violationCount;
+}
+
+// reportSudoku2 thru reportSudoku6
+#define SPECIALIZE_REPORT(order) \
+    static int reportSudoku##order(const SudokuGrid *grid, \
+            UnitReport *report) \
+    { \
+        return reportSudokuOrder(grid, report, order); \
+    }
+SPECIALIZE_ORDERS(SPECIALIZE_REPORT)
+
+/****************************** reportSudoku ************************************
+ * int reportSudoku(const SudokuGrid *grid, UnitReport *report);
+ * Purpose:
+ *     Builds the digit masks of every row, column and region, using the
+ *     routine specialized for the box order of grid.
+ * Parameters:
+ *     I    grid        proposed solution
+ *     O    report      masks of every unit
+ * Returns
+ *     Number of units that break the rules; 0 when the solution is correct
+ *******************************************************************************/
+int reportSudoku(const SudokuGrid *grid, UnitReport *report)
+{
+    static int (*const reportTable[MAXORDER + 1])(const SudokuGrid *,
+            UnitReport *) = ORDERTABLE(reportSudoku);
+
+    return reportTable[grid->order](grid, report);
+}
+
+/****************************** unitCell ****************************************
+ * static int unitCell(const SudokuGrid *grid, int unitKind, int index,
+ *         int position, int *rowIndex, int *columnIndex);
+ * Purpose:
+ *     Locates the cell at a position within a row, column or region.
+ * Parameters:
+ *     I    grid            sudoku puzzle
+ *     I    unitKind        UNIT_ROW, UNIT_COLUMN or UNIT_REGION
+ *     I    index           unit number within its kind
+ *     I    position        cell number within the unit, 0 thru size - 1
+ *     O    rowIndex        row of the cell
+ *     O    columnIndex     column of the cell
+ * Returns
+ *     Value of the cell
+ *******************************************************************************/
+static int unitCell(const SudokuGrid *grid, int unitKind, int index,
+        int position, int *rowIndex, int *columnIndex)
+{
+    const int order = grid->order;
+
+    switch (unitKind)
+    {
+        case UNIT_ROW:
+            *rowIndex = index;
+            *columnIndex = position;
+            break;
+        case UNIT_COLUMN:
+            *rowIndex = position;
+            *columnIndex = index;
+            break;
+        default:
+            *rowIndex = index / order * order + position / order;
+            *columnIndex = index % order * order + position % order;
+            break;
+    }
+    return grid->cells[*rowIndex * grid->size + *columnIndex];
+}
+
+/****************************** formatCells *************************************
+ * static void formatCells(const SudokuGrid *grid, int unitKind, int index,
+ *         DigitMask digit, OutputBuffer *output);
+ * Purpose:
+ *     Appends the [row,column] pairs of the unit's cells holding digit, as a
+ *     JSON array.
+ * Notes:
+ *     digit DIGITBIT(0) selects the empty cells and values out of range.
+ *******************************************************************************/
+static void formatCells(const SudokuGrid *grid, int unitKind, int index,
+        DigitMask digit, OutputBuffer *output)
+{
+    int position;
+    int rowIndex;
+    int columnIndex;
+    int value;
+    int cellCount = 0;
+
+    outputAppendString(output, "[");
+    for (position = 0; position < grid->size; position++)
+    {
+        value = unitCell(grid, unitKind, index, position, &rowIndex,
+                &columnIndex);
+        if (value < 1 || value > grid->size)
+        {
+            value = 0;
+        }
+        if (DIGITBIT(value) != digit)
+        {
+            continue;
+        }
+        outputAppendString(output, cellCount++ > 0 ? ",[" : "[");
+        outputAppendNumber(output, rowIndex);
+        outputAppendString(output, ",");
+        outputAppendNumber(output, columnIndex);
+        outputAppendString(output, "]");
+    }
+    outputAppendString(output, "]");
+}
+
+/****************************** formatViolation *********************************
+ * static void formatViolation(const SudokuGrid *grid, const UnitReport *report,
+ *         int unitIndex, OutputBuffer *output);
+ * Purpose:
+ *     Appends the JSON object describing what is wrong with one unit.
+ *******************************************************************************/
+static void formatViolation(const SudokuGrid *grid, const UnitReport *report,
+        int unitIndex, OutputBuffer *output)
+{
+    static const char *const unitNames[] = { "row", "column", "region" };
+    const int size = grid->size;
+    const int unitKind = unitIndex / size;
+    const int index = unitIndex % size;
+    DigitMask digits;
+    DigitMask digit;
+
+    outputAppendString(output, "{\"unit\":\"");
+    outputAppendString(output, unitNames[unitKind]);
+    outputAppendString(output, "\",\"index\":");
+    outputAppendNumber(output, index);
+
+    // Digits 1 thru size not present
+    outputAppendString(output, ",\"missing\":[");
+    digits = ALLDIGITS(size) & ~report->seenMask[unitIndex];
+    while (digits != 0)
+    {
+        outputAppendNumber(output, __builtin_ctzll(digits));
+        digits &= digits - 1;
+        outputAppendString(output, digits != 0 ? "," : "");
+    }
+
+    // Digits present more than once, with the cells holding them
+    outputAppendString(output, "],\"duplicates\":[");
+    digits = report->duplicateMask[unitIndex] & ALLDIGITS(size);
+    while (digits != 0)
+    {
+        digit = digits & -digits;
+        outputAppendString(output, "{\"value\":");
+        outputAppendNumber(output, __builtin_ctzll(digits));
+        outputAppendString(output, ",\"cells\":");
+        formatCells(grid, unitKind, index, digit, output);
+        digits &= digits - 1;
+        outputAppendString(output, digits != 0 ? "}," : "}");
+    }
+
+    // Cells left empty
+    outputAppendString(output, "],\"empty\":");
+    if (report->seenMask[unitIndex] & DIGITBIT(0))
+    {
+        formatCells(grid, unitKind, index, DIGITBIT(0), output);
+    } else
+    {
+        outputAppendString(output, "[]");
+    }
+    outputAppendString(output, "}");
+}
+
+/****************************** formatReport ************************************
+ * void formatReport(const SudokuGrid *grid, OutputBuffer *output);
+ * Purpose:
+ *     Appends the JSON report of every rule violation of a proposed
+ *     solution, without the line break.
+ * Parameters:
+ *     I    grid        proposed solution
+ *     I/O  output      buffer receiving the report
+ *******************************************************************************/
+void formatReport(const SudokuGrid *grid, OutputBuffer *output)
+{
+    UnitReport report;
+    int unitIndex;
+    int violationCount;
+
+    violationCount = reportSudoku(grid, &report);
+    outputAppendString(output, violationCount == 0
+            ? "{\"correct\":true,\"violations\":["
+            : "{\"correct\":false,\"violations\":[");
+    for (unitIndex = 0; violationCount > 0; unitIndex++)
+    {
+        if (report.seenMask[unitIndex] == ALLDIGITS(grid->size)
+                && report.duplicateMask[unitIndex] == 0)
+        {
+            continue;
+        }
+        formatViolation(grid, &report, unitIndex, output);
+        outputAppendString(output, --violationCount > 0 ? "," : "");
+    }
+    outputAppendString(output, "]}");
+}
+
+/****************************** formatReportError *******************************
+ * void formatReportError(const char *token, long lineNumber,
+ *         OutputBuffer *output);
+ * Purpose:
+ *     Appends the JSON report of a puzzle that could not be read, without
+ *     the line break.
+ * Parameters:
+ *     I    token       first malformed token
+ *     I    lineNumber  input line of the token
+ *     I/O  output      buffer receiving the report
+ * Notes:
+ *     Quotes, backslashes, control characters and bytes from 0x80 up of
+ *     the token are escaped, so the report is valid JSON whatever the
+ *     encoding of the input.
+ *******************************************************************************/
+void formatReportError(const char *token, long lineNumber,
+        OutputBuffer *output)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+    char escape[6] = { '\\', 'u', '0', '0' };
+
+    outputAppendString(output, "{\"correct\":false,\"invalidValue\":\"");
+    for (; *token != '\0'; token++)
+    {
+        if (*token == '"' || *token == '\\')
+        {
+            outputAppendString(output, "\\");
+            outputAppend(output, token, 1);
+        } else if ((unsigned char)*token < 0x20
+                || (unsigned char)*token >= 0x80)
+        {
+            // Bytes of any encoding stay valid JSON as their code points
+            escape[4] = hexDigits[(unsigned char)*token >> 4];
+            escape[5] = hexDigits[*token & 0xF];
+            outputAppend(output, escape, sizeof(escape));
+        } else
+        {
+            outputAppend(output, token, 1);
+        }
+    }
+    outputAppendString(output, "\",\"line\":");
+    outputAppendNumber(output, lineNumber);
+    outputAppendString(output, "}");
+}
+
+/****************************** formatReportTruncated ***************************
+ * void formatReportTruncated(long lineNumber, OutputBuffer *output);
+ * Purpose:
+ *     Appends the JSON report of a puzzle whose values the input, or the
+ *     next record, ended early, without the line break.
+ * Parameters:
+ *     I    lineNumber  input line the puzzle starts at
+ *     I/O  output      buffer receiving the report
+ *******************************************************************************/
+void formatReportTruncated(long lineNumber, OutputBuffer *output)
+{
+    outputAppendString(output,
+            "{\"correct\":false,\"truncated\":true,\"line\":");
+    outputAppendNumber(output, lineNumber);
+    outputAppendString(output, "}");
+}
@@ -0,0 +1,32 @@
+/*******************************************************************************
+ * sudokuReport.h by Geoffrey Sessums
+ * Purpose:
+ *   Defines the unit masks from which every rule violation of a proposed
+ *   solution is reported.
+ *   Prototypes
+ * Notes:
+ *   Requires sudokuChecker.h and sudokuOutput.h
+ *******************************************************************************/
+#ifndef SUDOKUREPORT_H
+#define SUDOKUREPORT_H
+
+// Unit numbering: rows 0 thru size - 1, then columns, then regions
+#define UNIT_ROW 0
+#define UNIT_COLUMN 1
+#define UNIT_REGION 2
+
+// Digits of every unit; bit 0 stands for an empty cell
+typedef struct
+{
+    DigitMask seenMask[MAXUNITS];       // digits present at least once
+    DigitMask duplicateMask[MAXUNITS];  // digits present more than once
+} UnitReport;
+
+// Prototypes
+int reportSudoku(const SudokuGrid *grid, UnitReport *report);
+void formatReport(const SudokuGrid *grid, OutputBuffer *output);
+void formatReportError(const char *token, long lineNumber,
+        OutputBuffer *output);
+void formatReportTruncated(long lineNumber, OutputBuffer *output);
+
+#endif
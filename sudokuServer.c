@@ -0,0 +1,631 @@
+/*******************************************************************************
+ * sudokuServer.c by Geoffrey Sessums
+ * Purpose:
+ *  Serves batch records over a Unix domain socket or a local TCP port, so a
+ *  caller pays for a connection instead of a process per puzzle.
+ * Protocol:
+ *  The client writes batch records exactly as in batch mode (see
+ *  sudokuBatch.c) and reads back one result line per record, in order.
+ *  Requests may be pipelined: replies are sent whenever the server has
+ *  used up the bytes received so far, so many records sent together are
+ *  answered together. An E command or end of input closes the connection.
+ * Notes:
+ *  The main thread watches the listening socket and every connection with
+ *  epoll (Linux). When a connection has received bytes, it is handed with
+ *  them to one of threadCount workers, which answers the complete records
+ *  and sends the replies, then hands the connection back. A connection
+ *  is held by one thread at a time, so its replies stay in order, and an
+ *  idle connection costs no worker: any number of clients may keep their
+ *  connections open. Bytes are not received from a client while its
+ *  replies wait to be sent, so a client that stops reading holds at most
+ *  SERVER_INPUTSIZE bytes of requests and their replies.
+ *  When accept() runs out of descriptors, the listening socket is left
+ *  unwatched until a connection closes or SERVER_RETRYMS pass, instead of
+ *  failing again at once.
+ ******************************************************************************/
+
+// Header
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "sudokuChecker.h"
+#include "sudokuOutput.h"
+#include "sudokuReader.h"
+#include "sudokuCache.h"
+#include "sudokuVariant.h"
+#include "sudokuBatch.h"
+
+#define SERVER_BACKLOG 128
+// Events taken per epoll_wait()
+#define SERVER_EVENTS 64
+// Bytes received per recv(), and held per connection until answered
+#define SERVER_READSIZE 16384
+#define SERVER_INPUTSIZE 65536
+// Wait before accepting again after running out of descriptors, ms
+#define SERVER_RETRYMS 100
+
+// One client connection; held by the main thread or by one worker
+typedef struct ServerConnection
+{
+    int fd;
+    int inputEnded;                 // the client closed its side
+    int closing;                    // close once the replies are sent
+    long lineNumber;                // line of the first byte of input
+    OutputBuffer input;             // bytes received, not yet answered
+    OutputBuffer output;            // replies not sent yet
+    size_t outputSent;              // bytes of output already sent
+    struct ServerConnection *next;  // next in the ready or done list
+} ServerConnection;
+
+// Connections passed between the main thread and the workers
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t connectionReady; // signaled when a connection is ready
+    ServerConnection *readyFirst;   // received bytes, waiting for a worker
+    ServerConnection *readyLast;
+    ServerConnection *doneFirst;    // answered, waiting for the main thread
+    ServerConnection *doneLast;
+    int wakeFd;                     // eventfd: a connection is done
+    int order;                      // box order of every puzzle
+} ServerQueue;
+
+// State of one worker, reused for every turn it serves
+typedef struct
+{
+    ServerQueue *queue;
+    SudokuReader reader;
+    BatchRecord record;
+    SudokuCell cells[MAXCELLS];
+} ServerWorker;
+
+/****************************** openServerSocket ********************************
+ * int openServerSocket(const char *path, int port);
+ * Purpose:
+ *     Creates the listening socket of server mode.
+ * Parameters:
+ *     I    path        Unix domain socket path, or NULL to use port
+ *     I    port        TCP port on the loopback address
+ * Returns
+ *     Listening socket descriptor
+ * Notes:
+ *     A stale socket file at path is replaced. Exits with ERROR_PROCESSING
+ *     when the socket cannot be created.
+ *******************************************************************************/
+int openServerSocket(const char *path, int port)
+{
+    struct sockaddr_un unixAddress;
+    struct sockaddr_in tcpAddress;
+    int listenFd;
+    int reuse = 1;
+
+    if (path != NULL)
+    {
+        if (strlen(path) >= sizeof(unixAddress.sun_path))
+        {
+            exitError("Socket path is too long.");
+        }
+        memset(&unixAddress, 0, sizeof(unixAddress));
+        unixAddress.sun_family = AF_UNIX;
+        strcpy(unixAddress.sun_path, path);
+        listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(path);
+        if (listenFd < 0 || bind(listenFd, (struct sockaddr *)&unixAddress,
+                    sizeof(unixAddress)) != 0)
+        {
+            exitError("Unable to bind socket.");
+        }
+    } else
+    {
+        memset(&tcpAddress, 0, sizeof(tcpAddress));
+        tcpAddress.sin_family = AF_INET;
+        tcpAddress.sin_port = htons((unsigned short)port);
+        tcpAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        if (listenFd < 0)
+        {
+            exitError("Unable to bind socket.");
+        }
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (bind(listenFd, (struct sockaddr *)&tcpAddress,
+                    sizeof(tcpAddress)) != 0)
+        {
+            exitError("Unable to bind socket.");
+        }
+    }
+    if (listen(listenFd, SERVER_BACKLOG) != 0)
+    {
+        exitError("Unable to listen on socket.");
+    }
+    return listenFd;
+}
+
+/****************************** appendConnection ********************************
+ * static void appendConnection(ServerConnection **first,
+ *         ServerConnection **last, ServerConnection *connection);
+ * Purpose:
+ *     Adds a connection at the end of a list. The caller holds the lock.
+ *******************************************************************************/
+static void appendConnection(ServerConnection **first,
+        ServerConnection **last, ServerConnection *connection)
+{
+    connection->next = NULL;
+    if (*first == NULL)
+    {
+        *first = connection;
+    } else
+    {
+        (*last)->next = connection;
+    }
+    *last = connection;
+}
+
+/****************************** sendReplies *************************************
+ * static int sendReplies(ServerConnection *connection);
+ * Purpose:
+ *     Sends the buffered replies of a connection without waiting.
+ * Parameters:
+ *     I/O  connection  connection whose output to send
+ * Returns
+ *     1    every reply sent, or dropped because the client stopped taking
+ *          them (the connection is then closing)
+ *     0    the socket is full; the rest waits for it to drain
+ *******************************************************************************/
+static int sendReplies(ServerConnection *connection)
+{
+    ssize_t written;
+
+    while (connection->outputSent < connection->output.length)
+    {
+        written = send(connection->fd,
+                connection->output.data + connection->outputSent,
+                connection->output.length - connection->outputSent,
+                MSG_NOSIGNAL);
+        if (written >= 0)
+        {
+            connection->outputSent += (size_t)written;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            return 0;
+        } else if (errno != EINTR)
+        {
+            connection->closing = 1;
+            break;
+        }
+    }
+    connection->output.length = 0;
+    connection->outputSent = 0;
+    return 1;
+}
+
+/****************************** answerRecords ***********************************
+ * static void answerRecords(ServerWorker *worker,
+ *         ServerConnection *connection);
+ * Purpose:
+ *     Answers every complete record received on a connection, keeping the
+ *     bytes of a record still on its way for the next turn.
+ * Parameters:
+ *     I/O  worker      worker serving the connection
+ *     I/O  connection  connection whose input to answer
+ * Notes:
+ *     A record is still on its way when the bytes received end within it,
+ *     or, for numbers, right after its last one, which may go on. Once the
+ *     client has closed its side, the last record is answered as it is.
+ *******************************************************************************/
+static void answerRecords(ServerWorker *worker, ServerConnection *connection)
+{
+    SudokuReader *reader = &worker->reader;
+    BatchRecord *record = &worker->record;
+    size_t recordStart;
+    long recordLine;
+    int waiting;
+
+    readerInitMemory(reader, connection->input.data, connection->input.length);
+    reader->lineNumber = connection->lineNumber;
+    for (;;)
+    {
+        recordStart = reader->position;
+        recordLine = reader->lineNumber;
+        if (!readBatchRecord(reader, record))
+        {
+            // Nothing but white space left
+            recordStart = reader->position;
+            recordLine = reader->lineNumber;
+            break;
+        }
+        if (record->command == 'e' || record->command == 'E')
+        {
+            connection->closing = 1;
+            break;
+        }
+        waiting = !connection->inputEnded && readerAtEnd(reader)
+            && (record->truncated || record->grid.size > 9
+                || record->command == 'g' || record->command == 'G');
+        if (waiting && (recordStart > 0
+                    || connection->input.length < SERVER_INPUTSIZE))
+        {
+            break;
+        }
+        processRecord(record, &connection->output);
+        if (waiting)
+        {
+            // A record longer than the input held can never complete
+            connection->closing = 1;
+            break;
+        }
+    }
+    readerClose(reader);
+    if (connection->inputEnded || connection->closing)
+    {
+        connection->closing = 1;
+        connection->input.length = 0;
+        return;
+    }
+    memmove(connection->input.data, connection->input.data + recordStart,
+            connection->input.length - recordStart);
+    connection->input.length -= recordStart;
+    connection->lineNumber = recordLine;
+}
+
+/****************************** serverThread ************************************
+ * static void *serverThread(void *argument);
+ * Purpose:
+ *     Takes connections that received bytes, answers their records and
+ *     hands them back to the main thread, forever.
+ * Parameters:
+ *     I/O  argument    the worker's ServerWorker
+ *******************************************************************************/
+static void *serverThread(void *argument)
+{
+    ServerWorker *worker = argument;
+    ServerQueue *queue = worker->queue;
+    ServerConnection *connection;
+    uint64_t wake = 1;
+
+    initGrid(&worker->record.grid, queue->order, worker->cells);
+    for (;;)
+    {
+        pthread_mutex_lock(&queue->lock);
+        while (queue->readyFirst == NULL)
+        {
+            pthread_cond_wait(&queue->connectionReady, &queue->lock);
+        }
+        connection = queue->readyFirst;
+        queue->readyFirst = connection->next;
+        pthread_mutex_unlock(&queue->lock);
+
+        answerRecords(worker, connection);
+        sendReplies(connection);
+
+        pthread_mutex_lock(&queue->lock);
+        appendConnection(&queue->doneFirst, &queue->doneLast, connection);
+        pthread_mutex_unlock(&queue->lock);
+        while (write(queue->wakeFd, &wake, sizeof(wake)) < 0
+                && errno == EINTR)
+        {
+        }
+    }
+    return NULL;
+}
+
+/****************************** receiveRequests *********************************
+ * static int receiveRequests(ServerConnection *connection);
+ * Purpose:
+ *     Receives what a readable connection has, up to SERVER_INPUTSIZE bytes
+ *     held.
+ * Parameters:
+ *     I/O  connection  connection to receive from
+ * Returns
+ *     1 when bytes arrived or the client closed its side, else 0
+ *******************************************************************************/
+static int receiveRequests(ServerConnection *connection)
+{
+    ssize_t received;
+    int arrived = 0;
+
+    while (connection->input.length < SERVER_INPUTSIZE)
+    {
+        outputReserve(&connection->input, SERVER_READSIZE);
+        received = recv(connection->fd,
+                connection->input.data + connection->input.length,
+                SERVER_READSIZE, 0);
+        if (received > 0)
+        {
+            connection->input.length += (size_t)received;
+            arrived = 1;
+        } else if (received == 0)
+        {
+            connection->inputEnded = 1;
+            return 1;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            break;
+        } else if (errno != EINTR)
+        {
+            // Reset by the client: answer what came, then close
+            connection->inputEnded = 1;
+            return 1;
+        }
+    }
+    return arrived;
+}
+
+/****************************** watchConnection *********************************
+ * static void watchConnection(int epollFd, ServerConnection *connection,
+ *         uint32_t events);
+ * Purpose:
+ *     Has the main thread wait for a connection to become readable or
+ *     writable, once.
+ *******************************************************************************/
+static void watchConnection(int epollFd, ServerConnection *connection,
+        uint32_t events)
+{
+    struct epoll_event event;
+
+    event.events = events | EPOLLONESHOT;
+    event.data.ptr = connection;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, connection->fd, &event);
+}
+
+/****************************** closeConnection *********************************
+ * static void closeConnection(ServerConnection *connection);
+ * Purpose:
+ *     Closes a connection and releases its buffers.
+ *******************************************************************************/
+static void closeConnection(ServerConnection *connection)
+{
+    close(connection->fd);
+    outputFree(&connection->input);
+    outputFree(&connection->output);
+    free(connection);
+}
+
+/****************************** settleConnection ********************************
+ * static int settleConnection(int epollFd, ServerConnection *connection);
+ * Purpose:
+ *     Decides what a connection held by the main thread waits for next:
+ *     room for its replies, more requests, or nothing, closing it.
+ * Returns
+ *     1 when the connection was closed, else 0
+ *******************************************************************************/
+static int settleConnection(int epollFd, ServerConnection *connection)
+{
+    if (connection->outputSent < connection->output.length)
+    {
+        watchConnection(epollFd, connection, EPOLLOUT);
+        return 0;
+    }
+    if (connection->closing)
+    {
+        closeConnection(connection);
+        return 1;
+    }
+    watchConnection(epollFd, connection, EPOLLIN);
+    return 0;
+}
+
+/****************************** acceptConnections *******************************
+ * static int acceptConnections(int listenFd, int epollFd);
+ * Purpose:
+ *     Accepts every pending connection and starts watching it.
+ * Returns
+ *     1 when no connection is left pending, 0 when accept() failed for want
+ *     of descriptors or memory, or for a reason that would repeat
+ *******************************************************************************/
+static int acceptConnections(int listenFd, int epollFd)
+{
+    ServerConnection *connection;
+    struct epoll_event event;
+    int connectionFd;
+    int noDelay = 1;
+
+    for (;;)
+    {
+        connectionFd = accept(listenFd, NULL, NULL);
+        if (connectionFd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue; // the client already gave up
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        fcntl(connectionFd, F_SETFL,
+                fcntl(connectionFd, F_GETFL) | O_NONBLOCK);
+        // Replies are sent in blocks already; do not delay them further
+        setsockopt(connectionFd, IPPROTO_TCP, TCP_NODELAY, &noDelay,
+                sizeof(noDelay));
+
+        connection = malloc(sizeof(ServerConnection));
+        if (connection == NULL)
+        {
+            exitError("Out of memory.");
+        }
+        connection->fd = connectionFd;
+        connection->inputEnded = 0;
+        connection->closing = 0;
+        connection->lineNumber = 1;
+        outputInit(&connection->input);
+        outputInit(&connection->output);
+        connection->outputSent = 0;
+        event.events = EPOLLIN | EPOLLONESHOT;
+        event.data.ptr = connection;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, connectionFd, &event) != 0)
+        {
+            closeConnection(connection);
+            return 0;
+        }
+    }
+}
+
+/****************************** watchListener ***********************************
+ * static void watchListener(int epollFd, int listenFd, int watch);
+ * Purpose:
+ *     Starts or stops watching the listening socket for connections.
+ *******************************************************************************/
+static void watchListener(int epollFd, int listenFd, int watch)
+{
+    struct epoll_event event;
+
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    epoll_ctl(epollFd, watch ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, listenFd,
+            &event);
+}
+
+/****************************** millisecondsNow *********************************
+ * static long millisecondsNow(void);
+ * Purpose:
+ *     Reads the monotonic clock, in milliseconds.
+ *******************************************************************************/
+static long millisecondsNow(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/****************************** runServer ***************************************
+ * void runServer(int listenFd, int threadCount, int order);
+ * Purpose:
+ *     Accepts connections on listenFd, watches them all and answers their
+ *     records on threadCount worker threads. Does not return.
+ * Parameters:
+ *     I    listenFd        listening socket from openServerSocket()
+ *     I    threadCount     number of worker threads, at least 1
+ *     I    order           box order of every puzzle
+ * Notes:
+ *     Exits with ERROR_PROCESSING when memory or threads are exhausted or
+ *     epoll cannot be set up.
+ *******************************************************************************/
+void runServer(int listenFd, int threadCount, int order)
+{
+    struct epoll_event events[SERVER_EVENTS];
+    ServerQueue queue;
+    ServerWorker *workers;
+    ServerConnection *connection;
+    ServerConnection *done;
+    pthread_t thread;
+    uint64_t wakes;
+    int epollFd;
+    int eventCount;
+    int eventIndex;
+    int threadIndex;
+    int listening = 1;
+    long pausedAt = 0;
+
+    workers = malloc(sizeof(ServerWorker) * threadCount);
+    if (workers == NULL)
+    {
+        exitError("Out of memory.");
+    }
+    queue.readyFirst = NULL;
+    queue.readyLast = NULL;
+    queue.doneFirst = NULL;
+    queue.doneLast = NULL;
+    queue.order = order;
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.connectionReady, NULL);
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    queue.wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || queue.wakeFd < 0)
+    {
+        exitError("Unable to watch connections.");
+    }
+    events[0].events = EPOLLIN;
+    events[0].data.ptr = &queue;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, queue.wakeFd, &events[0]);
+    fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+    watchListener(epollFd, listenFd, 1);
+    for (threadIndex = 0; threadIndex < threadCount; threadIndex++)
+    {
+        workers[threadIndex].queue = &queue;
+        if (pthread_create(&thread, NULL, serverThread,
+                    &workers[threadIndex]) != 0)
+        {
+            exitError("Unable to start worker thread.");
+        }
+        pthread_detach(thread);
+    }
+
+    for (;;)
+    {
+        eventCount = epoll_wait(epollFd, events, SERVER_EVENTS,
+                listening ? -1 : SERVER_RETRYMS);
+        if (!listening && millisecondsNow() - pausedAt >= SERVER_RETRYMS)
+        {
+            watchListener(epollFd, listenFd, 1);
+            listening = 1;
+        }
+        for (eventIndex = 0; eventIndex < eventCount; eventIndex++)
+        {
+            connection = events[eventIndex].data.ptr;
+            if (connection == NULL)
+            {
+                // The listener; when out of descriptors, wait instead of
+                // failing again at once
+                if (listening && !acceptConnections(listenFd, epollFd))
+                {
+                    watchListener(epollFd, listenFd, 0);
+                    listening = 0;
+                    pausedAt = millisecondsNow();
+                }
+                continue;
+            }
+            if (events[eventIndex].data.ptr == &queue)
+            {
+                // Workers handed connections back
+                while (read(queue.wakeFd, &wakes, sizeof(wakes)) < 0
+                        && errno == EINTR)
+                {
+                }
+                pthread_mutex_lock(&queue.lock);
+                done = queue.doneFirst;
+                queue.doneFirst = NULL;
+                pthread_mutex_unlock(&queue.lock);
+                while (done != NULL)
+                {
+                    connection = done;
+                    done = done->next;
+                    if (settleConnection(epollFd, connection) && !listening)
+                    {
+                        // A descriptor is free again
+                        watchListener(epollFd, listenFd, 1);
+                        listening = 1;
+                    }
+                }
+                continue;
+            }
+            if (connection->outputSent < connection->output.length)
+            {
+                sendReplies(connection);
+            } else if (receiveRequests(connection))
+            {
+                pthread_mutex_lock(&queue.lock);
+                appendConnection(&queue.readyFirst, &queue.readyLast,
+                        connection);
+                pthread_cond_signal(&queue.connectionReady);
+                pthread_mutex_unlock(&queue.lock);
+                continue;
+            }
+            if (settleConnection(epollFd, connection) && !listening)
+            {
+                watchListener(epollFd, listenFd, 1);
+                listening = 1;
+            }
+        }
+    }
+}
@@ -0,0 +1,353 @@
+/*******************************************************************************
+ * sudokuSession.c by Geoffrey Sessums
+ * Purpose:
+ *  Game sessions of libsudokuchecker: a puzzle being filled in one move at
+ *  a time, for interactive clients that place and erase values and undo
+ *  moves. Every move reports its conflicts and whether the puzzle is now
+ *  solved in constant time, instead of checking the whole grid again.
+ * Notes:
+ *  The session counts, for every row, column and region, how many times
+ *  each value appears in it. A move changes three counts out and three in,
+ *  and conflictCount, the number of values repeated within a unit, follows
+ *  them: the grid is solved exactly when every cell is filled and no value
+ *  repeats. The session lives in the caller's memory, about 7 KB, and is
+ *  never allocated or freed here.
+ ******************************************************************************/
+
+// Header
+#include <stddef.h>
+#include <string.h>
+#include "sudokuChecker.h"
+#include "sudokuLibrary.h"
+
+/****************************** sessionStarted ********************************
+ * static int sessionStarted(const SudokuSession *session);
+ * Purpose:
+ *     Tells whether a session was started by sudokuSessionStart().
+ *******************************************************************************/
+static int sessionStarted(const SudokuSession *session)
+{
+    return session != NULL && session->grid.cells == session->cells;
+}
+
+/****************************** addValue ****************************************
+ * static int addValue(SudokuSession *session, int cellIndex, int value);
+ * Purpose:
+ *     Counts a value newly placed in an empty cell in its three units.
+ * Returns
+ *     Number of those units, 0 thru 3, that already held the value
+ *******************************************************************************/
+static int addValue(SudokuSession *session, int cellIndex, int value)
+{
+    const int size = session->grid.size;
+    const int rowIndex = cellIndex / size;
+    const int columnIndex = cellIndex % size;
+    const int units[3] = {rowIndex, size + columnIndex,
+        2 * size + REGIONINDEX(rowIndex, columnIndex, session->grid.order)};
+    int clashes = 0;
+    int unitIndex;
+
+    for (unitIndex = 0; unitIndex < 3; unitIndex++)
+    {
+        clashes += session->valueCounts[units[unitIndex]][value]++ != 0;
+        session->unitMasks[units[unitIndex]] |= DIGITBIT(value);
+    }
+    session->cells[cellIndex] = (SudokuCell)value;
+    session->conflictCount += clashes;
+    session->filledCount++;
+    return clashes;
+}
+
+/****************************** removeValue *************************************
+ * static void removeValue(SudokuSession *session, int cellIndex);
+ * Purpose:
+ *     Empties a filled cell and uncounts its value in its three units.
+ *******************************************************************************/
+static void removeValue(SudokuSession *session, int cellIndex)
+{
+    const int size = session->grid.size;
+    const int rowIndex = cellIndex / size;
+    const int columnIndex = cellIndex % size;
+    const int units[3] = {rowIndex, size + columnIndex,
+        2 * size + REGIONINDEX(rowIndex, columnIndex, session->grid.order)};
+    const int value = session->cells[cellIndex];
+    int unitIndex;
+
+    for (unitIndex = 0; unitIndex < 3; unitIndex++)
+    {
+        if (--session->valueCounts[units[unitIndex]][value] != 0)
+        {
+            session->conflictCount--;
+        } else
+        {
+            session->unitMasks[units[unitIndex]] &= ~DIGITBIT(value);
+        }
+    }
+    session->cells[cellIndex] = 0;
+    session->filledCount--;
+}
+
+/****************************** setValue ****************************************
+ * static int setValue(SudokuSession *session, int cellIndex, int value);
+ * Purpose:
+ *     Replaces the value of a cell, 0 to empty it.
+ * Returns
+ *     Number of the cell's units, 0 thru 3, that already held the value
+ *******************************************************************************/
+static int setValue(SudokuSession *session, int cellIndex, int value)
+{
+    if (session->cells[cellIndex] != 0)
+    {
+        removeValue(session, cellIndex);
+    }
+    return value != 0 ? addValue(session, cellIndex, value) : 0;
+}
+
+/****************************** playerMove **************************************
+ * static int playerMove(SudokuSession *session, int row, int column,
+ *         int value);
+ * Purpose:
+ *     Validates a move of the player, remembers it for undo and makes it.
+ * Returns
+ *     Number of the cell's units, 0 thru 3, that already held the value,
+ *     or SUDOKU_ERROR_ORDER, SUDOKU_ERROR_INVALID or SUDOKU_ERROR_GIVEN
+ *******************************************************************************/
+static int playerMove(SudokuSession *session, int row, int column, int value)
+{
+    SudokuMove *move;
+    int cellIndex;
+
+    if (!sessionStarted(session))
+    {
+        return SUDOKU_ERROR_ORDER;
+    }
+    if (row < 0 || row >= session->grid.size || column < 0
+            || column >= session->grid.size || value < 0
+            || value > session->grid.size)
+    {
+        return SUDOKU_ERROR_INVALID;
+    }
+    if (session->givens[row] & DIGITBIT(column))
+    {
+        return SUDOKU_ERROR_GIVEN;
+    }
+    cellIndex = row * session->grid.size + column;
+
+    // The oldest move makes room once the history is full
+    move = &session->undo[session->undoNext];
+    move->cell = (unsigned short)cellIndex;
+    move->previous = session->cells[cellIndex];
+    session->undoNext = (session->undoNext + 1) % SUDOKU_UNDODEPTH;
+    if (session->undoCount < SUDOKU_UNDODEPTH)
+    {
+        session->undoCount++;
+    }
+    return setValue(session, cellIndex, value);
+}
+
+/****************************** sudokuSessionStart ******************************
+ * int sudokuSessionStart(SudokuSession *session, const SudokuGrid *puzzle);
+ * Purpose:
+ *     Starts a game on a puzzle. Its values are the givens, which moves
+ *     cannot change.
+ * Parameters:
+ *     O    session     session to start, owned by the caller
+ *     I    puzzle      puzzle, zero for empty cells; copied
+ * Returns
+ *     SUDOKU_OK, SUDOKU_ERROR_ORDER, or SUDOKU_ERROR_INVALID for a value
+ *     out of range
+ * Notes:
+ *     Every value is checked before the session changes; on an error the
+ *     session is left not started.
+ *******************************************************************************/
+int sudokuSessionStart(SudokuSession *session, const SudokuGrid *puzzle)
+{
+    int cellIndex;
+    int value;
+
+    if (session == NULL)
+    {
+        return SUDOKU_ERROR_ORDER;
+    }
+    session->grid.cells = NULL; // not started until the puzzle is accepted
+    if (puzzle == NULL || puzzle->cells == NULL || puzzle->order < MINORDER
+            || puzzle->order > MAXORDER
+            || puzzle->size != puzzle->order * puzzle->order)
+    {
+        return SUDOKU_ERROR_ORDER;
+    }
+    for (cellIndex = 0; cellIndex < puzzle->size * puzzle->size; cellIndex++)
+    {
+        if (puzzle->cells[cellIndex] > puzzle->size)
+        {
+            return SUDOKU_ERROR_INVALID;
+        }
+    }
+    sudokuInitGrid(&session->grid, puzzle->order, session->cells);
+    memset(session->cells, 0, sizeof(session->cells));
+    memset(session->givens, 0, sizeof(session->givens));
+    memset(session->unitMasks, 0, sizeof(session->unitMasks));
+    memset(session->valueCounts, 0, sizeof(session->valueCounts));
+    session->filledCount = 0;
+    session->conflictCount = 0;
+    session->undoCount = 0;
+    session->undoNext = 0;
+    for (cellIndex = 0; cellIndex < puzzle->size * puzzle->size; cellIndex++)
+    {
+        value = puzzle->cells[cellIndex];
+        if (value != 0)
+        {
+            addValue(session, cellIndex, value);
+            session->givens[cellIndex / puzzle->size] |=
+                DIGITBIT(cellIndex % puzzle->size);
+        }
+    }
+    return SUDOKU_OK;
+}
+
+/****************************** sudokuSessionPlace ******************************
+ * int sudokuSessionPlace(SudokuSession *session, int row, int column,
+ *         int value);
+ * Purpose:
+ *     Places a value in a cell, replacing any value the player put there.
+ * Parameters:
+ *     I/O  session     game in progress
+ *     I    row         row of the cell, from 0
+ *     I    column      column of the cell, from 0
+ *     I    value       1 thru size
+ * Returns
+ *     Number of the cell's row, column and region, 0 thru 3, that already
+ *     held the value, so 0 when the move creates no conflict; or
+ *     SUDOKU_ERROR_ORDER for a session never started, SUDOKU_ERROR_INVALID
+ *     for a cell or value out of range, SUDOKU_ERROR_GIVEN for a cell of
+ *     the puzzle
+ *******************************************************************************/
+int sudokuSessionPlace(SudokuSession *session, int row, int column,
+        int value)
+{
+    if (value == 0)
+    {
+        return SUDOKU_ERROR_INVALID;
+    }
+    return playerMove(session, row, column, value);
+}
+
+/****************************** sudokuSessionErase ******************************
+ * int sudokuSessionErase(SudokuSession *session, int row, int column);
+ * Purpose:
+ *     Empties a cell the player filled. Erasing an empty cell is a move
+ *     that changes nothing.
+ * Parameters:
+ *     I/O  session     game in progress
+ *     I    row         row of the cell, from 0
+ *     I    column      column of the cell, from 0
+ * Returns
+ *     SUDOKU_OK, or an error as for sudokuSessionPlace()
+ *******************************************************************************/
+int sudokuSessionErase(SudokuSession *session, int row, int column)
+{
+    return playerMove(session, row, column, 0);
+}
+
+/****************************** sudokuSessionUndo *******************************
+ * int sudokuSessionUndo(SudokuSession *session);
+ * Purpose:
+ *     Takes back the latest move not yet undone, restoring the value the
+ *     cell held before it.
+ * Parameters:
+ *     I/O  session     game in progress
+ * Returns
+ *     Number of the cell's units, 0 thru 3, that already held the restored
+ *     value (0 when the cell is emptied again); SUDOKU_ERROR_NOMOVE when
+ *     no move is left, as after SUDOKU_UNDODEPTH undos in a row; or
+ *     SUDOKU_ERROR_ORDER for a session never started
+ *******************************************************************************/
+int sudokuSessionUndo(SudokuSession *session)
+{
+    const SudokuMove *move;
+
+    if (!sessionStarted(session))
+    {
+        return SUDOKU_ERROR_ORDER;
+    }
+    if (session->undoCount == 0)
+    {
+        return SUDOKU_ERROR_NOMOVE;
+    }
+    session->undoNext = (session->undoNext + SUDOKU_UNDODEPTH - 1)
+        % SUDOKU_UNDODEPTH;
+    session->undoCount--;
+    move = &session->undo[session->undoNext];
+    return setValue(session, move->cell, move->previous);
+}
+
+/****************************** sudokuSessionSolved *****************************
+ * int sudokuSessionSolved(const SudokuSession *session);
+ * Purpose:
+ *     Tells whether the grid is complete and correct.
+ * Returns
+ *     1 when every cell is filled and no value repeats within a row,
+ *     column or region; else 0; SUDOKU_ERROR_ORDER for a session never
+ *     started
+ *******************************************************************************/
+int sudokuSessionSolved(const SudokuSession *session)
+{
+    if (!sessionStarted(session))
+    {
+        return SUDOKU_ERROR_ORDER;
+    }
+    return session->filledCount == session->grid.size * session->grid.size
+        && session->conflictCount == 0;
+}
+
+/****************************** sudokuSessionConflicts **************************
+ * int sudokuSessionConflicts(const SudokuSession *session);
+ * Purpose:
+ *     Counts the conflicts of the grid: every value beyond the first of its
+ *     kind in a row, column or region counts once for that unit.
+ * Returns
+ *     Number of conflicts, 0 when no value repeats; SUDOKU_ERROR_ORDER for
+ *     a session never started
+ *******************************************************************************/
+int sudokuSessionConflicts(const SudokuSession *session)
+{
+    if (!sessionStarted(session))
+    {
+        return SUDOKU_ERROR_ORDER;
+    }
+    return session->conflictCount;
+}
+
+/****************************** sudokuSessionCandidates *************************
+ * DigitMask sudokuSessionCandidates(const SudokuSession *session, int row,
+ *         int column);
+ * Purpose:
+ *     Finds the values an empty cell can take without a conflict.
+ * Parameters:
+ *     I    session     game in progress
+ *     I    row         row of the cell, from 0
+ *     I    column      column of the cell, from 0
+ * Returns
+ *     Bit n set when n is possible; 0 for a filled cell, one out of range,
+ *     or a session never started
+ *******************************************************************************/
+DigitMask sudokuSessionCandidates(const SudokuSession *session, int row,
+        int column)
+{
+    int size;
+
+    if (!sessionStarted(session))
+    {
+        return 0;
+    }
+    size = session->grid.size;
+    if (row < 0 || row >= size || column < 0 || column >= size
+            || session->cells[row * size + column] != 0)
+    {
+        return 0;
+    }
+    return ALLDIGITS(size) & ~(session->unitMasks[row]
+            | session->unitMasks[size + column]
+            | session->unitMasks[2 * size
+                + REGIONINDEX(row, column, session->grid.order)]);
+}
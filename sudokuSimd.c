@@ -0,0 +1,378 @@
+/*******************************************************************************
+ * sudokuSimd.c by Geoffrey Sessums
+ * Purpose:
+ *  Checks many sudoku solutions at once. The grids of a block are laid out
+ *  cell by cell, one byte per grid, so that each vector register holds the
+ *  same cell of 16 (SSSE3) or 32 (AVX2) grids. Digit bits are looked up
+ *  with byte shuffles and ORed into row, column and region masks, giving a
+ *  pass/fail result for every grid of the block.
+ * Notes:
+ *  The kernels are compiled for their instruction sets with target
+ *  attributes and picked at run time, so one binary runs on any x86-64
+ *  host. They handle classic 9x9 grids only; other orders, other hosts,
+ *  and blocks too small to fill a register use the scalar checkSudoku().
+ *
+ *  A unit is correct exactly when the OR of its nine digit bits equals
+ *  ALLDIGITS: nine cells can only cover nine digits if none repeats. Empty
+ *  cells set bit 0 and out of range values set no bit, so both fail.
+ ******************************************************************************/
+
+// Header
+#include <string.h>
+#include "sudokuChecker.h"
+#include "sudokuSimd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+// Classic 9x9 geometry of the vector kernels
+#define ORDER 3
+#define SIZE (ORDER * ORDER)
+#define CELLS (SIZE * SIZE)
+#define ALLNINE ALLDIGITS(SIZE)
+
+/****************************** checkSudokuGridsScalar **************************
+ * static void checkSudokuGridsScalar(const SudokuGrid *const grids[],
+ *         int gridCount, unsigned char results[]);
+ * Purpose:
+ *     Checks each grid with checkSudoku().
+ * Parameters:
+ *     I    grids[]     grids to check
+ *     I    gridCount   number of grids
+ *     O    results[]   1 for a correct solution, else 0, per grid
+ *******************************************************************************/
+static void checkSudokuGridsScalar(const SudokuGrid *const grids[],
+        int gridCount, unsigned char results[])
+{
+    int gridIndex;
+
+    for (gridIndex = 0; gridIndex < gridCount; gridIndex++)
+    {
+        results[gridIndex] = (unsigned char)checkSudoku(grids[gridIndex]);
+    }
+}
+
+#ifdef SIMD_X86
+
+/****************************** transposeBlock **********************************
+ * static void transposeBlock(const SudokuGrid *const grids[], int gridCount,
+ *         int lanes, unsigned char block[]);
+ * Purpose:
+ *     Lays out up to lanes grids cell by cell, one byte per grid. Values
+ *     outside 0 thru 9 become 15, which has no digit bit, and unused lanes
+ *     are left empty.
+ * Parameters:
+ *     I    grids[]     grids of the block
+ *     I    gridCount   number of grids, at most lanes
+ *     I    lanes       grids per register
+ *     O    block[]     CELLS * lanes bytes
+ *******************************************************************************/
+static void transposeBlock(const SudokuGrid *const grids[], int gridCount,
+        int lanes, unsigned char block[])
+{
+    const SudokuCell *cells;
+    unsigned int value;
+    int gridIndex;
+    int cellIndex;
+
+    if (gridCount < lanes)
+    {
+        memset(block, 0, (size_t)CELLS * lanes);
+    }
+    for (gridIndex = 0; gridIndex < gridCount; gridIndex++)
+    {
+        cells = grids[gridIndex]->cells;
+        for (cellIndex = 0; cellIndex < CELLS; cellIndex++)
+        {
+            value = (unsigned int)cells[cellIndex];
+            block[cellIndex * lanes + gridIndex] =
+                (unsigned char)(value <= 9 ? value : 15);
+        }
+    }
+}
+
+/****************************** checkBlockSsse3 *********************************
+ * static unsigned int checkBlockSsse3(const unsigned char block[]);
+ * Purpose:
+ *     Checks the 16 grids of a transposed block.
+ * Parameters:
+ *     I    block[]     CELLS * 16 bytes, see transposeBlock
+ * Returns
+ *     Bit n set when grid n is a correct solution.
+ *******************************************************************************/
+__attribute__((target("ssse3")))
+static unsigned int checkBlockSsse3(const unsigned char block[])
+{
+    // Digit bits 0-7 and 8-9 of each value, looked up by pshufb
+    const __m128i lowTable = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+            0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i highTable = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0,
+            1, 2, 0, 0, 0, 0, 0, 0);
+    const __m128i lowDigits = _mm_set1_epi8((char)(ALLNINE & 0xFF));
+    const __m128i highDigits = _mm_set1_epi8((char)(ALLNINE >> 8));
+    __m128i columnLow[SIZE];
+    __m128i columnHigh[SIZE];
+    __m128i regionLow[SIZE];
+    __m128i regionHigh[SIZE];
+    __m128i rowLow;
+    __m128i rowHigh;
+    __m128i cell;
+    __m128i low;
+    __m128i high;
+    __m128i correct = _mm_set1_epi8(-1);
+    int rowIndex;
+    int columnIndex;
+    int regionIndex;
+
+    for (columnIndex = 0; columnIndex < SIZE; columnIndex++)
+    {
+        columnLow[columnIndex] = columnHigh[columnIndex] = _mm_setzero_si128();
+        regionLow[columnIndex] = regionHigh[columnIndex] = _mm_setzero_si128();
+    }
+    for (rowIndex = 0; rowIndex < SIZE; rowIndex++)
+    {
+        rowLow = rowHigh = _mm_setzero_si128();
+        for (columnIndex = 0; columnIndex < SIZE; columnIndex++)
+        {
+            cell = _mm_loadu_si128((const __m128i *)
+                    (block + (rowIndex * SIZE + columnIndex) * 16));
+            low = _mm_shuffle_epi8(lowTable, cell);
+            high = _mm_shuffle_epi8(highTable, cell);
+            regionIndex = REGIONINDEX(rowIndex, columnIndex, ORDER);
+            rowLow = _mm_or_si128(rowLow, low);
+            rowHigh = _mm_or_si128(rowHigh, high);
+            columnLow[columnIndex] = _mm_or_si128(columnLow[columnIndex], low);
+            columnHigh[columnIndex] =
+                _mm_or_si128(columnHigh[columnIndex], high);
+            regionLow[regionIndex] = _mm_or_si128(regionLow[regionIndex], low);
+            regionHigh[regionIndex] =
+                _mm_or_si128(regionHigh[regionIndex], high);
+        }
+        correct = _mm_and_si128(correct, _mm_and_si128(
+                    _mm_cmpeq_epi8(rowLow, lowDigits),
+                    _mm_cmpeq_epi8(rowHigh, highDigits)));
+    }
+    for (columnIndex = 0; columnIndex < SIZE; columnIndex++)
+    {
+        correct = _mm_and_si128(correct, _mm_and_si128(
+                    _mm_cmpeq_epi8(columnLow[columnIndex], lowDigits),
+                    _mm_cmpeq_epi8(columnHigh[columnIndex], highDigits)));
+        correct = _mm_and_si128(correct, _mm_and_si128(
+                    _mm_cmpeq_epi8(regionLow[columnIndex], lowDigits),
+                    _mm_cmpeq_epi8(regionHigh[columnIndex], highDigits)));
+    }
+    return (unsigned int)_mm_movemask_epi8(correct);
+}
+
+/****************************** checkBlockAvx2 **********************************
+ * static unsigned int checkBlockAvx2(const unsigned char block[]);
+ * Purpose:
+ *     Checks the 32 grids of a transposed block.
+ * Parameters:
+ *     I    block[]     CELLS * 32 bytes, see transposeBlock
+ * Returns
+ *     Bit n set when grid n is a correct solution.
+ *******************************************************************************/
+__attribute__((target("avx2")))
+static unsigned int checkBlockAvx2(const unsigned char block[])
+{
+    // vpshufb looks up within each 128 bit half, so both halves hold a table
+    const __m256i lowTable = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, -128,
+            0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i highTable = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0,
+            1, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            1, 2, 0, 0, 0, 0, 0, 0);
+    const __m256i lowDigits = _mm256_set1_epi8((char)(ALLNINE & 0xFF));
+    const __m256i highDigits = _mm256_set1_epi8((char)(ALLNINE >> 8));
+    __m256i columnLow[SIZE];
+    __m256i columnHigh[SIZE];
+    __m256i regionLow[SIZE];
+    __m256i regionHigh[SIZE];
+    __m256i rowLow;
+    __m256i rowHigh;
+    __m256i cell;
+    __m256i low;
+    __m256i high;
+    __m256i correct = _mm256_set1_epi8(-1);
+    int rowIndex;
+    int columnIndex;
+    int regionIndex;
+
+    for (columnIndex = 0; columnIndex < SIZE; columnIndex++)
+    {
+        columnLow[columnIndex] = columnHigh[columnIndex] =
+            _mm256_setzero_si256();
+        regionLow[columnIndex] = regionHigh[columnIndex] =
+            _mm256_setzero_si256();
+    }
+    for (rowIndex = 0; rowIndex < SIZE; rowIndex++)
+    {
+        rowLow = rowHigh = _mm256_setzero_si256();
+        for (columnIndex = 0; columnIndex < SIZE; columnIndex++)
+        {
+            cell = _mm256_loadu_si256((const __m256i *)
+                    (block + (rowIndex * SIZE + columnIndex) * 32));
+            low = _mm256_shuffle_epi8(lowTable, cell);
+            high = _mm256_shuffle_epi8(highTable, cell);
+            regionIndex = REGIONINDEX(rowIndex, columnIndex, ORDER);
+            rowLow = _mm256_or_si256(rowLow, low);
+            rowHigh = _mm256_or_si256(rowHigh, high);
+            columnLow[columnIndex] =
+                _mm256_or_si256(columnLow[columnIndex], low);
+            columnHigh[columnIndex] =
+                _mm256_or_si256(columnHigh[columnIndex], high);
+            regionLow[regionIndex] =
+                _mm256_or_si256(regionLow[regionIndex], low);
+            regionHigh[regionIndex] =
+                _mm256_or_si256(regionHigh[regionIndex], high);
+        }
+        correct = _mm256_and_si256(correct, _mm256_and_si256(
+                    _mm256_cmpeq_epi8(rowLow, lowDigits),
+                    _mm256_cmpeq_epi8(rowHigh, highDigits)));
+    }
+    for (columnIndex = 0; columnIndex < SIZE; columnIndex++)
+    {
+        correct = _mm256_and_si256(correct, _mm256_and_si256(
+                    _mm256_cmpeq_epi8(columnLow[columnIndex], lowDigits),
+                    _mm256_cmpeq_epi8(columnHigh[columnIndex], highDigits)));
+        correct = _mm256_and_si256(correct, _mm256_and_si256(
+                    _mm256_cmpeq_epi8(regionLow[columnIndex], lowDigits),
+                    _mm256_cmpeq_epi8(regionHigh[columnIndex], highDigits)));
+    }
+    return (unsigned int)_mm256_movemask_epi8(correct);
+}
+
+/****************************** checkSudokuGridsVector **************************
+ * static void checkSudokuGridsVector(const SudokuGrid *const grids[],
+ *         int gridCount, unsigned char results[], int lanes,
+ *         unsigned int (*checkBlock)(const unsigned char []));
+ * Purpose:
+ *     Checks the grids a block of lanes grids at a time.
+ * Parameters:
+ *     I    grids[]     grids to check
+ *     I    gridCount   number of grids
+ *     O    results[]   1 for a correct solution, else 0, per grid
+ *     I    lanes       grids per block, 16 or 32
+ *     I    checkBlock  kernel checking one transposed block
+ *******************************************************************************/
+static void checkSudokuGridsVector(const SudokuGrid *const grids[],
+        int gridCount, unsigned char results[], int lanes,
+        unsigned int (*checkBlock)(const unsigned char []))
+{
+    unsigned char block[CELLS * 32] __attribute__((aligned(32)));
+    unsigned int passed;
+    int blockStart;
+    int blockCount;
+    int gridIndex;
+
+    for (blockStart = 0; blockStart < gridCount; blockStart += lanes)
+    {
+        blockCount = gridCount - blockStart;
+        if (blockCount > lanes)
+        {
+            blockCount = lanes;
+        }
+        transposeBlock(grids + blockStart, blockCount, lanes, block);
+        passed = checkBlock(block);
+        for (gridIndex = 0; gridIndex < blockCount; gridIndex++)
+        {
+            results[blockStart + gridIndex] =
+                (unsigned char)((passed >> gridIndex) & 1);
+        }
+    }
+}
+
+#endif // SIMD_X86
+
+/****************************** simdLevel ***************************************
+ * int simdLevel(void);
+ * Purpose:
+ *     Reports the fastest kernel the host CPU supports.
+ * Returns
+ *     SIMD_AVX2, SIMD_SSSE3 or SIMD_SCALAR
+ *******************************************************************************/
+int simdLevel(void)
+{
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return SIMD_AVX2;
+    }
+    if (__builtin_cpu_supports("ssse3"))
+    {
+        return SIMD_SSSE3;
+    }
+#endif
+    return SIMD_SCALAR;
+}
+
+/****************************** checkSudokuGridsLevel ***************************
+ * void checkSudokuGridsLevel(int level, const SudokuGrid *const grids[],
+ *         int gridCount, unsigned char results[]);
+ * Purpose:
+ *     Checks many grids with the kernel of the given level.
+ * Parameters:
+ *     I    level       SIMD_AVX2, SIMD_SSSE3 or SIMD_SCALAR; must not exceed
+ *                      simdLevel()
+ *     I    grids[]     grids to check
+ *     I    gridCount   number of grids
+ *     O    results[]   1 for a correct solution, else 0, per grid
+ *******************************************************************************/
+void checkSudokuGridsLevel(int level, const SudokuGrid *const grids[],
+        int gridCount, unsigned char results[])
+{
+#ifdef SIMD_X86
+    int gridIndex;
+
+    // The vector kernels only know the classic geometry
+    for (gridIndex = 0; gridIndex < gridCount; gridIndex++)
+    {
+        if (grids[gridIndex]->order != ORDER)
+        {
+            level = SIMD_SCALAR;
+            break;
+        }
+    }
+    if (level == SIMD_AVX2 && gridCount >= 16)
+    {
+        checkSudokuGridsVector(grids, gridCount, results, 32, checkBlockAvx2);
+        return;
+    }
+    if (level >= SIMD_SSSE3 && gridCount >= 8)
+    {
+        checkSudokuGridsVector(grids, gridCount, results, 16, checkBlockSsse3);
+        return;
+    }
+#else
+    (void)level;
+#endif
+    checkSudokuGridsScalar(grids, gridCount, results);
+}
+
+/****************************** checkSudokuGrids ********************************
+ * void checkSudokuGrids(const SudokuGrid *const grids[], int gridCount,
+ *         unsigned char results[]);
+ * Purpose:
+ *     Checks many grids with the fastest kernel the host CPU supports.
+ * Parameters:
+ *     I    grids[]     grids to check
+ *     I    gridCount   number of grids
+ *     O    results[]   1 for a correct solution, else 0, per grid
+ *******************************************************************************/
+void checkSudokuGrids(const SudokuGrid *const grids[], int gridCount,
+        unsigned char results[])
+{
+    static int hostLevel = -1; // looked up on first use by any thread
+    int level = __atomic_load_n(&hostLevel, __ATOMIC_RELAXED);
+
+    if (level < 0)
+    {
+        level = simdLevel();
+        __atomic_store_n(&hostLevel, level, __ATOMIC_RELAXED);
+    }
+    checkSudokuGridsLevel(level, grids, gridCount, results);
+}
@@ -0,0 +1,25 @@
+/*******************************************************************************
+ * sudokuSimd.h by Geoffrey Sessums
+ * Purpose:
+ *   Prototypes for checking many sudoku solutions at once, with vector
+ *   kernels selected at run time from the instruction sets of the host CPU.
+ *   The vector kernels cover classic 9x9 grids.
+ * Notes:
+ *   Requires sudokuChecker.h
+ *******************************************************************************/
+#ifndef SUDOKUSIMD_H
+#define SUDOKUSIMD_H
+
+// Kernel levels, from slowest to fastest
+#define SIMD_SCALAR 0
+#define SIMD_SSSE3 1
+#define SIMD_AVX2 2
+
+// Prototypes
+int simdLevel(void);
+void checkSudokuGrids(const SudokuGrid *const grids[], int gridCount,
+        unsigned char results[]);
+void checkSudokuGridsLevel(int level, const SudokuGrid *const grids[],
+        int gridCount, unsigned char results[]);
+
+#endif
@@ -0,0 +1,549 @@
+/*******************************************************************************
+ * sudokuSolver.c by Geoffrey Sessums
+ * Purpose:
+ *  Solves a sudoku puzzle. Candidates come from the occupancy masks of
+ *  sudokuCandidates.h, updated as cells are filled and emptied; naked
+ *  and hidden singles are filled in by constraint propagation, and when
+ *  propagation stalls the search branches on the empty cell with the
+ *  fewest candidates.
+ * Notes:
+ *  Cells placed along the way are pushed on a trail. A failed branch is
+ *  undone by popping the trail back to where the branch started, so the
+ *  search never copies its state. The search keeps its own stack of
+ *  branching points instead of recursing, so it can be written once as an
+ *  inline routine and specialized for every box order.
+ *  The same search counts solutions: it backtracks past each solution
+ *  until the limit is reached. prepareSearch() and searchBranch() split a
+ *  count at its first branching point so branches can run on separate
+ *  threads (see sudokuCount.c). A search given a split flag also hands
+ *  its untried branches to donate() whenever the flag is set, so idle
+ *  threads can take them over (see sudokuSteal.c).
+ ******************************************************************************/
+
+// Header
+#include <string.h>
+#include "sudokuChecker.h"
+#include "sudokuCandidates.h"
+#include "sudokuSolver.h"
+
+/****************************** unitCell ****************************************
+ * int unitCell(int unitIndex, int position, int order);
+ * Purpose:
+ *     Maps a position within a unit to a cell index. Units 0 thru size-1
+ *     are the rows, then the columns, then the regions.
+ * Parameters:
+ *     I    unitIndex   unit, 0 thru 3 * size - 1
+ *     I    position    position within the unit, 0 thru size - 1
+ *     I    order       box order
+ * Returns
+ *     Cell index, row * size + column
+ *******************************************************************************/
+SUDOKU_INLINE int unitCell(int unitIndex, int position, int order)
+{
+    const int size = order * order;
+    int regionIndex;
+
+    if (unitIndex < size)
+    {
+        return unitIndex * size + position;
+    }
+    if (unitIndex < 2 * size)
+    {
+        return position * size + unitIndex - size;
+    }
+    regionIndex = unitIndex - 2 * size;
+    return ((regionIndex / order) * order + position / order) * size
+        + (regionIndex % order) * order + position % order;
+}
+
+/****************************** cellCandidates **********************************
+ * DigitMask cellCandidates(const SolverState *state, int cellIndex,
+ *         int order);
+ * Purpose:
+ *     Digits not yet used in the row, column or region of a cell.
+ *******************************************************************************/
+SUDOKU_INLINE DigitMask cellCandidates(const SolverState *state,
+        int cellIndex, int order)
+{
+    const int size = order * order;
+
+    return candidatesAt(&state->masks, cellIndex / size, cellIndex % size,
+            order);
+}
+
+/****************************** placeDigit **************************************
+ * void placeDigit(SolverState *state, int cellIndex, int value, int order);
+ * Purpose:
+ *     Fills a cell and pushes it on the trail.
+ *******************************************************************************/
+SUDOKU_INLINE void placeDigit(SolverState *state, int cellIndex, int value,
+        int order)
+{
+    const int size = order * order;
+
+    state->cells[cellIndex] = (unsigned char)value;
+    fillCandidate(&state->masks, cellIndex / size, cellIndex % size, order,
+            value);
+    state->trail[state->trailLength++] = (unsigned short)cellIndex;
+}
+
+/****************************** undoTo ******************************************
+ * void undoTo(SolverState *state, int trailLength, int order);
+ * Purpose:
+ *     Empties the cells placed since the trail had trailLength entries.
+ *******************************************************************************/
+SUDOKU_INLINE void undoTo(SolverState *state, int trailLength, int order)
+{
+    const int size = order * order;
+    int cellIndex;
+
+    while (state->trailLength > trailLength)
+    {
+        cellIndex = state->trail[--state->trailLength];
+        clearCandidate(&state->masks, cellIndex / size, cellIndex % size,
+                order, state->cells[cellIndex]);
+        state->cells[cellIndex] = 0;
+    }
+}
+
+/****************************** propagate ***************************************
+ * int propagate(SolverState *state, int order);
+ * Purpose:
+ *     Fills naked singles (cells with one candidate) and hidden singles
+ *     (digits with one possible cell in a unit) until neither is left.
+ * Returns
+ *     0    contradiction: a cell or a digit of some unit has no place
+ *     1    no contradiction found
+ *******************************************************************************/
+SUDOKU_INLINE int propagate(SolverState *state, int order)
+{
+    const int size = order * order;
+    DigitMask candidates;
+    DigitMask once;
+    DigitMask twice;
+    DigitMask used;
+    DigitMask hidden;
+    int cellIndex;
+    int unitIndex;
+    int position;
+    int changed = 1;
+
+    while (changed)
+    {
+        changed = 0;
+        // Naked singles
+        for (cellIndex = 0; cellIndex < size * size; cellIndex++)
+        {
+            if (state->cells[cellIndex] != 0)
+            {
+                continue;
+            }
+            candidates = cellCandidates(state, cellIndex, order);
+            if (candidates == 0)
+            {
+                return 0;
+            }
+            if ((candidates & (candidates - 1)) == 0)
+            {
+                placeDigit(state, cellIndex, __builtin_ctzll(candidates),
+                        order);
+                changed = 1;
+            }
+        }
+        // Hidden singles
+        for (unitIndex = 0; unitIndex < 3 * size; unitIndex++)
+        {
+            once = 0;
+            twice = 0;
+            used = 0;
+            for (position = 0; position < size; position++)
+            {
+                cellIndex = unitCell(unitIndex, position, order);
+                if (state->cells[cellIndex] != 0)
+                {
+                    used |= DIGITBIT(state->cells[cellIndex]);
+                    continue;
+                }
+                candidates = cellCandidates(state, cellIndex, order);
+                twice |= once & candidates;
+                once |= candidates;
+            }
+            if ((once | used) != ALLDIGITS(size))
+            {
+                return 0; // a missing digit fits nowhere in this unit
+            }
+            hidden = once & ~twice;
+            for (position = 0; hidden != 0 && position < size; position++)
+            {
+                cellIndex = unitCell(unitIndex, position, order);
+                if (state->cells[cellIndex] != 0)
+                {
+                    continue;
+                }
+                candidates = cellCandidates(state, cellIndex, order) & hidden;
+                if (candidates != 0)
+                {
+                    // Two hidden singles in one cell is a contradiction
+                    if ((candidates & (candidates - 1)) != 0)
+                    {
+                        return 0;
+                    }
+                    placeDigit(state, cellIndex, __builtin_ctzll(candidates),
+                            order);
+                    hidden &= ~candidates;
+                    changed = 1;
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+/****************************** pickCell ****************************************
+ * int pickCell(const SolverState *state, DigitMask *candidates, int order);
+ * Purpose:
+ *     Finds the empty cell with the fewest candidates (minimum remaining
+ *     values).
+ * Parameters:
+ *     I    state       search state after propagation
+ *     O    candidates  candidates of the cell found
+ *     I    order       box order
+ * Returns
+ *     Cell index, or -1 when no cell is empty
+ *******************************************************************************/
+SUDOKU_INLINE int pickCell(const SolverState *state, DigitMask *candidates,
+        int order)
+{
+    const int size = order * order;
+    int bestCell = -1;
+    int bestCount = size + 1;
+    int count;
+    int cellIndex;
+    DigitMask cellMask;
+
+    // Propagation leaves no singles, so two candidates is the best possible
+    for (cellIndex = 0; cellIndex < size * size && bestCount > 2; cellIndex++)
+    {
+        if (state->cells[cellIndex] == 0)
+        {
+            cellMask = cellCandidates(state, cellIndex, order);
+            count = __builtin_popcountll(cellMask);
+            if (count < bestCount)
+            {
+                bestCount = count;
+                bestCell = cellIndex;
+                *candidates = cellMask;
+            }
+        }
+    }
+    return bestCell;
+}
+
+/****************************** searchOrder *************************************
+ * long searchOrder(SolverState *state, const int order, const long limit);
+ * Purpose:
+ *     Propagates, then branches on the empty cell with the fewest
+ *     candidates, backtracking through the stack of branching points, until
+ *     limit solutions are found or every branch has been tried.
+ * Parameters:
+ *     I/O  state       search state holding the given values
+ *     I    order       box order, a constant in every instance
+ *     I    limit       solutions wanted, at least 1; a constant 1 when
+ *                      solving
+ * Returns
+ *     Number of solutions found, 0 thru limit. With limit 1 the solution is
+ *     left in state->cells; otherwise the first one is in state->solution.
+ * Notes:
+ *     The search also ends early once *state->stop is set, and calls
+ *     state->donate() before every branch while *state->split is set.
+ *     donate() may clear the remaining digits of any branching point.
+ *******************************************************************************/
+SUDOKU_INLINE long searchOrder(SolverState *state, const int order,
+        const long limit)
+{
+    SolverFrame *frame;
+    DigitMask candidates = 0;
+    long solutionCount = 0;
+    int cellIndex;
+    int value;
+
+    state->depth = 0;
+    if (!propagate(state, order))
+    {
+        return 0;
+    }
+    for (;;)
+    {
+        cellIndex = pickCell(state, &candidates, order);
+        if (cellIndex < 0)
+        {
+            // No empty cells left: one more solution
+            if (++solutionCount == 1 && limit > 1)
+            {
+                memcpy(state->solution, state->cells, order * order * order
+                        * order);
+            }
+            if (solutionCount == limit || state->depth == 0)
+            {
+                return solutionCount;
+            }
+        } else
+        {
+            frame = &state->stack[state->depth++];
+            frame->cell = (unsigned short)cellIndex;
+            frame->trailMark = (unsigned short)state->trailLength;
+            frame->remaining = candidates;
+        }
+
+        // Try the next candidate of the deepest branching point
+        for (;;)
+        {
+            frame = &state->stack[state->depth - 1];
+            undoTo(state, frame->trailMark, order);
+            if (state->split != NULL
+                    && __atomic_load_n(state->split, __ATOMIC_RELAXED))
+            {
+                state->donate(state, state->context);
+            }
+            if (frame->remaining == 0
+                    || (state->stop != NULL
+                        && __atomic_load_n(state->stop, __ATOMIC_RELAXED)))
+            {
+                if (--state->depth == 0)
+                {
+                    return solutionCount; // every branch tried
+                }
+                continue;
+            }
+            value = __builtin_ctzll(frame->remaining);
+            frame->remaining &= frame->remaining - 1;
+            state->nodes++;
+            placeDigit(state, frame->cell, value, order);
+            if (propagate(state, order))
+            {
+                break;
+            }
+        }
+    }
+}
+
+/****************************** loadOrder ***************************************
+ * int loadOrder(SolverState *state, const SudokuGrid *grid, const int order);
+ * Purpose:
+ *     Sets up a search state holding the given values of a puzzle.
+ * Returns
+ *     0    a given value is out of range or breaks the rules
+ *     1    state ready to search
+ *******************************************************************************/
+SUDOKU_INLINE int loadOrder(SolverState *state, const SudokuGrid *grid,
+        const int order)
+{
+    const int size = order * order;
+    int cellIndex;
+    int value;
+
+    for (cellIndex = 0; cellIndex < size; cellIndex++)
+    {
+        state->masks.rowMask[cellIndex] = 0;
+        state->masks.columnMask[cellIndex] = 0;
+        state->masks.regionMask[cellIndex] = 0;
+    }
+    state->order = order;
+    state->trailLength = 0;
+    state->nodes = 0;
+    state->stop = NULL;
+    state->split = NULL;
+    for (cellIndex = 0; cellIndex < size * size; cellIndex++)
+    {
+        state->cells[cellIndex] = 0;
+    }
+    for (cellIndex = 0; cellIndex < size * size; cellIndex++)
+    {
+        value = grid->cells[cellIndex];
+        if (value == 0)
+        {
+            continue;
+        }
+        if (value < 1 || value > size
+                || (cellCandidates(state, cellIndex, order)
+                    & DIGITBIT(value)) == 0)
+        {
+            return 0;
+        }
+        placeDigit(state, cellIndex, value, order);
+    }
+    return 1;
+}
+
+// solveSudoku2 thru solveSudoku6
+#define SPECIALIZE_SOLVE(order) \
+    SUDOKU_CLONES \
+    static int solveSudoku##order(SolverState *state, SudokuGrid *grid) \
+    { \
+        int cellIndex; \
+        if (!loadOrder(state, grid, order) \
+                || searchOrder(state, order, 1) != 1) \
+        { \
+            return SOLVE_NONE; \
+        } \
+        for (cellIndex = 0; cellIndex < order * order * order * order; \
+                cellIndex++) \
+        { \
+            grid->cells[cellIndex] = state->cells[cellIndex]; \
+        } \
+        return SOLVE_SOLVED; \
+    }
+SPECIALIZE_ORDERS(SPECIALIZE_SOLVE)
+
+/****************************** solveSudoku *************************************
+ * int solveSudoku(SudokuGrid *grid);
+ * Purpose:
+ *     Solves a sudoku puzzle in place.
+ * Parameters:
+ *     I/O  grid        puzzle, zero for empty cells; holds the solution on
+ *                      success, else is unchanged
+ * Returns
+ *     SOLVE_NONE       the puzzle has no solution (including puzzles whose
+ *                      given values already break the rules)
+ *     SOLVE_SOLVED     the puzzle was solved
+ *******************************************************************************/
+int solveSudoku(SudokuGrid *grid)
+{
+    long nodes;
+
+    return solveSudokuNodes(grid, &nodes);
+}
+
+/****************************** solveSudokuNodes ********************************
+ * int solveSudokuNodes(SudokuGrid *grid, long *nodes);
+ * Purpose:
+ *     Solves a sudoku puzzle in place, as solveSudoku(), and tells how
+ *     much searching it took.
+ * Parameters:
+ *     I/O  grid        puzzle, zero for empty cells; holds the solution on
+ *                      success, else is unchanged
+ *     O    nodes       branches tried by the search
+ * Returns
+ *     SOLVE_NONE or SOLVE_SOLVED
+ *******************************************************************************/
+int solveSudokuNodes(SudokuGrid *grid, long *nodes)
+{
+    static int (*const solveTable[MAXORDER + 1])(SolverState *,
+            SudokuGrid *) = ORDERTABLE(solveSudoku);
+    SolverState state;
+    int result;
+
+    state.nodes = 0;
+    result = solveTable[grid->order](&state, grid);
+    *nodes = state.nodes;
+    return result;
+}
+
+// prepareSearch2 thru prepareSearch6
+#define SPECIALIZE_PREPARE(order) \
+    SUDOKU_CLONES \
+    static int prepareSearch##order(SolverState *state, \
+            const SudokuGrid *grid, DigitMask *candidates) \
+    { \
+        if (!loadOrder(state, grid, order) || !propagate(state, order)) \
+        { \
+            return SEARCH_NONE; \
+        } \
+        return pickCell(state, candidates, order); \
+    }
+SPECIALIZE_ORDERS(SPECIALIZE_PREPARE)
+
+/****************************** prepareSearch ***********************************
+ * int prepareSearch(SolverState *state, const SudokuGrid *grid,
+ *         DigitMask *candidates);
+ * Purpose:
+ *     Loads a puzzle and propagates it, stopping at the first branching
+ *     point so its branches can be searched separately.
+ * Parameters:
+ *     O    state       search state after propagation
+ *     I    grid        puzzle, zero for empty cells
+ *     O    candidates  digits to try in the cell returned
+ * Returns
+ *     Cell to branch on, or
+ *     SEARCH_NONE      the puzzle has no solution
+ *     SEARCH_SOLVED    propagation alone solved it, into state->cells
+ *******************************************************************************/
+int prepareSearch(SolverState *state, const SudokuGrid *grid,
+        DigitMask *candidates)
+{
+    static int (*const prepareTable[MAXORDER + 1])(SolverState *,
+            const SudokuGrid *, DigitMask *) = ORDERTABLE(prepareSearch);
+
+    return prepareTable[grid->order](state, grid, candidates);
+}
+
+// searchBranch2 thru searchBranch6
+#define SPECIALIZE_BRANCH(order) \
+    SUDOKU_CLONES \
+    static long searchBranch##order(SolverState *state, int cellIndex, \
+            int value, long limit) \
+    { \
+        state->nodes++; \
+        placeDigit(state, cellIndex, value, order); \
+        return searchOrder(state, order, limit); \
+    }
+SPECIALIZE_ORDERS(SPECIALIZE_BRANCH)
+
+/****************************** searchBranch ************************************
+ * long searchBranch(SolverState *state, int cellIndex, int value,
+ *         long limit);
+ * Purpose:
+ *     Counts the solutions of one branch of a prepared search.
+ * Parameters:
+ *     I/O  state       copy of the state left by prepareSearch()
+ *     I    cellIndex   cell returned by prepareSearch()
+ *     I    value       one of its candidates
+ *     I    limit       stop after this many solutions, at least 2
+ * Returns
+ *     Solutions found, 0 thru limit; the first is in state->solution
+ *******************************************************************************/
+long searchBranch(SolverState *state, int cellIndex, int value, long limit)
+{
+    static long (*const branchTable[MAXORDER + 1])(SolverState *, int, int,
+            long) = ORDERTABLE(searchBranch);
+
+    return branchTable[state->order](state, cellIndex, value, limit);
+}
+
+// countSolutions2 thru countSolutions6
+#define SPECIALIZE_COUNT(order) \
+    SUDOKU_CLONES \
+    static long countSolutions##order(SolverState *state, \
+            const SudokuGrid *grid, long limit) \
+    { \
+        if (!loadOrder(state, grid, order)) \
+        { \
+            return 0; \
+        } \
+        return searchOrder(state, order, limit); \
+    }
+SPECIALIZE_ORDERS(SPECIALIZE_COUNT)
+
+/****************************** countSolutions **********************************
+ * long countSolutions(const SudokuGrid *grid, long limit, long *nodes);
+ * Purpose:
+ *     Counts the solutions of a puzzle, stopping once limit are found.
+ * Parameters:
+ *     I    grid        puzzle, zero for empty cells
+ *     I    limit       solutions wanted, at least 1 (2 proves uniqueness,
+ *                      1 tells whether there is any)
+ *     O    nodes       branches tried by the search
+ * Returns
+ *     Number of solutions, 0 thru limit
+ *******************************************************************************/
+long countSolutions(const SudokuGrid *grid, long limit, long *nodes)
+{
+    static long (*const countTable[MAXORDER + 1])(SolverState *,
+            const SudokuGrid *, long) = ORDERTABLE(countSolutions);
+    SolverState state;
+    long solutionCount;
+
+    solutionCount = countTable[grid->order](&state, grid, limit);
+    *nodes = state.nodes;
+    return solutionCount;
+}
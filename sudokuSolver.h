@@ -0,0 +1,56 @@
+/*******************************************************************************
+ * sudokuSolver.h by Geoffrey Sessums
+ * Purpose:
+ *   Defines the solver state and return codes.
+ *   Prototypes
+ * Notes:
+ *   Requires sudokuChecker.h and sudokuCandidates.h
+ *******************************************************************************/
+#ifndef SUDOKUSOLVER_H
+#define SUDOKUSOLVER_H
+
+// Return codes
+#define SOLVE_NONE 0
+#define SOLVE_SOLVED 1
+#define SEARCH_NONE -2      // prepareSearch(): no solution
+#define SEARCH_SOLVED -1    // prepareSearch(): no empty cell left
+
+// One branching point of the search
+typedef struct
+{
+    unsigned short cell;        // cell being tried
+    unsigned short trailMark;   // trail length before the cell was filled
+    DigitMask remaining;        // digits not tried yet
+} SolverFrame;
+
+// Search state: cell values, digit masks, the trail of placed cells and
+// the stack of branching points
+typedef struct SolverState
+{
+    unsigned char cells[MAXCELLS];
+    CandidateMasks masks;
+    unsigned short trail[MAXCELLS]; // cells placed, in order, for undoing
+    int trailLength;
+    SolverFrame stack[MAXCELLS];
+    int depth;
+    int order;
+    long nodes;                     // branches tried
+    const int *stop;                // ends the search once set, or NULL
+    const int *split;               // calls donate() while set, or NULL
+    void (*donate)(struct SolverState *state, void *context);
+    void *context;                  // passed to donate()
+    unsigned char solution[MAXCELLS]; // first solution when counting
+} SolverState;
+
+// Prototypes
+int solveSudoku(SudokuGrid *grid);
+int solveSudokuNodes(SudokuGrid *grid, long *nodes);
+long countSolutions(const SudokuGrid *grid, long limit, long *nodes);
+int prepareSearch(SolverState *state, const SudokuGrid *grid,
+        DigitMask *candidates);
+long searchBranch(SolverState *state, int cellIndex, int value, long limit);
+long countSudoku(const SudokuGrid *grid, long limit, int threadCount,
+        long *nodes);
+int solveSudokuParallel(SudokuGrid *grid, int threadCount, long *nodes);
+
+#endif
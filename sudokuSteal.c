@@ -0,0 +1,498 @@
+/*******************************************************************************
+ * sudokuSteal.c by Geoffrey Sessums
+ * Purpose:
+ *  Solves one hard or large puzzle on several threads. The search tree is
+ *  split into subproblems, each a propagated grid, the empty cell it
+ *  branches on and the candidates of that cell not tried yet, i.e. the
+ *  possible values option L lists for it. Every thread owns a deque of
+ *  subproblems: it takes its own newest one, and once its deque runs dry
+ *  it steals the oldest, largest subproblem of another thread.
+ * Notes:
+ *  A thread only splits its search while some thread is idle and its own
+ *  deque is empty: it then hands over the untried digits of its
+ *  shallowest branching point, so a busy search costs one flag test per
+ *  branch.
+ *  The result is the solution the single threaded solver finds, whatever
+ *  the timing. Every branch is named by the digits chosen on the way to
+ *  it, and the search order of the solver is the order of those paths. A
+ *  solution found on one thread stops the searches and drops the
+ *  subproblems that come after it in that order; those that come before
+ *  it run on, and the first solution in search order wins.
+ *  The deques and the idle count share one lock: a subproblem is moved
+ *  only when a thread runs dry, which is rare next to the nodes searched.
+ ******************************************************************************/
+
+// Header
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "sudokuChecker.h"
+#include "sudokuCandidates.h"
+#include "sudokuSolver.h"
+
+// Subproblems a thread holds at once; it splits only when it holds none
+#define STEAL_DEQUETASKS 4
+
+// One subproblem: a cell of a propagated grid and its untried digits
+typedef struct
+{
+    unsigned char cells[MAXCELLS];
+    unsigned char path[MAXCELLS];   // digits chosen above it, from the root
+    int pathLength;
+    int cell;
+    DigitMask remaining;
+} StealTask;
+
+struct StealPool;
+
+// One thread, its deque and the branch it is searching
+typedef struct
+{
+    struct StealPool *pool;
+    StealTask deque[STEAL_DEQUETASKS];
+    int top;                        // oldest subproblem, stolen first
+    int count;                      // the newest is at top + count - 1
+    StealTask task;                 // subproblem being searched
+    unsigned char path[MAXCELLS];   // branch being searched, from the root
+    int pathLength;
+    int abandon;                    // set once the branch cannot win
+    long nodes;
+} StealWorker;
+
+// Everything shared by the threads of one puzzle
+typedef struct StealPool
+{
+    pthread_mutex_t lock;
+    pthread_cond_t wake;            // a subproblem was pushed, or all done
+    int order;
+    int threadCount;
+    int idleCount;                  // also read by searches without the lock
+    int done;
+    StealWorker *workers;
+    int solved;
+    unsigned char best[MAXCELLS];   // solution first in search order so far
+    unsigned char bestPath[MAXCELLS];
+    int bestPathLength;
+} StealPool;
+
+/****************************** afterBest ***************************************
+ * static int afterBest(const StealPool *pool, const unsigned char path[],
+ *         int pathLength, int next);
+ * Purpose:
+ *     Tells whether a branch comes after the best solution found so far in
+ *     search order, so it cannot hold the winning solution. The caller
+ *     holds the pool lock.
+ * Parameters:
+ *     I    pool        pool of the puzzle
+ *     I    path        digits chosen on the way to the branch
+ *     I    pathLength  number of digits in path
+ *     I    next        one more digit chosen after path, or 0 for none
+ *******************************************************************************/
+static int afterBest(const StealPool *pool, const unsigned char path[],
+        int pathLength, int next)
+{
+    int index;
+
+    if (!pool->solved)
+    {
+        return 0;
+    }
+    for (index = 0; index < pathLength && index < pool->bestPathLength;
+            index++)
+    {
+        if (path[index] != pool->bestPath[index])
+        {
+            return path[index] > pool->bestPath[index];
+        }
+    }
+    // The best solution lies below path: compare the next digit
+    return next != 0 && pathLength < pool->bestPathLength
+        && next > pool->bestPath[pathLength];
+}
+
+/****************************** pushTask ****************************************
+ * static StealTask *pushTask(StealWorker *worker);
+ * Purpose:
+ *     Makes room for a new subproblem at the newest end of a deque. The
+ *     caller holds the pool lock and fills in the subproblem.
+ * Returns
+ *     The subproblem to fill in
+ *******************************************************************************/
+static StealTask *pushTask(StealWorker *worker)
+{
+    StealTask *task =
+        &worker->deque[(worker->top + worker->count) % STEAL_DEQUETASKS];
+
+    __atomic_store_n(&worker->count, worker->count + 1, __ATOMIC_RELAXED);
+    return task;
+}
+
+/****************************** donateBranches **********************************
+ * static void donateBranches(SolverState *state, void *context);
+ * Purpose:
+ *     Hands the untried digits of the shallowest branching point of a
+ *     search to the deque of its thread, for an idle thread to steal.
+ *     Called by the search before every branch while a thread is idle.
+ * Parameters:
+ *     I/O  state       search of the thread; loses the digits handed over
+ *     I/O  context     the StealWorker of the thread
+ *******************************************************************************/
+static void donateBranches(SolverState *state, void *context)
+{
+    StealWorker *worker = context;
+    StealPool *pool = worker->pool;
+    const int cellCount = pool->order * pool->order * pool->order
+        * pool->order;
+    SolverFrame *frame;
+    StealTask *task;
+    int frameIndex;
+    int trailIndex;
+
+    // Work is waiting already, or this search has lost
+    if (__atomic_load_n(&worker->count, __ATOMIC_RELAXED) != 0
+            || __atomic_load_n(&worker->abandon, __ATOMIC_RELAXED))
+    {
+        return;
+    }
+    for (frameIndex = 0; frameIndex < state->depth
+            && state->stack[frameIndex].remaining == 0; frameIndex++)
+    {
+    }
+    if (worker->task.remaining == 0 && frameIndex == state->depth)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    task = pushTask(worker);
+    if (worker->task.remaining != 0)
+    {
+        // The digits of the subproblem itself are shallowest
+        memcpy(task, &worker->task, sizeof(StealTask));
+        worker->task.remaining = 0;
+    } else
+    {
+        // The grid at the branching point: undo every cell placed since
+        frame = &state->stack[frameIndex];
+        memcpy(task->cells, state->cells, cellCount);
+        for (trailIndex = frame->trailMark; trailIndex < state->trailLength;
+                trailIndex++)
+        {
+            task->cells[state->trail[trailIndex]] = 0;
+        }
+        memcpy(task->path, worker->path, worker->pathLength);
+        task->pathLength = worker->pathLength;
+        for (trailIndex = 0; trailIndex < frameIndex; trailIndex++)
+        {
+            task->path[task->pathLength++] =
+                state->cells[state->stack[trailIndex].cell];
+        }
+        task->cell = frame->cell;
+        task->remaining = frame->remaining;
+        frame->remaining = 0;
+    }
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/****************************** takeTask ****************************************
+ * static int takeTask(StealWorker *worker);
+ * Purpose:
+ *     Takes the newest subproblem of the thread's own deque or, failing
+ *     that, steals the oldest of another thread's, skipping those that
+ *     come after the best solution. The caller holds the pool lock.
+ * Returns
+ *     1 when worker->task holds a subproblem to search, else 0
+ *******************************************************************************/
+static int takeTask(StealWorker *worker)
+{
+    StealPool *pool = worker->pool;
+    StealWorker *victim;
+    StealTask *task;
+    int victimIndex;
+
+    while (worker->count > 0)
+    {
+        __atomic_store_n(&worker->count, worker->count - 1, __ATOMIC_RELAXED);
+        task = &worker->deque[(worker->top + worker->count)
+            % STEAL_DEQUETASKS];
+        if (!afterBest(pool, task->path, task->pathLength,
+                    __builtin_ctzll(task->remaining)))
+        {
+            memcpy(&worker->task, task, sizeof(StealTask));
+            return 1;
+        }
+    }
+    for (victimIndex = 1; victimIndex < pool->threadCount; victimIndex++)
+    {
+        victim = &pool->workers[(worker - pool->workers + victimIndex)
+            % pool->threadCount];
+        while (victim->count > 0)
+        {
+            task = &victim->deque[victim->top];
+            victim->top = (victim->top + 1) % STEAL_DEQUETASKS;
+            __atomic_store_n(&victim->count, victim->count - 1,
+                    __ATOMIC_RELAXED);
+            if (!afterBest(pool, task->path, task->pathLength,
+                        __builtin_ctzll(task->remaining)))
+            {
+                memcpy(&worker->task, task, sizeof(StealTask));
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/****************************** keepSolution ************************************
+ * static void keepSolution(StealWorker *worker, const SolverState *state);
+ * Purpose:
+ *     Keeps a solution if it comes first in search order so far, and stops
+ *     the searches of every branch that comes after it.
+ * Parameters:
+ *     I/O  worker      thread that found the solution
+ *     I    state       its search, holding the solution and its path
+ *******************************************************************************/
+static void keepSolution(StealWorker *worker, const SolverState *state)
+{
+    StealPool *pool = worker->pool;
+    unsigned char path[MAXCELLS];
+    int pathLength = worker->pathLength;
+    int index;
+
+    memcpy(path, worker->path, pathLength);
+    for (index = 0; index < state->depth; index++)
+    {
+        path[pathLength++] = state->cells[state->stack[index].cell];
+    }
+    pthread_mutex_lock(&pool->lock);
+    // Paths to two solutions always differ before either ends
+    for (index = 0; pool->solved && path[index] == pool->bestPath[index];
+            index++)
+    {
+    }
+    if (!pool->solved || path[index] < pool->bestPath[index])
+    {
+        memcpy(pool->best, state->cells, pool->order * pool->order
+                * pool->order * pool->order);
+        memcpy(pool->bestPath, path, pathLength);
+        pool->bestPathLength = pathLength;
+        pool->solved = 1;
+    }
+    for (index = 0; index < pool->threadCount; index++)
+    {
+        if (afterBest(pool, pool->workers[index].path,
+                    pool->workers[index].pathLength, 0))
+        {
+            __atomic_store_n(&pool->workers[index].abandon, 1,
+                    __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/****************************** runTask *****************************************
+ * static void runTask(StealWorker *worker, SolverState *state);
+ * Purpose:
+ *     Searches the digits of a subproblem in order until one leads to a
+ *     solution, the rest are handed over, or the subproblem cannot win.
+ * Parameters:
+ *     I/O  worker      thread holding the subproblem in worker->task
+ *     O    state       search state of the thread
+ *******************************************************************************/
+static void runTask(StealWorker *worker, SolverState *state)
+{
+    StealPool *pool = worker->pool;
+    StealTask *task = &worker->task;
+    SudokuGrid grid;
+    DigitMask candidates;
+    int value;
+
+    initGrid(&grid, pool->order, task->cells);
+    while (task->remaining != 0)
+    {
+        value = __builtin_ctzll(task->remaining);
+        task->remaining &= task->remaining - 1;
+
+        pthread_mutex_lock(&pool->lock);
+        memcpy(worker->path, task->path, task->pathLength);
+        worker->path[task->pathLength] = (unsigned char)value;
+        worker->pathLength = task->pathLength + 1;
+        worker->abandon = afterBest(pool, worker->path, worker->pathLength, 0);
+        pthread_mutex_unlock(&pool->lock);
+        if (worker->abandon)
+        {
+            break; // the other digits come later still
+        }
+
+        // The grid was propagated before it was split, so this only loads it
+        prepareSearch(state, &grid, &candidates);
+        state->stop = &worker->abandon;
+        state->split = &pool->idleCount;
+        state->donate = donateBranches;
+        state->context = worker;
+        if (searchBranch(state, task->cell, value, 1) == 1)
+        {
+            keepSolution(worker, state);
+            worker->nodes += state->nodes;
+            break;
+        }
+        worker->nodes += state->nodes;
+    }
+    // Other threads compare paths under the lock in keepSolution()
+    pthread_mutex_lock(&pool->lock);
+    worker->pathLength = 0;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/****************************** stealThread *************************************
+ * static void *stealThread(void *argument);
+ * Purpose:
+ *     Searches subproblems, its own or stolen, until every thread is idle.
+ * Parameters:
+ *     I/O  argument    the StealWorker of the thread
+ *******************************************************************************/
+static void *stealThread(void *argument)
+{
+    StealWorker *worker = argument;
+    StealPool *pool = worker->pool;
+    SolverState *state = malloc(sizeof(SolverState));
+
+    if (state == NULL)
+    {
+        exitError("Out of memory.");
+    }
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->done)
+    {
+        if (takeTask(worker))
+        {
+            pthread_mutex_unlock(&pool->lock);
+            runTask(worker, state);
+            pthread_mutex_lock(&pool->lock);
+            continue;
+        }
+        // Idle with every deque empty: the last thread to get here ends it
+        __atomic_store_n(&pool->idleCount, pool->idleCount + 1,
+                __ATOMIC_RELAXED);
+        if (pool->idleCount == pool->threadCount)
+        {
+            pool->done = 1;
+            pthread_cond_broadcast(&pool->wake);
+            break;
+        }
+        pthread_cond_wait(&pool->wake, &pool->lock);
+        __atomic_store_n(&pool->idleCount, pool->idleCount - 1,
+                __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    free(state);
+    return NULL;
+}
+
+/****************************** solveSudokuParallel *****************************
+ * int solveSudokuParallel(SudokuGrid *grid, int threadCount, long *nodes);
+ * Purpose:
+ *     Solves a sudoku puzzle in place on several threads, giving the same
+ *     solution as solveSudoku().
+ * Parameters:
+ *     I/O  grid            puzzle, zero for empty cells; holds the solution
+ *                          on success, else is unchanged
+ *     I    threadCount     threads to search with, at least 1
+ *     O    nodes           branches tried by all threads
+ * Returns
+ *     SOLVE_NONE or SOLVE_SOLVED
+ * Notes:
+ *     Exits with ERROR_PROCESSING when memory or threads are exhausted.
+ *******************************************************************************/
+int solveSudokuParallel(SudokuGrid *grid, int threadCount, long *nodes)
+{
+    StealPool *pool;
+    StealTask *root;
+    pthread_t *threads;
+    SolverState *base;
+    DigitMask candidates = 0;
+    int threadIndex;
+    int cellIndex;
+    int cell;
+
+    if (threadCount <= 1)
+    {
+        return solveSudokuNodes(grid, nodes);
+    }
+    base = malloc(sizeof(SolverState));
+    pool = malloc(sizeof(StealPool));
+    threads = malloc(sizeof(pthread_t) * threadCount);
+    if (base == NULL || pool == NULL || threads == NULL
+            || (pool->workers = calloc(threadCount, sizeof(StealWorker)))
+            == NULL)
+    {
+        exitError("Out of memory.");
+    }
+    cell = prepareSearch(base, grid, &candidates);
+    *nodes = base->nodes;
+    if (cell < 0)
+    {
+        if (cell == SEARCH_SOLVED)
+        {
+            for (cellIndex = 0; cellIndex < grid->size * grid->size;
+                    cellIndex++)
+            {
+                grid->cells[cellIndex] = base->cells[cellIndex];
+            }
+        }
+        free(pool->workers);
+        free(pool);
+        free(threads);
+        free(base);
+        return cell == SEARCH_SOLVED ? SOLVE_SOLVED : SOLVE_NONE;
+    }
+
+    // The whole puzzle is the first subproblem of the first thread
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pool->order = grid->order;
+    pool->threadCount = threadCount;
+    pool->idleCount = 0;
+    pool->done = 0;
+    pool->solved = 0;
+    pool->bestPathLength = 0;
+    for (threadIndex = 0; threadIndex < threadCount; threadIndex++)
+    {
+        pool->workers[threadIndex].pool = pool;
+    }
+    root = pushTask(&pool->workers[0]);
+    memcpy(root->cells, base->cells, sizeof(root->cells));
+    root->pathLength = 0;
+    root->cell = cell;
+    root->remaining = candidates;
+    free(base);
+
+    for (threadIndex = 0; threadIndex < threadCount; threadIndex++)
+    {
+        if (pthread_create(&threads[threadIndex], NULL, stealThread,
+                    &pool->workers[threadIndex]) != 0)
+        {
+            exitError("Unable to start search thread.");
+        }
+    }
+    for (threadIndex = 0; threadIndex < threadCount; threadIndex++)
+    {
+        pthread_join(threads[threadIndex], NULL);
+        *nodes += pool->workers[threadIndex].nodes;
+    }
+    if (pool->solved)
+    {
+        for (cellIndex = 0; cellIndex < grid->size * grid->size; cellIndex++)
+        {
+            grid->cells[cellIndex] = pool->best[cellIndex];
+        }
+    }
+    cell = pool->solved ? SOLVE_SOLVED : SOLVE_NONE;
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool);
+    free(threads);
+    return cell;
+}
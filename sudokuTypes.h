@@ -0,0 +1,52 @@
+/*******************************************************************************
+ * sudokuTypes.h by Geoffrey Sessums
+ * Purpose:
+ *   Defines constants for
+ *       box orders
+ *       rows, columns and cells
+ *       digit masks
+ *   Defines the sudoku grid
+ * Notes:
+ *   A puzzle of box order N has N x N regions and N^2 rows and columns,
+ *   holding the values 1 thru N^2 (9 x 9 for the classic order 3).
+ *   Shared by the programs (through sudokuChecker.h) and by the public
+ *   interface of libsudokuchecker (sudokuLibrary.h), so it holds nothing
+ *   else.
+ *******************************************************************************/
+
+#ifndef SUDOKUTYPES_H
+#define SUDOKUTYPES_H
+
+#include <stdint.h>
+
+// Supported box orders: 4x4 thru 36x36 puzzles
+#define MINORDER 2
+#define MAXORDER 6
+#define DEFAULTORDER 3
+
+// Constants for the largest sudoku puzzle array
+#define MAXSIZE (MAXORDER * MAXORDER)       // rows, columns and values
+#define MAXCELLS (MAXSIZE * MAXSIZE)
+#define MAXUNITS (3 * MAXSIZE)              // rows, columns and regions
+
+// Digit masks: bit n is set when digit n is present in a row, column or region
+typedef uint64_t DigitMask;
+#define DIGITBIT(value) ((DigitMask)1 << (value))
+#define ALLDIGITS(size) ((DIGITBIT(size) - 1) << 1) // digits 1 thru size
+#define REGIONINDEX(row, column, order) \
+    (((row) / (order)) * (order) + (column) / (order))
+
+// One cell value, zero for an empty cell. Values never exceed MAXSIZE, so a
+// byte holds them: a 9x9 grid is 81 bytes and a chunk of batch records
+// stays in L1/L2 cache
+typedef uint8_t SudokuCell;
+
+// A puzzle of box order order; the cells are owned by the caller
+typedef struct
+{
+    int order;          // region size, MINORDER thru MAXORDER
+    int size;           // order * order: rows, columns and largest value
+    SudokuCell *cells;  // size * size values, row by row
+} SudokuGrid;
+
+#endif
@@ -0,0 +1,417 @@
+/*******************************************************************************
+ * sudokuVariant.c by Geoffrey Sessums
+ * Purpose:
+ *  Checks solutions and lists possible values under variant rules, driven
+ *  by a unit table built once from the rules instead of the fixed rows,
+ *  columns and boxes:
+ *      X-Sudoku    both main diagonals also hold every value once
+ *      jigsaw      irregular regions of size cells replace the boxes
+ *      killer      cages of cells hold distinct values adding up to the
+ *                  cage's sum
+ *  Rules combine, e.g. a killer X-Sudoku on a jigsaw layout.
+ * Input:
+ *  A jigsaw layout is the region, 1 thru size, of every cell, row by row,
+ *  in the layout of a puzzle:
+ *      1 1 1 2 2 2 2 3 3 ...
+ *  Killer cages are the cage number of every cell, row by row, 0 for a
+ *  cell in no cage, then the sum of every cage in cage number order. Cage
+ *  numbers run from 1 and are separated by white space at every size:
+ *      1 1 2 2 2 3 4 4 5 ...
+ *      ... 3 15 22 4 16 ...
+ * Notes:
+ *  Classic grids never come here: they keep the specialized checks of
+ *  sudokuGrid.c and sudokuSimd.c. checkUnits() is still specialized per
+ *  order, so its loops over the cells of a unit have constant bounds.
+ ******************************************************************************/
+
+// Header
+#include <string.h>
+#include "sudokuChecker.h"
+#include "sudokuOutput.h"
+#include "sudokuReader.h"
+#include "sudokuVariant.h"
+
+/****************************** indexCellUnits **********************************
+ * static void indexCellUnits(UnitTable *table);
+ * Purpose:
+ *     Lists the units holding every cell, after the units have changed.
+ *******************************************************************************/
+static void indexCellUnits(UnitTable *table)
+{
+    const int size = table->size;
+    int unitIndex;
+    int memberIndex;
+    int cellIndex;
+
+    memset(table->cellUnitCounts, 0, sizeof(table->cellUnitCounts));
+    for (unitIndex = 0; unitIndex < table->unitCount; unitIndex++)
+    {
+        for (memberIndex = 0; memberIndex < size; memberIndex++)
+        {
+            cellIndex = table->units[unitIndex][memberIndex];
+            table->cellUnits[cellIndex][table->cellUnitCounts[cellIndex]++] =
+                (unsigned char)unitIndex;
+        }
+    }
+}
+
+/****************************** initUnitTable ***********************************
+ * void initUnitTable(UnitTable *table, int order);
+ * Purpose:
+ *     Builds the units of the classic rules, rows, columns and boxes, for
+ *     other rules to extend or replace.
+ * Parameters:
+ *     O    table       unit table to initialize
+ *     I    order       box order of the puzzles
+ *******************************************************************************/
+void initUnitTable(UnitTable *table, int order)
+{
+    const int size = order * order;
+    int regionCounts[MAXSIZE] = {0};
+    int regionIndex;
+    int rowIndex;
+    int columnIndex;
+    int cellIndex;
+
+    table->order = order;
+    table->size = size;
+    table->unitCount = 3 * size;
+    for (rowIndex = 0; rowIndex < size; rowIndex++)
+    {
+        for (columnIndex = 0; columnIndex < size; columnIndex++)
+        {
+            cellIndex = rowIndex * size + columnIndex;
+            regionIndex = REGIONINDEX(rowIndex, columnIndex, order);
+            table->units[rowIndex][columnIndex] = cellIndex;
+            table->units[size + columnIndex][rowIndex] = cellIndex;
+            table->units[2 * size + regionIndex][regionCounts[regionIndex]++] =
+                cellIndex;
+            table->cellCages[cellIndex] = -1;
+        }
+    }
+    table->cageCount = 0;
+    table->cageStarts[0] = 0;
+    indexCellUnits(table);
+}
+
+/****************************** addDiagonals ************************************
+ * void addDiagonals(UnitTable *table);
+ * Purpose:
+ *     Adds the two main diagonals as units (X-Sudoku).
+ * Parameters:
+ *     I/O  table       unit table to extend
+ *******************************************************************************/
+void addDiagonals(UnitTable *table)
+{
+    const int size = table->size;
+    int index;
+
+    for (index = 0; index < size; index++)
+    {
+        table->units[table->unitCount][index] = index * size + index;
+        table->units[table->unitCount + 1][index] =
+            index * size + size - 1 - index;
+    }
+    table->unitCount += 2;
+    indexCellUnits(table);
+}
+
+/****************************** readJigsawRegions *******************************
+ * void readJigsawRegions(UnitTable *table, SudokuReader *reader);
+ * Purpose:
+ *     Replaces the boxes by the irregular regions of a jigsaw layout.
+ * Parameters:
+ *     I/O  table       unit table whose regions are replaced
+ *     I/O  reader      reader over the layout
+ * Notes:
+ *     Exits with ERROR_PROCESSING when the layout is malformed or a region
+ *     does not have exactly size cells.
+ *******************************************************************************/
+void readJigsawRegions(UnitTable *table, SudokuReader *reader)
+{
+    const int size = table->size;
+    int regionCounts[MAXSIZE] = {0};
+    int cellIndex;
+    int region;
+
+    for (cellIndex = 0; cellIndex < size * size; cellIndex++)
+    {
+        if (readerNextValue(reader, &region, size) != READER_OK
+                || region < 1)
+        {
+            exitError("Malformed jigsaw layout.");
+        }
+        region--;
+        if (regionCounts[region] == size)
+        {
+            exitError("Every jigsaw region must have size cells.");
+        }
+        table->units[2 * size + region][regionCounts[region]++] = cellIndex;
+    }
+    indexCellUnits(table);
+}
+
+/****************************** readKillerCages *********************************
+ * void readKillerCages(UnitTable *table, SudokuReader *reader);
+ * Purpose:
+ *     Adds the killer cages and their sums.
+ * Parameters:
+ *     I/O  table       unit table to extend
+ *     I/O  reader      reader over the cages
+ * Notes:
+ *     Exits with ERROR_PROCESSING when the cages are malformed, a cage has
+ *     more than size cells, or no distinct values can reach its sum.
+ *******************************************************************************/
+void readKillerCages(UnitTable *table, SudokuReader *reader)
+{
+    const int size = table->size;
+    const int cellCount = size * size;
+    int cageLengths[MAXCAGES + 1] = {0};
+    int cellIndex;
+    int cageIndex;
+    int cage;
+    int length;
+    int sum;
+
+    table->cageCount = 0;
+    for (cellIndex = 0; cellIndex < cellCount; cellIndex++)
+    {
+        if (readerNextValue(reader, &cage, cellCount) != READER_OK)
+        {
+            exitError("Malformed killer cages.");
+        }
+        table->cellCages[cellIndex] = (short)(cage - 1);
+        cageLengths[cage]++;
+        if (cage > table->cageCount)
+        {
+            table->cageCount = cage;
+        }
+    }
+
+    // Cells of each cage, in cell order
+    table->cageStarts[0] = 0;
+    for (cageIndex = 0; cageIndex < table->cageCount; cageIndex++)
+    {
+        length = cageLengths[cageIndex + 1];
+        if (length == 0 || length > size)
+        {
+            exitError("Killer cages must be numbered 1 thru n and have at "
+                    "most size cells.");
+        }
+        table->cageStarts[cageIndex + 1] = table->cageStarts[cageIndex]
+            + length;
+        cageLengths[cageIndex + 1] = table->cageStarts[cageIndex];
+    }
+    for (cellIndex = 0; cellIndex < cellCount; cellIndex++)
+    {
+        cage = table->cellCages[cellIndex] + 1;
+        if (cage > 0)
+        {
+            table->cageCells[cageLengths[cage]++] = cellIndex;
+        }
+    }
+
+    // Sums between 1 + ... + length and size + ... + (size - length + 1)
+    for (cageIndex = 0; cageIndex < table->cageCount; cageIndex++)
+    {
+        length = table->cageStarts[cageIndex + 1] - table->cageStarts[cageIndex];
+        if (readerNextValue(reader, &sum, size * (size + 1) / 2) != READER_OK
+                || sum < length * (length + 1) / 2
+                || sum > length * (2 * size - length + 1) / 2)
+        {
+            exitError("Malformed or impossible killer cage sum.");
+        }
+        table->cageSums[cageIndex] = sum;
+    }
+}
+
+/****************************** checkUnitsOrder *********************************
+ * int checkUnitsOrder(const UnitTable *table, const SudokuCell *cells,
+ *         const int order);
+ * Purpose:
+ *     Checks that every unit holds every value once and that every cage
+ *     holds distinct values adding up to its sum.
+ * Parameters:
+ *     I    table       units and cages of the rules
+ *     I    cells       solution values
+ *     I    order       box order, a constant in every instance
+ * Returns
+ *     0    found error
+ *     1    no errors found
+ *******************************************************************************/
+SUDOKU_INLINE int checkUnitsOrder(const UnitTable *table,
+        const SudokuCell *cells, const int order)
+{
+    const int size = order * order;
+    const unsigned short *unit;
+    DigitMask seen;
+    int unitIndex;
+    int memberIndex;
+    int cageIndex;
+    int sum;
+
+    for (unitIndex = 0; unitIndex < table->unitCount; unitIndex++)
+    {
+        unit = table->units[unitIndex];
+        seen = 0;
+        for (memberIndex = 0; memberIndex < size; memberIndex++)
+        {
+            seen |= DIGITBIT(cells[unit[memberIndex]]);
+        }
+        if (seen != ALLDIGITS(size))
+        {
+            return 0;
+        }
+    }
+    // Every row passed, so every cell holds a value 1 thru size
+    for (cageIndex = 0; cageIndex < table->cageCount; cageIndex++)
+    {
+        seen = 0;
+        sum = 0;
+        for (memberIndex = table->cageStarts[cageIndex];
+                memberIndex < table->cageStarts[cageIndex + 1]; memberIndex++)
+        {
+            seen |= DIGITBIT(cells[table->cageCells[memberIndex]]);
+            sum += cells[table->cageCells[memberIndex]];
+        }
+        if (sum != table->cageSums[cageIndex] || __builtin_popcountll(seen)
+                != table->cageStarts[cageIndex + 1] - table->cageStarts[cageIndex])
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// checkUnits2 thru checkUnits6
+#define SPECIALIZE_CHECK(order) \
+    SUDOKU_CLONES \
+    static int checkUnits##order(const UnitTable *table, \
+            const SudokuCell *cells) \
+    { \
+        return checkUnitsOrder(table, cells, order); \
+    }
+SPECIALIZE_ORDERS(SPECIALIZE_CHECK)
+
+/****************************** checkUnits **************************************
+ * int checkUnits(const UnitTable *table, const SudokuGrid *grid);
+ * Purpose:
+ *     Checks a solution against variant rules.
+ * Parameters:
+ *     I    table       units and cages of the rules, of the grid's order
+ *     I    grid        solution values
+ * Returns
+ *     0    found error
+ *     1    no errors found
+ *******************************************************************************/
+int checkUnits(const UnitTable *table, const SudokuGrid *grid)
+{
+    static int (*const checkTable[MAXORDER + 1])(const UnitTable *,
+            const SudokuCell *) = ORDERTABLE(checkUnits);
+
+    return checkTable[grid->order](table, grid->cells);
+}
+
+/****************************** cageRange ***************************************
+ * static DigitMask cageRange(int remaining, int emptyCount, int size);
+ * Purpose:
+ *     Values an empty cell of a cage can take and still leave a sum the
+ *     cage's other empty cells can reach with distinct values.
+ * Parameters:
+ *     I    remaining   cage sum less the values already placed in it
+ *     I    emptyCount  empty cells of the cage, this one included
+ *     I    size        largest value
+ *******************************************************************************/
+static DigitMask cageRange(int remaining, int emptyCount, int size)
+{
+    const int others = emptyCount - 1;
+    // The others take at least 1 + 2 + ... and at most size + (size-1) + ...
+    int low = remaining - others * (2 * size - others + 1) / 2;
+    int high = remaining - others * (others + 1) / 2;
+
+    low = low < 1 ? 1 : low;
+    high = high > size ? size : high;
+    if (low > high)
+    {
+        return 0;
+    }
+    return (DIGITBIT(high + 1) - 1) & ~(DIGITBIT(low) - 1);
+}
+
+/****************************** formatUnitCandidates ****************************
+ * void formatUnitCandidates(const UnitTable *table, const SudokuGrid *grid,
+ *         OutputBuffer *output, const char *separator);
+ * Purpose:
+ *     Appends the position and possible values of every empty cell under
+ *     variant rules, in the "[row][column]: values " layout of option L.
+ * Parameters:
+ *     I    table       units and cages of the rules, of the grid's order
+ *     I    grid        puzzle values, zero for empty cells
+ *     I/O  output      buffer to append to
+ *     I    separator   text appended after each empty cell
+ * Notes:
+ *     A value is possible when no unit of the cell holds it, its cage does
+ *     not hold it either, and the cage's sum can still be reached.
+ *******************************************************************************/
+void formatUnitCandidates(const UnitTable *table, const SudokuGrid *grid,
+        OutputBuffer *output, const char *separator)
+{
+    const int size = table->size;
+    DigitMask unitMasks[MAXVARIANTUNITS];
+    DigitMask cageMasks[MAXCAGES];
+    int cageRemaining[MAXCAGES];
+    int cageEmpty[MAXCAGES];
+    DigitMask candidates;
+    int unitIndex;
+    int memberIndex;
+    int cageIndex;
+    int cellIndex;
+    int value;
+
+    // Digits used in every unit and cage, computed once
+    for (unitIndex = 0; unitIndex < table->unitCount; unitIndex++)
+    {
+        unitMasks[unitIndex] = 0;
+        for (memberIndex = 0; memberIndex < size; memberIndex++)
+        {
+            unitMasks[unitIndex] |=
+                DIGITBIT(grid->cells[table->units[unitIndex][memberIndex]]);
+        }
+    }
+    for (cageIndex = 0; cageIndex < table->cageCount; cageIndex++)
+    {
+        cageMasks[cageIndex] = 0;
+        cageRemaining[cageIndex] = table->cageSums[cageIndex];
+        cageEmpty[cageIndex] = 0;
+        for (memberIndex = table->cageStarts[cageIndex];
+                memberIndex < table->cageStarts[cageIndex + 1]; memberIndex++)
+        {
+            value = grid->cells[table->cageCells[memberIndex]];
+            cageMasks[cageIndex] |= DIGITBIT(value);
+            cageRemaining[cageIndex] -= value;
+            cageEmpty[cageIndex] += value == 0;
+        }
+    }
+
+    for (cellIndex = 0; cellIndex < size * size; cellIndex++)
+    {
+        if (grid->cells[cellIndex] != 0)
+        {
+            continue;
+        }
+        candidates = ALLDIGITS(size);
+        for (unitIndex = 0; unitIndex < table->cellUnitCounts[cellIndex];
+                unitIndex++)
+        {
+            candidates &= ~unitMasks[table->cellUnits[cellIndex][unitIndex]];
+        }
+        cageIndex = table->cellCages[cellIndex];
+        if (cageIndex >= 0)
+        {
+            candidates &= ~cageMasks[cageIndex] & cageRange(
+                    cageRemaining[cageIndex], cageEmpty[cageIndex], size);
+        }
+        formatCellCandidates(output, cellIndex / size, cellIndex % size,
+                candidates, separator);
+    }
+}
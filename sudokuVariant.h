@@ -0,0 +1,46 @@
+/*******************************************************************************
+ * sudokuVariant.h by Geoffrey Sessums
+ * Purpose:
+ *   Defines the unit table of variant rules: the groups of cells that must
+ *   hold distinct values (rows, columns, regions, diagonals) and the
+ *   killer cages, which must also add up to their sums.
+ *   Prototypes
+ * Notes:
+ *   Requires sudokuChecker.h, sudokuOutput.h and sudokuReader.h
+ *******************************************************************************/
+#ifndef SUDOKUVARIANT_H
+#define SUDOKUVARIANT_H
+
+// Units of the largest table: rows, columns, regions and both diagonals
+#define MAXVARIANTUNITS (MAXUNITS + 2)
+// Units holding one cell: its row, column, region and up to two diagonals
+#define MAXCELLUNITS 5
+// Killer cages: at most one per cell
+#define MAXCAGES MAXCELLS
+
+// Cells of every unit and cage of a puzzle, built once for all records
+typedef struct
+{
+    int order;
+    int size;
+    int unitCount;                              // each of size cells
+    unsigned short units[MAXVARIANTUNITS][MAXSIZE];
+    unsigned char cellUnitCounts[MAXCELLS];
+    unsigned char cellUnits[MAXCELLS][MAXCELLUNITS]; // units holding a cell
+    int cageCount;
+    int cageSums[MAXCAGES];
+    unsigned short cageStarts[MAXCAGES + 1];    // cage n holds cageCells
+    unsigned short cageCells[MAXCELLS];         // [cageStarts[n] ..
+    short cellCages[MAXCELLS];                  // cageStarts[n + 1]), or -1
+} UnitTable;
+
+// Prototypes
+void initUnitTable(UnitTable *table, int order);
+void addDiagonals(UnitTable *table);
+void readJigsawRegions(UnitTable *table, SudokuReader *reader);
+void readKillerCages(UnitTable *table, SudokuReader *reader);
+int checkUnits(const UnitTable *table, const SudokuGrid *grid);
+void formatUnitCandidates(const UnitTable *table, const SudokuGrid *grid,
+        OutputBuffer *output, const char *separator);
+
+#endif